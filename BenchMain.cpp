@@ -0,0 +1,18 @@
+#include "Benchmark.hpp"
+
+// std
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+int main(int argc, char **argv) {
+    try {
+        Engine::Benchmark benchmark{Engine::BenchmarkSettings::fromCommandLine(argc, argv)};
+        benchmark.run();
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,554 @@
+#include "Benchmark.hpp"
+
+#include "Camera.hpp"
+#include "FrameInfo.hpp"
+#include "Utils.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace Engine {
+
+    using Clock = std::chrono::steady_clock;
+
+    static float elapsedMilliseconds(Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+    }
+
+    static size_t residentMemory() {
+#ifdef __linux__
+        std::ifstream statm{"/proc/self/statm"};
+        size_t totalPages = 0, residentPages = 0;
+        if (statm >> totalPages >> residentPages) {
+            return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        }
+#endif
+        return 0;
+    }
+
+    struct Percentiles {
+        float mean = 0.f;
+        float min = 0.f;
+        float p50 = 0.f;
+        float p90 = 0.f;
+        float p95 = 0.f;
+        float p99 = 0.f;
+        float max = 0.f;
+    };
+
+    // nearest-rank percentiles
+    static Percentiles computePercentiles(std::vector<float> values) {
+        Percentiles result{};
+        if (values.empty()) {
+            return result;
+        }
+        std::sort(values.begin(), values.end());
+
+        auto rank = [&](float percentile) {
+            size_t index = static_cast<size_t>(std::ceil(percentile / 100.f * values.size()));
+            return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+        };
+
+        double sum = 0.0;
+        for (float value : values) {
+            sum += value;
+        }
+        result.mean = static_cast<float>(sum / values.size());
+        result.min = values.front();
+        result.p50 = rank(50.f);
+        result.p90 = rank(90.f);
+        result.p95 = rank(95.f);
+        result.p99 = rank(99.f);
+        result.max = values.back();
+        return result;
+    }
+
+    static std::vector<uint32_t> parseList(const std::string &list) {
+        std::vector<uint32_t> values;
+        std::stringstream stream{list};
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            values.push_back(static_cast<uint32_t>(std::stoul(item)));
+        }
+        return values;
+    }
+
+    BenchmarkSettings BenchmarkSettings::fromCommandLine(int argc, char **argv) {
+        BenchmarkSettings settings{};
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto nextValue = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--scene") {
+                settings.scenePath = nextValue();
+            } else if (arg == "--instances") {
+                settings.instances = static_cast<uint32_t>(std::stoul(nextValue()));
+            } else if (arg == "--frames") {
+                settings.frames = static_cast<uint32_t>(std::stoul(nextValue()));
+            } else if (arg == "--warmup") {
+                settings.warmupFrames = static_cast<uint32_t>(std::stoul(nextValue()));
+            } else if (arg == "--timestep") {
+                settings.timestep = std::stof(nextValue());
+            } else if (arg == "--headless") {
+                settings.headless = true;
+            } else if (arg == "--size") {
+                std::string size = nextValue();
+                size_t separator = size.find('x');
+                if (separator == std::string::npos) {
+                    throw std::runtime_error("expected WIDTHxHEIGHT for --size");
+                }
+                settings.width = static_cast<uint32_t>(std::stoul(size.substr(0, separator)));
+                settings.height = static_cast<uint32_t>(std::stoul(size.substr(separator + 1)));
+            } else if (arg == "--threads") {
+                settings.threadCounts = parseList(nextValue());
+            } else if (arg == "--descriptor-sets") {
+                settings.descriptorSetsPerFrame = static_cast<uint32_t>(std::stoul(nextValue()));
+            } else if (arg == "--depth-prepass") {
+                settings.depthPrepass = true;
+            } else if (arg == "--no-bloom") {
+                settings.bloom = false;
+            } else if (arg == "--csv") {
+                settings.csvPath = nextValue();
+            } else if (arg == "--json") {
+                settings.jsonPath = nextValue();
+            } else {
+                throw std::runtime_error("unknown option: " + arg);
+            }
+        }
+
+        if (settings.threadCounts.empty() ||
+            std::find(settings.threadCounts.begin(), settings.threadCounts.end(), 0u) != settings.threadCounts.end()) {
+            throw std::runtime_error("thread counts must be at least 1");
+        }
+        if (settings.frames == 0 || settings.timestep <= 0.f) {
+            throw std::runtime_error("frame count and timestep must be positive");
+        }
+
+        return settings;
+    }
+
+    BenchmarkScene BenchmarkScene::load(const std::string &filepath) {
+        std::ifstream file{filepath};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open scene: " + filepath);
+        }
+
+        BenchmarkScene scene{};
+        std::string line;
+        uint32_t lineNumber = 0;
+        while (std::getline(file, line)) {
+            lineNumber++;
+            std::istringstream stream{line};
+            std::string keyword;
+            if (!(stream >> keyword) || keyword[0] == '#') {
+                continue;
+            }
+
+            if (keyword == "seed") {
+                stream >> scene.seed;
+            } else if (keyword == "instances") {
+                stream >> scene.instances;
+            } else if (keyword == "model") {
+                std::string model;
+                stream >> model;
+                scene.models.push_back(model);
+            } else if (keyword == "texture") {
+                std::string texture;
+                stream >> texture;
+                scene.textures.push_back(texture);
+            } else if (keyword == "area") {
+                stream >> scene.area.x >> scene.area.y;
+            } else if (keyword == "scale") {
+                stream >> scene.scale.x >> scene.scale.y;
+            } else if (keyword == "lights") {
+                stream >> scene.lights >> scene.lightRadius.x >> scene.lightRadius.y;
+            } else if (keyword == "camera") {
+                CameraKeyframe keyframe{};
+                stream >> keyframe.time
+                    >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+                    >> keyframe.rotation.x >> keyframe.rotation.y >> keyframe.rotation.z;
+                scene.cameraPath.push_back(keyframe);
+            } else {
+                throw std::runtime_error("unknown scene keyword '" + keyword + "' in " + filepath + ":" + std::to_string(lineNumber));
+            }
+
+            if (stream.fail()) {
+                throw std::runtime_error("malformed scene line " + filepath + ":" + std::to_string(lineNumber));
+            }
+        }
+
+        if (scene.models.empty() || scene.cameraPath.empty()) {
+            throw std::runtime_error("scene needs at least one model and one camera keyframe: " + filepath);
+        }
+        std::stable_sort(scene.cameraPath.begin(), scene.cameraPath.end(),
+            [](const CameraKeyframe &a, const CameraKeyframe &b) { return a.time < b.time; });
+
+        return scene;
+    }
+
+    CameraKeyframe BenchmarkScene::sampleCamera(float time) const {
+        float duration = cameraPath.back().time - cameraPath.front().time;
+        if (cameraPath.size() == 1 || duration <= 0.f) {
+            return cameraPath.front();
+        }
+
+        float t = cameraPath.front().time + std::fmod(time, duration);
+        size_t next = 1;
+        while (next < cameraPath.size() - 1 && cameraPath[next].time <= t) {
+            next++;
+        }
+        const CameraKeyframe &a = cameraPath[next - 1];
+        const CameraKeyframe &b = cameraPath[next];
+        float alpha = b.time > a.time ? glm::clamp((t - a.time) / (b.time - a.time), 0.f, 1.f) : 1.f;
+
+        return {time, glm::mix(a.position, b.position, alpha), glm::mix(a.rotation, b.rotation, alpha)};
+    }
+
+    static std::unique_ptr<Window> createWindow(const BenchmarkSettings &settings) {
+        if (settings.headless) {
+            return nullptr;
+        }
+        return std::make_unique<Window>("Vulkan Engine Bench", settings.width, settings.height);
+    }
+
+    Benchmark::Benchmark(const BenchmarkSettings &settings)
+        : settings{settings}, scene{BenchmarkScene::load(settings.scenePath)}, window{createWindow(settings)}, device{window.get()} {
+        if (settings.instances > 0) {
+            scene.instances = settings.instances;
+        }
+
+        if (window) {
+            renderer = std::make_unique<Renderer>(*window, device);
+        } else {
+            renderer = std::make_unique<Renderer>(device, vk::Extent2D{settings.width, settings.height});
+        }
+        // vsync would hide exactly the cost we are trying to measure
+        FramePacingSettings pacing{};
+        pacing.presentMode = vk::PresentModeKHR::eImmediate;
+        renderer->setFramePacingSettings(pacing);
+
+        sceneRenderer = std::make_unique<SceneRenderer>(device, *renderer, std::max(scene.lights, 1u));
+        sceneRenderer->setDepthPrepass(settings.depthPrepass);
+        PostProcessSettings postProcess{};
+        postProcess.bloom = settings.bloom;
+        sceneRenderer->setPostProcessSettings(postProcess);
+
+        uint32_t maxThreads = *std::max_element(settings.threadCounts.begin(), settings.threadCounts.end());
+        recordingThreads = std::make_unique<ThreadPool>(maxThreads);
+
+        loadGameObjects();
+
+        GpuProfiler &profiler = device.gpuProfiler();
+        if (!profiler.timestampsSupported()) {
+            std::cout << "gpu timestamps unsupported, gpu time will not be reported" << std::endl;
+        }
+        profiler.setResolveCallback([this](const GpuProfiler::FrameTimings &timings) {
+            auto sample = samplesAwaitingGpuTime.find(timings.frame);
+            if (sample != samplesAwaitingGpuTime.end()) {
+                samples[sample->second].gpuTime = timings.milliseconds;
+                samplesAwaitingGpuTime.erase(sample);
+            }
+        });
+    }
+
+    Benchmark::~Benchmark() {
+        device.gpuProfiler().setResolveCallback(nullptr);
+    }
+
+    void Benchmark::run() {
+        // stands in for per-draw material sets in the descriptor allocation scenario
+        auto transientSetLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eAllGraphics)
+            .build();
+
+        const RenderSystem &renderSystem = sceneRenderer->getRenderSystem();
+        Camera camera{};
+
+        std::cout << "benchmark: " << scene.instances << " instances, " << lights.size() << " lights, " << settings.warmupFrames << " warmup + "
+            << settings.frames << " measured frames per run" << std::endl;
+
+        uint32_t totalFrames = settings.warmupFrames + settings.frames;
+        for (uint32_t threads : settings.threadCounts) {
+            uint32_t frame = 0;
+            auto lastFrameStart = Clock::now();
+            while (frame < totalFrames) {
+                // windowed runs still pump events so the window stays responsive, input is ignored
+                SDL_Event event;
+                while (window && SDL_PollEvent(&event)) {}
+
+                // fixed timestep, the camera position only depends on the frame number
+                CameraKeyframe cameraState = scene.sampleCamera(frame * settings.timestep);
+                camera.setViewYXZ(cameraState.position, cameraState.rotation);
+                camera.setPerspectiveProjection(glm::radians(50.f), renderer->getAspectRatio(), 0.1f, 200.f);
+
+                auto frameStart = Clock::now();
+                auto commandBuffer = renderer->beginFrame();
+                if (!commandBuffer) {
+                    // swapchain was recreated, render the same frame again
+                    continue;
+                }
+                auto recordStart = Clock::now();
+
+                uint64_t frameNumber = renderer->getFrameNumber();
+                FrameInfo frameInfo = sceneRenderer->beginFrame(commandBuffer, camera, settings.timestep, gameObjects, lights);
+
+                auto transientInfo = frameInfo.uniformRing.descriptorInfo(sizeof(GlobalUbo));
+                for (uint32_t i = 0; i < settings.descriptorSetsPerFrame; i++) {
+                    vk::DescriptorSet set;
+                    if (!DescriptorWriter(*transientSetLayout, frameInfo.frameDescriptorAllocator)
+                        .writeBuffer(0, &transientInfo)
+                        .build(set)) {
+                        throw std::runtime_error("failed to allocate transient descriptor set!");
+                    }
+                }
+
+                sceneRenderer->render(frameInfo, *recordingThreads, threads);
+                // submission and present block on the swapchain, they are measured separately
+                auto recordEnd = Clock::now();
+                renderer->endFrame();
+                auto submitEnd = Clock::now();
+
+                if (frame >= settings.warmupFrames) {
+                    FrameSample sample{};
+                    sample.threads = threads;
+                    sample.frame = frame - settings.warmupFrames;
+                    sample.cpuTime = elapsedMilliseconds(recordStart, recordEnd);
+                    sample.submitTime = elapsedMilliseconds(recordEnd, submitEnd);
+                    sample.frameTime = elapsedMilliseconds(lastFrameStart, frameStart);
+                    sample.draws = renderSystem.getDrawCount();
+                    sample.meshBinds = renderSystem.getDrawStats().meshBinds;
+                    sample.meshBindsSkipped = renderSystem.getDrawStats().meshBindsSkipped;
+                    sample.materialBinds = renderSystem.getDrawStats().materialBinds;
+                    sample.shadowCascades = sceneRenderer->getShadows().getRenderedCascadeCount();
+                    sample.residentMemory = residentMemory();
+                    sample.deviceMemory = device.memoryTracker().getTotalAllocated();
+                    samples.push_back(sample);
+                    samplesAwaitingGpuTime[frameNumber] = samples.size() - 1;
+                }
+                lastFrameStart = frameStart;
+                frame++;
+            }
+        }
+
+        device.device().waitIdle();
+        device.gpuProfiler().flush();
+
+        printSummary();
+        if (!settings.csvPath.empty()) {
+            writeCsv(settings.csvPath);
+        }
+        if (!settings.jsonPath.empty()) {
+            writeJson(settings.jsonPath);
+        }
+    }
+
+    void Benchmark::loadGameObjects() {
+        // std distributions are implementation defined, placement is reproducible per standard library
+        std::mt19937 rng{scene.seed};
+        std::uniform_real_distribution<float> xDistribution{-scene.area.x, scene.area.x};
+        std::uniform_real_distribution<float> zDistribution{-scene.area.y, scene.area.y};
+        std::uniform_real_distribution<float> scaleDistribution{scene.scale.x, scene.scale.y};
+        std::uniform_real_distribution<float> rotationDistribution{0.f, glm::two_pi<float>()};
+        std::uniform_int_distribution<size_t> modelDistribution{0, scene.models.size() - 1};
+
+        std::unordered_map<std::string, std::shared_ptr<Model>> loadedModels;
+        std::vector<std::shared_ptr<Model>> models;
+        for (const auto &path : scene.models) {
+            auto &model = loadedModels[path];
+            if (!model) {
+                model = Model::createModelFromFile(device, path);
+            }
+            models.push_back(model);
+        }
+
+        // a handful of tints, assigned round robin so placement keeps drawing the same random numbers
+        std::vector<uint32_t> textures;
+        for (const auto &path : scene.textures) {
+            textures.push_back(sceneRenderer->getVirtualTextures().registerTexture(path));
+        }
+
+        std::vector<std::shared_ptr<Material>> sceneMaterials;
+        for (uint32_t i = 0; i < 8; i++) {
+            MaterialParameters parameters{};
+            parameters.baseColor = {.6f + .05f * i, 1.f - .05f * i, .8f, 1.f};
+            if (!textures.empty()) {
+                parameters.baseColorTexture = textures[i % textures.size()];
+            }
+            sceneMaterials.push_back(sceneRenderer->getMaterials().createMaterial(parameters));
+        }
+
+        gameObjects.reserve(scene.instances);
+        for (uint32_t i = 0; i < scene.instances; i++) {
+            auto object = GameObject::createGameObject();
+            object.model = models[modelDistribution(rng)];
+            object.material = sceneMaterials[i % sceneMaterials.size()];
+            object.transform.translation = {xDistribution(rng), 0.f, zDistribution(rng)};
+            object.transform.rotation.y = rotationDistribution(rng);
+            object.transform.scale = glm::vec3{scaleDistribution(rng)};
+            object.isStatic = true;
+            gameObjects.emplace(object.getId(), std::move(object));
+        }
+
+        // above the objects, the y axis points down
+        std::uniform_real_distribution<float> heightDistribution{-3.f, -.5f};
+        std::uniform_real_distribution<float> radiusDistribution{scene.lightRadius.x, scene.lightRadius.y};
+        std::uniform_real_distribution<float> colorDistribution{.1f, 1.f};
+        lights.reserve(scene.lights);
+        for (uint32_t i = 0; i < scene.lights; i++) {
+            PointLight light{};
+            light.position = {xDistribution(rng), heightDistribution(rng), zDistribution(rng)};
+            light.radius = radiusDistribution(rng);
+            light.color = {colorDistribution(rng), colorDistribution(rng), colorDistribution(rng), 1.f};
+            lights.push_back(light);
+        }
+    }
+
+    void Benchmark::writeCsv(const std::string &filepath) const {
+        std::ofstream file{filepath};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+
+        file << "threads,frame,cpu_ms,submit_ms,frame_ms,gpu_ms,draws,mesh_binds,mesh_binds_skipped,material_binds,shadow_cascades,resident_bytes,device_bytes\n";
+        for (const auto &sample : samples) {
+            file << sample.threads << ',' << sample.frame << ',' << sample.cpuTime << ',' << sample.submitTime << ',' << sample.frameTime << ',';
+            if (sample.gpuTime >= 0.f) {
+                file << sample.gpuTime;
+            }
+            file << ',' << sample.draws << ',' << sample.meshBinds << ',' << sample.meshBindsSkipped << ',' << sample.materialBinds << ',' << sample.shadowCascades << ',' << sample.residentMemory << ',' << sample.deviceMemory << '\n';
+        }
+    }
+
+    static void writePercentiles(std::ostream &out, const char *name, const Percentiles &p) {
+        out << "\"" << name << "\": {\"mean\": " << p.mean << ", \"min\": " << p.min << ", \"p50\": " << p.p50
+            << ", \"p90\": " << p.p90 << ", \"p95\": " << p.p95 << ", \"p99\": " << p.p99 << ", \"max\": " << p.max << "}";
+    }
+
+    void Benchmark::writeJson(const std::string &filepath) const {
+        std::ofstream file{filepath};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+
+        file << std::fixed << std::setprecision(4);
+        file << "{\n";
+        file << "  \"scene\": \"";
+        writeJsonEscaped(file, settings.scenePath);
+        file << "\",\n";
+        file << "  \"instances\": " << scene.instances << ",\n";
+        file << "  \"lights\": " << scene.lights << ",\n";
+        file << "  \"frames\": " << settings.frames << ",\n";
+        file << "  \"timestep\": " << settings.timestep << ",\n";
+        file << "  \"headless\": " << (settings.headless ? "true" : "false") << ",\n";
+        file << "  \"width\": " << renderer->getSwapChainExtent().width << ",\n";
+        file << "  \"height\": " << renderer->getSwapChainExtent().height << ",\n";
+        file << "  \"descriptor_sets_per_frame\": " << settings.descriptorSetsPerFrame << ",\n";
+        file << "  \"depth_prepass\": " << (settings.depthPrepass ? "true" : "false") << ",\n";
+        file << "  \"bloom\": " << (settings.bloom ? "true" : "false") << ",\n";
+        VirtualTextureSystem::Stats virtualTextureStats = sceneRenderer->getVirtualTextures().getStats();
+        file << "  \"virtual_texture_feedback_requests\": " << virtualTextureStats.feedbackRequests << ",\n";
+        file << "  \"virtual_texture_pages_uploaded\": " << virtualTextureStats.pagesUploaded << ",\n";
+        file << "  \"runs\": [\n";
+
+        for (size_t run = 0; run < settings.threadCounts.size(); run++) {
+            uint32_t threads = settings.threadCounts[run];
+            std::vector<float> cpuTimes, submitTimes, frameTimes, gpuTimes;
+            uint32_t draws = 0;
+            uint32_t meshBinds = 0;
+            uint32_t meshBindsSkipped = 0;
+            uint32_t materialBinds = 0;
+            size_t peakMemory = 0;
+            uint64_t peakDeviceMemory = 0;
+            for (const auto &sample : samples) {
+                if (sample.threads != threads) continue;
+                cpuTimes.push_back(sample.cpuTime);
+                submitTimes.push_back(sample.submitTime);
+                frameTimes.push_back(sample.frameTime);
+                if (sample.gpuTime >= 0.f) {
+                    gpuTimes.push_back(sample.gpuTime);
+                }
+                draws = std::max(draws, sample.draws);
+                meshBinds = std::max(meshBinds, sample.meshBinds);
+                meshBindsSkipped = std::max(meshBindsSkipped, sample.meshBindsSkipped);
+                materialBinds = std::max(materialBinds, sample.materialBinds);
+                peakMemory = std::max(peakMemory, sample.residentMemory);
+                peakDeviceMemory = std::max(peakDeviceMemory, sample.deviceMemory);
+            }
+
+            file << "    {\"threads\": " << threads << ", \"draws\": " << draws << ", \"mesh_binds\": " << meshBinds
+                << ", \"mesh_binds_skipped\": " << meshBindsSkipped << ", \"material_binds\": " << materialBinds
+                << ", \"peak_resident_bytes\": " << peakMemory
+                << ", \"peak_device_bytes\": " << peakDeviceMemory << ",\n      ";
+            writePercentiles(file, "cpu_ms", computePercentiles(cpuTimes));
+            file << ",\n      ";
+            writePercentiles(file, "submit_ms", computePercentiles(submitTimes));
+            file << ",\n      ";
+            writePercentiles(file, "frame_ms", computePercentiles(frameTimes));
+            if (!gpuTimes.empty()) {
+                file << ",\n      ";
+                writePercentiles(file, "gpu_ms", computePercentiles(gpuTimes));
+            }
+            file << "}" << (run + 1 < settings.threadCounts.size() ? "," : "") << "\n";
+        }
+
+        file << "  ]\n}\n";
+    }
+
+    void Benchmark::printSummary() const {
+        std::cout << std::fixed << std::setprecision(3);
+        for (uint32_t threads : settings.threadCounts) {
+            std::vector<float> cpuTimes, submitTimes, gpuTimes;
+            for (const auto &sample : samples) {
+                if (sample.threads != threads) continue;
+                cpuTimes.push_back(sample.cpuTime);
+                submitTimes.push_back(sample.submitTime);
+                if (sample.gpuTime >= 0.f) {
+                    gpuTimes.push_back(sample.gpuTime);
+                }
+            }
+
+            Percentiles cpu = computePercentiles(cpuTimes);
+            Percentiles submit = computePercentiles(submitTimes);
+            std::cout << "threads " << threads << ": cpu p50 " << cpu.p50 << " ms, p99 " << cpu.p99 << " ms"
+                << " | submit p50 " << submit.p50 << " ms, p99 " << submit.p99 << " ms";
+            if (!gpuTimes.empty()) {
+                Percentiles gpu = computePercentiles(gpuTimes);
+                std::cout << " | gpu p50 " << gpu.p50 << " ms, p99 " << gpu.p99 << " ms";
+            }
+            std::cout << std::endl;
+        }
+
+        // a textured scene that never asks for more than the pinned coarsest pages points at a broken readback
+        VirtualTextureSystem::Stats virtualTextureStats = sceneRenderer->getVirtualTextures().getStats();
+        std::cout << "virtual textures: " << virtualTextureStats.feedbackRequests << " feedback requests, "
+            << virtualTextureStats.pagesUploaded << " pages uploaded" << std::endl;
+        if (!scene.textures.empty() && virtualTextureStats.feedbackRequests == 0) {
+            std::cerr << "warning: no virtual texture page was requested, the feedback readback saw none of the shaders' writes" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ClusteredLighting.hpp"
+#include "Device.hpp"
+#include "GameObject.hpp"
+#include "Renderer.hpp"
+#include "SceneRenderer.hpp"
+#include "ThreadPool.hpp"
+#include "Window.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine {
+
+    struct BenchmarkSettings {
+        std::string scenePath = "./Scenes/Benchmark.scene";
+        // overrides the instance count of the scene when non zero
+        uint32_t instances = 0;
+        uint32_t frames = 1000;
+        // rendered before measuring so pipeline creation and first touch allocations are excluded
+        uint32_t warmupFrames = 60;
+        // simulation time advanced per frame, independent of how long the frame took
+        float timestep = 1.f / 60.f;
+
+        bool headless = false;
+        uint32_t width = 1280;
+        uint32_t height = 720;
+
+        // one measured run per entry, 1 records serially, more records in parallel secondary command buffers
+        std::vector<uint32_t> threadCounts{1};
+        // transient descriptor sets allocated from the per-frame allocator every frame
+        uint32_t descriptorSetsPerFrame = 0;
+        bool depthPrepass = false;
+        bool bloom = true;
+
+        std::string csvPath{};
+        std::string jsonPath{};
+
+        static BenchmarkSettings fromCommandLine(int argc, char **argv);
+    };
+
+    struct CameraKeyframe {
+        float time;
+        glm::vec3 position;
+        glm::vec3 rotation;
+    };
+
+    struct BenchmarkScene {
+        uint32_t seed = 0;
+        uint32_t instances = 0;
+        std::vector<std::string> models;
+        // virtual textures, assigned round robin as base color of the instance materials
+        std::vector<std::string> textures;
+        glm::vec2 area{10.f, 10.f};
+        glm::vec2 scale{1.f, 1.f};
+        // point lights placed over the same area, with radii in lightRadius
+        uint32_t lights = 0;
+        glm::vec2 lightRadius{2.f, 6.f};
+        std::vector<CameraKeyframe> cameraPath;
+
+        static BenchmarkScene load(const std::string &filepath);
+
+        // Linearly interpolates the camera path, looping once the last keyframe is reached
+        CameraKeyframe sampleCamera(float time) const;
+    };
+
+    // Renders a scripted scene for a fixed number of frames and reports per-frame timings
+    class Benchmark {
+        public:
+        Benchmark(const BenchmarkSettings &settings);
+        ~Benchmark();
+
+        Benchmark(const Benchmark &) = delete;
+        Benchmark &operator=(const Benchmark &) = delete;
+
+        void run();
+
+        private:
+        struct FrameSample {
+            uint32_t threads;
+            uint32_t frame;
+            // recording only, excludes waiting for the gpu or the swapchain
+            float cpuTime;
+            // Renderer::endFrame, queue submission and present including any swapchain waits
+            float submitTime;
+            // wall clock since the previous frame started
+            float frameTime;
+            // negative until the gpu profiler resolved the frame, stays negative without timestamp support
+            float gpuTime = -1.f;
+            uint32_t draws;
+            uint32_t meshBinds;
+            uint32_t meshBindsSkipped;
+            uint32_t materialBinds;
+            // cascades rendered this frame, cached ones that were reused are not counted
+            uint32_t shadowCascades;
+            size_t residentMemory;
+            // tracked allocations across all heaps
+            uint64_t deviceMemory;
+        };
+
+        void loadGameObjects();
+        void writeCsv(const std::string &filepath) const;
+        void writeJson(const std::string &filepath) const;
+        void printSummary() const;
+
+        BenchmarkSettings settings;
+        BenchmarkScene scene;
+
+        std::unique_ptr<Window> window;
+        Device device;
+        std::unique_ptr<Renderer> renderer;
+
+        // before gameObjects, the materials they hold are released into its material system
+        std::unique_ptr<SceneRenderer> sceneRenderer{};
+        std::unique_ptr<ThreadPool> recordingThreads{};
+        GameObject::Map gameObjects;
+        std::vector<PointLight> lights;
+
+        std::vector<FrameSample> samples;
+        // samples still waiting for the gpu profiler to resolve their frame
+        std::unordered_map<uint64_t, size_t> samplesAwaitingGpuTime;
+    };
+}
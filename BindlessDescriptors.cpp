@@ -0,0 +1,136 @@
+#include "BindlessDescriptors.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Engine {
+
+    BindlessDescriptors::BindlessDescriptors(Device &device, uint32_t maxStorageBuffers, uint32_t maxSampledImages) : device{device} {
+        assert(device.supportsBindless() && "Device does not support descriptor indexing");
+
+        auto &limits = device.descriptorIndexingProperties;
+        storageBuffers.capacity = std::min({maxStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+            limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+        sampledImages.capacity = std::min({maxSampledImages, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+        // both arrays are visible to every stage, together they have to fit the per-stage resource limit next to the
+        // regular sets bound in the same pipeline layouts
+        uint32_t perStageResources = limits.maxPerStageUpdateAfterBindResources > RESERVED_PER_STAGE_RESOURCES
+            ? limits.maxPerStageUpdateAfterBindResources - RESERVED_PER_STAGE_RESOURCES : 0;
+        uint64_t requested = uint64_t{storageBuffers.capacity} + sampledImages.capacity;
+        if (requested > perStageResources) {
+            storageBuffers.capacity = static_cast<uint32_t>(uint64_t{storageBuffers.capacity} * perStageResources / requested);
+            sampledImages.capacity = perStageResources - storageBuffers.capacity;
+        }
+        if (storageBuffers.capacity == 0 || sampledImages.capacity == 0) {
+            throw std::runtime_error("device limits leave no room for bindless descriptors!");
+        }
+
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+            vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+
+        setLayout = DescriptorSetLayout::Builder(device)
+            .setLayoutFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+            .addBinding(STORAGE_BUFFER_BINDING, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eAllGraphics | vk::ShaderStageFlagBits::eCompute,
+                storageBuffers.capacity, bindingFlags)
+            .addBinding(SAMPLED_IMAGE_BINDING, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eAllGraphics | vk::ShaderStageFlagBits::eCompute,
+                sampledImages.capacity, bindingFlags)
+            .build();
+
+        pool = DescriptorPool::Builder(device)
+            .setPoolFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+            .setMaxSets(1)
+            .addPoolSize(vk::DescriptorType::eStorageBuffer, storageBuffers.capacity)
+            .addPoolSize(vk::DescriptorType::eCombinedImageSampler, sampledImages.capacity)
+            .build();
+
+        if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+    }
+
+    BindlessDescriptors::~BindlessDescriptors() {}
+
+    BindlessHandle BindlessDescriptors::addStorageBuffer(const vk::DescriptorBufferInfo &bufferInfo) {
+        BindlessHandle handle{storageBuffers.allocate()};
+        updateStorageBuffer(handle, bufferInfo);
+        return handle;
+    }
+
+    BindlessHandle BindlessDescriptors::addSampledImage(const vk::DescriptorImageInfo &imageInfo) {
+        BindlessHandle handle{sampledImages.allocate()};
+        updateSampledImage(handle, imageInfo);
+        return handle;
+    }
+
+    void BindlessDescriptors::updateStorageBuffer(BindlessHandle handle, const vk::DescriptorBufferInfo &bufferInfo) {
+        assert(handle.isValid() && handle.index < storageBuffers.capacity && "Invalid bindless storage buffer handle");
+        write(STORAGE_BUFFER_BINDING, handle.index, &bufferInfo, nullptr);
+    }
+
+    void BindlessDescriptors::updateSampledImage(BindlessHandle handle, const vk::DescriptorImageInfo &imageInfo) {
+        assert(handle.isValid() && handle.index < sampledImages.capacity && "Invalid bindless sampled image handle");
+        write(SAMPLED_IMAGE_BINDING, handle.index, nullptr, &imageInfo);
+    }
+
+    void BindlessDescriptors::freeStorageBuffer(BindlessHandle handle) {
+        if (handle.isValid()) {
+            storageBuffers.free(handle.index, device.frameScheduler().currentFrame());
+        }
+    }
+
+    void BindlessDescriptors::freeSampledImage(BindlessHandle handle) {
+        if (handle.isValid()) {
+            sampledImages.free(handle.index, device.frameScheduler().currentFrame());
+        }
+    }
+
+    void BindlessDescriptors::beginFrame() {
+        storageBuffers.recycle(device.frameScheduler());
+        sampledImages.recycle(device.frameScheduler());
+    }
+
+    void BindlessDescriptors::write(uint32_t binding, uint32_t arrayElement, const vk::DescriptorBufferInfo *bufferInfo, const vk::DescriptorImageInfo *imageInfo) {
+        vk::WriteDescriptorSet write{};
+        write.setDstSet(descriptorSet);
+        write.setDstBinding(binding);
+        write.setDstArrayElement(arrayElement);
+        write.setDescriptorCount(1);
+        if (bufferInfo) {
+            write.setDescriptorType(vk::DescriptorType::eStorageBuffer);
+            write.setPBufferInfo(bufferInfo);
+        } else {
+            write.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+            write.setPImageInfo(imageInfo);
+        }
+        device.device().updateDescriptorSets(1, &write, 0, nullptr);
+    }
+
+    uint32_t BindlessDescriptors::SlotAllocator::allocate() {
+        if (!freeSlots.empty()) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+        if (next >= capacity) {
+            throw std::runtime_error("out of bindless descriptor slots!");
+        }
+        return next++;
+    }
+
+    void BindlessDescriptors::SlotAllocator::free(uint32_t slot, uint64_t frame) {
+        pendingFrees.push_back({frame, slot});
+    }
+
+    void BindlessDescriptors::SlotAllocator::recycle(FrameScheduler &scheduler) {
+        // frees are queued in frame order
+        while (!pendingFrees.empty() && scheduler.isFrameComplete(pendingFrees.front().first)) {
+            freeSlots.push_back(pendingFrees.front().second);
+            pendingFrees.pop_front();
+        }
+    }
+}
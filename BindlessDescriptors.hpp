@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Descriptors.hpp"
+#include "Device.hpp"
+
+// std
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace Engine {
+
+    struct BindlessHandle {
+        static constexpr uint32_t INVALID_INDEX = ~0u;
+
+        uint32_t index = INVALID_INDEX;
+        bool isValid() const { return index != INVALID_INDEX; }
+    };
+
+    // One large update-after-bind descriptor set holding every storage buffer and texture.
+    // Draws index into the arrays with values passed through push constants.
+    class BindlessDescriptors {
+        public:
+        static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+        static constexpr uint32_t SAMPLED_IMAGE_BINDING = 1;
+        // left for the global and material sets, which count against the same per-stage limit
+        static constexpr uint32_t RESERVED_PER_STAGE_RESOURCES = 64;
+
+        BindlessDescriptors(Device &device, uint32_t maxStorageBuffers = 16384, uint32_t maxSampledImages = 16384);
+        ~BindlessDescriptors();
+
+        BindlessDescriptors(const BindlessDescriptors &) = delete;
+        BindlessDescriptors &operator=(const BindlessDescriptors &) = delete;
+
+        vk::DescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+        vk::DescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+        BindlessHandle addStorageBuffer(const vk::DescriptorBufferInfo &bufferInfo);
+        BindlessHandle addSampledImage(const vk::DescriptorImageInfo &imageInfo);
+        void updateStorageBuffer(BindlessHandle handle, const vk::DescriptorBufferInfo &bufferInfo);
+        void updateSampledImage(BindlessHandle handle, const vk::DescriptorImageInfo &imageInfo);
+        void freeStorageBuffer(BindlessHandle handle);
+        void freeSampledImage(BindlessHandle handle);
+
+        // Slots freed while a frame was recorded are only reused once that frame has completed
+        void beginFrame();
+
+        private:
+        struct SlotAllocator {
+            uint32_t capacity = 0;
+            uint32_t next = 0;
+            std::vector<uint32_t> freeSlots;
+            std::deque<std::pair<uint64_t, uint32_t>> pendingFrees;
+
+            uint32_t allocate();
+            void free(uint32_t slot, uint64_t frame);
+            void recycle(FrameScheduler &scheduler);
+        };
+
+        void write(uint32_t binding, uint32_t arrayElement, const vk::DescriptorBufferInfo *bufferInfo, const vk::DescriptorImageInfo *imageInfo);
+
+        Device &device;
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        std::unique_ptr<DescriptorPool> pool;
+        vk::DescriptorSet descriptorSet;
+
+        SlotAllocator storageBuffers;
+        SlotAllocator sampledImages;
+    };
+}
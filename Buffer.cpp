@@ -40,8 +40,8 @@ namespace Engine {
     
     Buffer::~Buffer() {
         unmap();
-        device.device().destroyBuffer(buffer, nullptr);
-        device.device().freeMemory(memory, nullptr);
+        // frames in flight may still read from the buffer
+        device.deferDestroy(buffer, memory);
     }
     
     /**
@@ -34,7 +34,7 @@ namespace Engine {
         void* getMappedMemory() const { return mapped; }
         uint32_t getInstanceCount() const { return instanceCount; }
         vk::DeviceSize getInstanceSize() const { return instanceSize; }
-        vk::DeviceSize getAlignmentSize() const { return instanceSize; }
+        vk::DeviceSize getAlignmentSize() const { return alignmentSize; }
         vk::BufferUsageFlags getUsageFlags() const { return usageFlags; }
         vk::MemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
         vk::DeviceSize getBufferSize() const { return bufferSize; }
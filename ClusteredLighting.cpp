@@ -0,0 +1,110 @@
+#include "ClusteredLighting.hpp"
+
+#include "GpuProfiler.hpp"
+#include "SwapChain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+
+    // std430 layout of the start of each light buffer region, the lights follow it
+    struct LightBufferHeader {
+        glm::mat4 view{1.f};
+        // projection[0][0], projection[1][1], near, far
+        glm::vec4 projection{};
+        // 1 / width, 1 / height, and scale and bias mapping log(view depth) to a depth slice
+        glm::vec4 viewport{};
+        uint32_t lightCount = 0;
+        uint32_t padding[3];
+    };
+
+    ClusteredLighting::ClusteredLighting(Device &device, DescriptorAllocator &allocator, uint32_t maxLights)
+        : device{device}, maxLights{maxLights} {
+        createBuffers();
+        createComputePipeline(allocator);
+    }
+
+    ClusteredLighting::~ClusteredLighting() { device.deferDestroy(pipelineLayout); }
+
+    void ClusteredLighting::createBuffers() {
+        vk::DeviceSize alignment = device.properties.limits.minStorageBufferOffsetAlignment;
+
+        // written every frame by the cpu, one region per frame in flight
+        lightBuffer = std::make_unique<Buffer>(device, sizeof(LightBufferHeader) + sizeof(PointLight) * maxLights,
+            SwapChain::MAX_FRAMES_IN_FLIGHT, vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, alignment);
+        lightBuffer->map();
+
+        clusterBuffer = std::make_unique<Buffer>(device, sizeof(uint32_t) * (1 + MAX_LIGHTS_PER_CLUSTER) * CLUSTER_COUNT,
+            SwapChain::MAX_FRAMES_IN_FLIGHT, vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, alignment);
+    }
+
+    void ClusteredLighting::createComputePipeline(DescriptorAllocator &allocator) {
+        computeSetLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eCompute)
+            .addBinding(1, vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eCompute)
+            .build();
+
+        auto lightInfo = lightBufferInfo();
+        auto clusterInfo = clusterBufferInfo();
+        if (!DescriptorWriter(*computeSetLayout, allocator)
+            .writeBuffer(0, &lightInfo)
+            .writeBuffer(1, &clusterInfo)
+            .build(computeDescriptorSet)) {
+            throw std::runtime_error("failed to allocate light binning descriptor set!");
+        }
+
+        vk::DescriptorSetLayout setLayout = computeSetLayout->getDescriptorSetLayout();
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, 1, &setLayout, 0, nullptr};
+        if (device.device().createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create light binning pipeline layout!");
+        }
+        pipeline = std::make_unique<ComputePipeline>(device, "./Shaders/Clusters.comp.spv", pipelineLayout);
+    }
+
+    void ClusteredLighting::update(int frameIndex, const Camera &camera, vk::Extent2D extent, const std::vector<PointLight> &lights) {
+        const glm::mat4 &projection = camera.getProjection();
+        assert(projection[2][3] == 1.f && "Clustered lighting needs a perspective projection");
+
+        float near = camera.getNear();
+        float far = camera.getFar();
+        float logRange = std::log(far / near);
+
+        LightBufferHeader header{};
+        header.view = camera.getView();
+        header.projection = {projection[0][0], projection[1][1], near, far};
+        header.viewport = {
+            1.f / static_cast<float>(extent.width),
+            1.f / static_cast<float>(extent.height),
+            CLUSTERS_Z / logRange,
+            -CLUSTERS_Z * std::log(near) / logRange};
+        lightCount = std::min(static_cast<uint32_t>(lights.size()), maxLights);
+        header.lightCount = lightCount;
+
+        char *region = static_cast<char *>(lightBuffer->getMappedMemory()) + frameIndex * lightBuffer->getAlignmentSize();
+        std::memcpy(region, &header, sizeof(header));
+        std::memcpy(region + sizeof(header), lights.data(), sizeof(PointLight) * lightCount);
+    }
+
+    void ClusteredLighting::bin(vk::CommandBuffer commandBuffer, int frameIndex) {
+        GpuProfiler::Scope profileScope{device.gpuProfiler(), commandBuffer, "ClusterLights"};
+        pipeline->bind(commandBuffer);
+
+        auto offsets = getDynamicOffsets(frameIndex);
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &computeDescriptorSet, static_cast<uint32_t>(offsets.size()), offsets.data());
+        // one workgroup per froxel, its invocations split the light list
+        commandBuffer.dispatch(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+    }
+
+    std::array<uint32_t, 2> ClusteredLighting::getDynamicOffsets(int frameIndex) const {
+        return {
+            static_cast<uint32_t>(frameIndex * lightBuffer->getAlignmentSize()),
+            static_cast<uint32_t>(frameIndex * clusterBuffer->getAlignmentSize())};
+    }
+}
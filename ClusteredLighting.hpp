@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Camera.hpp"
+#include "ComputePipeline.hpp"
+#include "Descriptors.hpp"
+#include "Device.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Engine {
+
+    struct PointLight {
+        glm::vec3 position{};
+        // the light fades to zero at this distance, bounds the clusters it is binned into
+        float radius = 5.f;
+        // rgb and intensity
+        glm::vec4 color{1.f};
+    };
+
+    // Clustered forward shading. The view frustum is split into a grid of froxels, screen tiles in xy and exponential
+    // slices in view depth. A compute pass bins the frame's point lights into every froxel their sphere touches and
+    // the fragment shader only loops over the lights of its own froxel.
+    //
+    // Lights and the binned grid live in one region per frame in flight, bound with dynamic storage buffer offsets.
+    class ClusteredLighting {
+        public:
+        // keep in sync with Clusters.comp and Shading.glsl
+        static constexpr uint32_t CLUSTERS_X = 16;
+        static constexpr uint32_t CLUSTERS_Y = 9;
+        static constexpr uint32_t CLUSTERS_Z = 24;
+        static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+        // a froxel record is its light count followed by this many light indices
+        static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 127;
+
+        // The allocator needs room for a set with two dynamic storage buffers
+        ClusteredLighting(Device &device, DescriptorAllocator &allocator, uint32_t maxLights = 4096);
+        ~ClusteredLighting();
+
+        ClusteredLighting(const ClusteredLighting &) = delete;
+        ClusteredLighting &operator=(const ClusteredLighting &) = delete;
+
+        // Writes the frame's lights and grid parameters, the grid follows the camera's perspective projection.
+        // Lights past maxLights are dropped.
+        void update(int frameIndex, const Camera &camera, vk::Extent2D extent, const std::vector<PointLight> &lights);
+        // Records the binning dispatch, e.g. between Renderer::beginCompute and endCompute(eFragmentShader)
+        void bin(vk::CommandBuffer commandBuffer, int frameIndex);
+
+        // For the dynamic storage buffer bindings of the shading pass, bound with getDynamicOffsets
+        vk::DescriptorBufferInfo lightBufferInfo() { return lightBuffer->descriptorInfo(lightBuffer->getInstanceSize()); }
+        vk::DescriptorBufferInfo clusterBufferInfo() { return clusterBuffer->descriptorInfo(clusterBuffer->getInstanceSize()); }
+        // light buffer offset followed by cluster buffer offset
+        std::array<uint32_t, 2> getDynamicOffsets(int frameIndex) const;
+
+        uint32_t getLightCount() const { return lightCount; }
+        uint32_t getMaxLights() const { return maxLights; }
+
+        private:
+        void createBuffers();
+        void createComputePipeline(DescriptorAllocator &allocator);
+
+        Device &device;
+        uint32_t maxLights;
+        uint32_t lightCount = 0;
+
+        std::unique_ptr<Buffer> lightBuffer;
+        std::unique_ptr<Buffer> clusterBuffer;
+
+        std::unique_ptr<DescriptorSetLayout> computeSetLayout;
+        vk::DescriptorSet computeDescriptorSet;
+        vk::PipelineLayout pipelineLayout;
+        std::unique_ptr<ComputePipeline> pipeline;
+    };
+}
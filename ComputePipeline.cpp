@@ -0,0 +1,39 @@
+#include "ComputePipeline.hpp"
+
+#include "Pipeline.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace Engine {
+
+    ComputePipeline::ComputePipeline(Device &device, const std::string &compFilepath, vk::PipelineLayout pipelineLayout)
+        : device{device} {
+        assert(pipelineLayout && "Cannot create compute pipeline: no pipelineLayout provided");
+
+        auto code = Pipeline::readFile(compFilepath);
+        vk::ShaderModuleCreateInfo moduleInfo{{}, code.size(), reinterpret_cast<const uint32_t *>(code.data())};
+
+        vk::ShaderModule shaderModule;
+        if (device.device().createShaderModule(&moduleInfo, nullptr, &shaderModule) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create shader module");
+        }
+
+        vk::PipelineShaderStageCreateInfo stage{{}, vk::ShaderStageFlagBits::eCompute, shaderModule, "main", nullptr};
+        vk::ComputePipelineCreateInfo pipelineInfo{{}, stage, pipelineLayout, nullptr, -1};
+
+        vk::Result result = device.device().createComputePipelines(nullptr, 1, &pipelineInfo, nullptr, &computePipeline);
+        // the module is only needed while creating the pipeline
+        device.device().destroyShaderModule(shaderModule, nullptr);
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create compute pipeline");
+        }
+    }
+
+    ComputePipeline::~ComputePipeline() { device.deferDestroy(computePipeline); }
+
+    void ComputePipeline::bind(vk::CommandBuffer commandBuffer) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, computePipeline);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Device.hpp"
+
+// std
+#include <string>
+
+namespace Engine {
+
+    class ComputePipeline {
+        public:
+        ComputePipeline(Device &device, const std::string &compFilepath, vk::PipelineLayout pipelineLayout);
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline &) = delete;
+        ComputePipeline &operator=(const ComputePipeline &) = delete;
+
+        void bind(vk::CommandBuffer commandBuffer);
+
+        // Workgroups needed to cover size invocations
+        static uint32_t groupCount(uint32_t size, uint32_t groupSize) { return (size + groupSize - 1) / groupSize; }
+
+        private:
+        Device &device;
+        vk::Pipeline computePipeline;
+    };
+}
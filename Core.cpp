@@ -1,9 +1,8 @@
 #include "Core.hpp"
 
+#include "CpuProfiler.hpp"
 #include "MovementController.hpp"
 #include "Camera.hpp"
-#include "RenderSystem.hpp"
-#include "Buffer.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -20,43 +19,42 @@
 
 namespace Engine {
 
-    struct GlobalUbo {
-        glm::mat4 projectionView{1.f};
-        glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .02f};
-        glm::vec3 lightPosition{-1.f};
-        alignas(16) glm::vec4 lightColor{1.f};
-    };
-
-    Core::Core() {
-        globalPool = DescriptorPool::Builder(device)
-            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(vk::DescriptorType::eUniformBuffer, SwapChain::MAX_FRAMES_IN_FLIGHT)
-            .build();
-        loadGameObjects();
+    static std::unique_ptr<Window> createWindow(const EngineSettings &settings) {
+        if (settings.headless) {
+            return nullptr;
+        }
+        return std::make_unique<Window>("Vulkan Engine", settings.width, settings.height);
     }
 
-    Core::~Core() {}
-
-    void Core::run() {
-        std::vector<std::unique_ptr<Buffer>> uboBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i = 0; i < uboBuffers.size(); i++) {
-            uboBuffers[i] = std::make_unique<Buffer>(device, sizeof(GlobalUbo), 1, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible);
-            uboBuffers[i]->map();
+    Core::Core(const EngineSettings &settings)
+        : settings{settings}, window{createWindow(settings)}, device{window.get()} {
+        if (window) {
+            renderer = std::make_unique<Renderer>(*window, device);
+        } else {
+            renderer = std::make_unique<Renderer>(device, vk::Extent2D{settings.width, settings.height});
         }
+        renderer->setFramePacingSettings(settings.framePacing);
 
-        auto globalSetLayout = DescriptorSetLayout::Builder(device)
-            .addBinding(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eAllGraphics)
-            .build();
+        CpuProfiler::setThreadName("Main");
+        CpuProfiler::setEnabled(!settings.cpuTracePath.empty());
+        sceneRenderer = std::make_unique<SceneRenderer>(device, *renderer);
+        sceneRenderer->setDepthPrepass(settings.depthPrepass);
+        sceneRenderer->setPostProcessSettings(settings.postProcess);
+        loadGameObjects();
+        loadLights();
+    }
 
-        std::vector<vk::DescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i = 0; i < globalDescriptorSets.size(); i++) {
-            auto bufferInfo = uboBuffers[i]->descriptorInfo();
-            DescriptorWriter(*globalSetLayout, *globalPool)
-                .writeBuffer(0, &bufferInfo)
-                .build(globalDescriptorSets[i]);
+    Core::~Core() {}
+
+    void Core::printGpuTimings(const GpuProfiler::FrameTimings &timings) {
+        std::cout << "gpu frame " << timings.frame << ": " << timings.milliseconds << " ms" << std::endl;
+        for (const auto &scope : timings.scopes) {
+            std::cout << std::string(2 * (scope.depth + 1), ' ') << scope.name << (scope.compute ? " [compute]" : "") << ": "
+                << scope.milliseconds << " ms at " << scope.startMilliseconds << " ms" << std::endl;
         }
+    }
 
-        RenderSystem simpleRenderSystem{device, renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+    void Core::run() {
         Camera camera{};
 
         auto viewerObject = GameObject::createGameObject();
@@ -65,15 +63,47 @@ namespace Engine {
 
         auto currentTime = std::chrono::high_resolution_clock::now();
         bool shouldClose = false;
+        uint32_t framesRendered = 0;
         SDL_Event event;
+        FramePacer &framePacer = renderer->getFramePacer();
         while (!shouldClose) {
-            while(SDL_PollEvent(&event)) {
-                switch(event.type) {
-                    case SDL_WINDOWEVENT_RESIZED: {
-                        window.framebufferResizeCallback(window.getExtent().width, window.getExtent().height);
-                    }
-                    case SDL_QUIT: {
-                        shouldClose = true;
+            CpuProfiler::Zone frameZone{"Frame"};
+            {
+                // in low-latency mode this sleeps until the gpu is about to run dry, so input below is sampled as late as possible
+                CpuProfiler::Zone zone{"Frame pacing"};
+                framePacer.waitForFrameStart();
+            }
+
+            {
+                CpuProfiler::Zone zone{"Poll events"};
+                while(window && SDL_PollEvent(&event)) {
+                    switch(event.type) {
+                        case SDL_KEYDOWN: {
+                            if (event.key.keysym.sym == SDLK_F12 && CpuProfiler::isEnabled()) {
+                                CpuProfiler::writeChromeTrace(settings.cpuTracePath);
+                                std::cout << "wrote cpu trace to " << settings.cpuTracePath << std::endl;
+                            }
+                            if (event.key.keysym.sym == SDLK_F10) {
+                                sceneRenderer->setDepthPrepass(!sceneRenderer->isDepthPrepassEnabled());
+                                std::cout << "depth prepass " << (sceneRenderer->isDepthPrepassEnabled() ? "on" : "off") << std::endl;
+                            }
+                            if (event.key.keysym.sym == SDLK_F9) {
+                                PostProcessSettings postProcess = sceneRenderer->getPostProcessSettings();
+                                postProcess.bloom = !postProcess.bloom;
+                                sceneRenderer->setPostProcessSettings(postProcess);
+                                std::cout << "bloom " << (postProcess.bloom ? "on" : "off") << std::endl;
+                            }
+                            if (event.key.keysym.sym == SDLK_F11) {
+                                device.memoryTracker().printReport(std::cout);
+                            }
+                            break;
+                        }
+                        case SDL_WINDOWEVENT_RESIZED: {
+                            window->framebufferResizeCallback(window->getExtent().width, window->getExtent().height);
+                        }
+                        case SDL_QUIT: {
+                            shouldClose = true;
+                        }
                     }
                 }
             }
@@ -83,28 +113,56 @@ namespace Engine {
                 std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
 
-            cameraController.moveInPlaneXZ(frameTime, viewerObject);
-            camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
-
-            float aspect = renderer.getAspectRatio();
-            camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+            {
+                CpuProfiler::Zone zone{"Camera update"};
+                if (window) {
+                    cameraController.moveInPlaneXZ(frameTime, viewerObject);
+                }
+                camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
-            if (auto commandBuffer = renderer.beginFrame()) {
-                int frameIndex = renderer.getFrameIndex();
-                FrameInfo frameInfo{frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex], gameObjects};
+                float aspect = renderer->getAspectRatio();
+                camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+            }
 
-                GlobalUbo ubo{};
-                ubo.projectionView = camera.getProjection() * camera.getView();
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
+            if (auto commandBuffer = renderer->beginFrame()) {
+                FrameInfo frameInfo = sceneRenderer->beginFrame(commandBuffer, camera, frameTime, gameObjects, lights);
+                bool parallelRecording = recordingThreads.size() > 1 && gameObjects.size() >= PARALLEL_RECORDING_MIN_OBJECTS;
+                sceneRenderer->render(frameInfo, recordingThreads, parallelRecording ? recordingThreads.size() : 1);
+                renderer->endFrame();
 
-                renderer.beginSwapChainRenderPass(commandBuffer);
+                if (settings.framePacing.reportLatency) {
+                    std::cout << "input latency: " << framePacer.getLastInputLatency() << " ms (avg "
+                        << framePacer.getAverageInputLatency() << " ms), gpu and present: " << framePacer.getAverageGpuTime() << " ms" << std::endl;
+                }
 
-                simpleRenderSystem.renderGameObjects(frameInfo);
+                framesRendered++;
+                if (settings.gpuTimingInterval > 0 && framesRendered % settings.gpuTimingInterval == 0) {
+                    printGpuTimings(device.gpuProfiler().getLatestTimings());
+                }
+                if (settings.frameCount > 0 && framesRendered >= settings.frameCount) {
+                    shouldClose = true;
+                }
+            }
+        }
 
-                renderer.endSwapChainRenderPass(commandBuffer);
-                renderer.endFrame();
+        if (!settings.capturePath.empty()) {
+            CapturedImage image = renderer->captureLastFrame();
+            bool ppm = settings.capturePath.size() >= 4 && settings.capturePath.compare(settings.capturePath.size() - 4, 4, ".ppm") == 0;
+            if (ppm) {
+                writePPM(settings.capturePath, image);
+            } else {
+                writePNG(settings.capturePath, image);
             }
+            std::cout << "captured frame to " << settings.capturePath << std::endl;
+        }
+
+        if (CpuProfiler::isEnabled()) {
+            CpuProfiler::writeChromeTrace(settings.cpuTracePath);
+            std::cout << "wrote cpu trace to " << settings.cpuTracePath << std::endl;
+        }
+
+        if (settings.memoryReport) {
+            device.memoryTracker().printReport(std::cout);
         }
 
         device.device().waitIdle();
@@ -115,8 +173,13 @@ namespace Engine {
             Model::createModelFromFile(device, "./Models/FlatVase.obj");
         auto flatVase = GameObject::createGameObject();
         flatVase.model = model;
+        // sampled through the bindless set where there is one, plain vertex colors otherwise
+        MaterialParameters vaseParameters{};
+        vaseParameters.baseColorImage = sceneRenderer->getMaterials().addTexture(Texture::createTextureFromFile(device, "./Textures/Checker.ktx2"));
+        flatVase.material = sceneRenderer->getMaterials().createMaterial(vaseParameters);
         flatVase.transform.translation = {-.5f, .5f, 0.f};
         flatVase.transform.scale = glm::vec3{3.f, 1.5f, 3.f};
+        flatVase.isStatic = true;
         gameObjects.emplace(flatVase.getId(), std::move(flatVase));
 
         model = Model::createModelFromFile(device, "./Models/SmoothVase.obj");
@@ -124,14 +187,34 @@ namespace Engine {
         smoothVase.model = model;
         smoothVase.transform.translation = {.5f, .5f, 0.f};
         smoothVase.transform.scale = {3.f, 1.5f, 3.f};
+        smoothVase.isStatic = true;
         gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
 
         model = Model::createModelFromFile(device, "./Models/Quad.obj");
         auto floor = GameObject::createGameObject();
         floor.model = model;
+        MaterialParameters floorParameters{};
+        floorParameters.baseColorTexture = sceneRenderer->getVirtualTextures().registerTexture("./Textures/Checker.ktx2");
+        floor.material = sceneRenderer->getMaterials().createMaterial(floorParameters);
         floor.transform.translation = {.5f, .5f, 0.f};
         floor.transform.scale = {3.f, 1.f, 3.f};
+        floor.isStatic = true;
         gameObjects.emplace(floor.getId(), std::move(floor));
     }
 
+    void Core::loadLights() {
+        lights.push_back({{-1.f, -1.f, -1.f}, 10.f, {1.f, 1.f, 1.f, 1.f}});
+
+        std::vector<glm::vec3> colors{
+            {1.f, .1f, .1f}, {.1f, .1f, 1.f}, {.1f, 1.f, .1f}, {1.f, 1.f, .1f}, {.1f, 1.f, 1.f}, {1.f, 1.f, 1.f}};
+        for (size_t i = 0; i < colors.size(); i++) {
+            float angle = i * glm::two_pi<float>() / colors.size();
+            PointLight light{};
+            light.position = {1.5f * glm::cos(angle) + .5f, -1.f, 1.5f * glm::sin(angle)};
+            light.radius = 3.f;
+            light.color = glm::vec4{colors[i], .3f};
+            lights.push_back(light);
+        }
+    }
+
 }
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "ClusteredLighting.hpp"
 #include "Device.hpp"
-#include "Descriptors.hpp"
 #include "GameObject.hpp"
 #include "Renderer.hpp"
+#include "SceneRenderer.hpp"
+#include "Settings.hpp"
+#include "ThreadPool.hpp"
 #include "Window.hpp"
 
 // std
@@ -13,7 +16,7 @@
 namespace Engine {
     class Core {
         public:
-        Core();
+        Core(const EngineSettings &settings = {});
         ~Core();
 
         Core(const Core &) = delete;
@@ -21,14 +24,24 @@ namespace Engine {
 
         void run();
 
+        // below this many objects recording on one thread is cheaper than the fork/join
+        static constexpr size_t PARALLEL_RECORDING_MIN_OBJECTS = 1024;
+
         private:
         void loadGameObjects();
-
-        Window window{"Vulkan Engine"};
-        Device device{window};
-        Renderer renderer{window, device};
-
-        std::unique_ptr<DescriptorPool> globalPool{};
+        void loadLights();
+        void printGpuTimings(const GpuProfiler::FrameTimings &timings);
+
+        EngineSettings settings;
+        // null when rendering headless
+        std::unique_ptr<Window> window;
+        Device device;
+        std::unique_ptr<Renderer> renderer;
+
+        // before gameObjects, the materials they hold are released into its material system
+        std::unique_ptr<SceneRenderer> sceneRenderer{};
+        ThreadPool recordingThreads{};
         GameObject::Map gameObjects;
+        std::vector<PointLight> lights;
     };
 }
@@ -0,0 +1,116 @@
+#include "CpuProfiler.hpp"
+
+#include "Utils.hpp"
+
+// std
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Engine {
+
+    namespace {
+        struct Event {
+            const char *name;
+            int64_t start;
+            int64_t end;
+        };
+
+        struct ThreadBuffer {
+            uint32_t threadId;
+            std::string name;
+            std::vector<Event> events;
+            // total events ever written, the ring slot is written % EVENTS_PER_THREAD
+            std::atomic<uint64_t> written{0};
+        };
+
+        // buffers are never freed, so zones of threads that already exited still show up in the trace
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        };
+
+        Registry &registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        ThreadBuffer &threadBuffer() {
+            thread_local ThreadBuffer *buffer = [] {
+                auto newBuffer = std::make_unique<ThreadBuffer>();
+                newBuffer->events.resize(CpuProfiler::EVENTS_PER_THREAD);
+
+                Registry &reg = registry();
+                std::lock_guard<std::mutex> lock{reg.mutex};
+                newBuffer->threadId = static_cast<uint32_t>(reg.buffers.size());
+                newBuffer->name = "Thread " + std::to_string(newBuffer->threadId);
+                reg.buffers.push_back(std::move(newBuffer));
+                return reg.buffers.back().get();
+            }();
+            return *buffer;
+        }
+    }
+
+    int64_t CpuProfiler::now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void CpuProfiler::record(const char *name, int64_t start, int64_t end) {
+        ThreadBuffer &buffer = threadBuffer();
+        uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        buffer.events[index % EVENTS_PER_THREAD] = {name, start, end};
+        // publishes the event to writeChromeTrace
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    void CpuProfiler::setThreadName(const std::string &name) {
+        ThreadBuffer &buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock{registry().mutex};
+        buffer.name = name;
+    }
+
+    void CpuProfiler::writeChromeTrace(const std::string &filepath) {
+        std::ofstream file{filepath};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock{reg.mutex};
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        auto separator = [&]() -> std::ofstream & {
+            if (!first) {
+                file << ",\n";
+            }
+            first = false;
+            return file;
+        };
+
+        for (const auto &buffer : reg.buffers) {
+            separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->threadId << ", \"args\": {\"name\": \"";
+            writeJsonEscaped(file, buffer->name);
+            file << "\"}}";
+
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t begin = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+            for (uint64_t i = begin; i < written; i++) {
+                const Event &event = buffer->events[i % EVENTS_PER_THREAD];
+                // trace_event timestamps are microseconds
+                separator() << "{\"name\": \"";
+                writeJsonEscaped(file, event.name);
+                file << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << buffer->threadId
+                    << ", \"ts\": " << event.start / 1000.0 << ", \"dur\": " << (event.end - event.start) / 1000.0 << "}";
+            }
+        }
+
+        file << "\n]}\n";
+    }
+}
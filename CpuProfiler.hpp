@@ -0,0 +1,58 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Engine {
+
+    // Scoped CPU zones recorded into a fixed size ring per thread. Only the owning thread writes its ring,
+    // so recording takes no locks. While disabled a zone costs a single relaxed atomic load.
+    class CpuProfiler {
+        public:
+        // oldest zones are overwritten once a thread recorded more than this
+        static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+        class Zone {
+            public:
+            // name has to outlive the profiler, use string literals
+            explicit Zone(const char *name) : name{name}, active{isEnabled()} {
+                if (active) {
+                    start = now();
+                }
+            }
+            ~Zone() {
+                if (active) {
+                    record(name, start, now());
+                }
+            }
+
+            Zone(const Zone &) = delete;
+            Zone &operator=(const Zone &) = delete;
+
+            private:
+            const char *name;
+            bool active;
+            int64_t start = 0;
+        };
+
+        static void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+        static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+        // Shown as the thread's track name in the trace
+        static void setThreadName(const std::string &name);
+
+        // Writes every recorded zone as Chrome trace_event JSON (chrome://tracing, Perfetto). Zones recorded
+        // concurrently with the dump may be missing or, for rings that wrapped, overwritten.
+        static void writeChromeTrace(const std::string &filepath);
+
+        private:
+        // nanoseconds since the profiler epoch
+        static int64_t now();
+        static void record(const char *name, int64_t start, int64_t end);
+
+        static inline std::atomic<bool> enabled{false};
+    };
+}
@@ -0,0 +1,46 @@
+#include "DeletionQueue.hpp"
+
+// std
+#include <utility>
+
+namespace Engine {
+
+    DeletionQueue::~DeletionQueue() { flush(); }
+
+    void DeletionQueue::push(std::function<void()> &&deleter) {
+        std::lock_guard<std::mutex> lock{mutex};
+        pending.push_back({scheduler.currentFrame(), std::move(deleter)});
+    }
+
+    void DeletionQueue::collect() {
+        // entries are pushed in frame order, so stop at the first one still in flight
+        while (true) {
+            std::function<void()> deleter;
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                if (pending.empty() || !scheduler.isFrameComplete(pending.front().frame)) {
+                    return;
+                }
+                deleter = std::move(pending.front().deleter);
+                pending.pop_front();
+            }
+            deleter();
+        }
+    }
+
+    void DeletionQueue::flush() {
+        std::deque<Entry> entries;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            entries.swap(pending);
+        }
+        for (auto &entry : entries) {
+            entry.deleter();
+        }
+    }
+
+    size_t DeletionQueue::size() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pending.size();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "FrameScheduler.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Engine {
+
+    // Defers destruction of gpu objects until every frame that could reference them has completed. Entries are
+    // stamped with the frame being recorded, which may already use the object, so releasing them never needs a
+    // device-wide wait. Pushing is thread safe, collect and flush belong to the render thread.
+    class DeletionQueue {
+        public:
+        DeletionQueue(FrameScheduler &scheduler) : scheduler{scheduler} {}
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue &) = delete;
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+        void push(std::function<void()> &&deleter);
+
+        // Runs the deleters whose frames have completed, call once per frame
+        void collect();
+        // Runs every pending deleter, the caller must make sure the device is idle
+        void flush();
+
+        size_t size();
+
+        private:
+        struct Entry {
+            uint64_t frame;
+            std::function<void()> deleter;
+        };
+
+        FrameScheduler &scheduler;
+        std::mutex mutex;
+        std::deque<Entry> pending;
+    };
+}
@@ -1,5 +1,6 @@
 #include "Descriptors.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
  
@@ -7,27 +8,43 @@ namespace Engine {
  
 // *************** Descriptor Set Layout Builder *********************
  
-DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::addBinding(uint32_t binding, vk::DescriptorType descriptorType, vk::ShaderStageFlags stageFlags, uint32_t count) {
+DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::addBinding(uint32_t binding, vk::DescriptorType descriptorType, vk::ShaderStageFlags stageFlags, uint32_t count, vk::DescriptorBindingFlags flags) {
     assert(bindings.count(binding) == 0 && "Binding already in use");
 
     vk::DescriptorSetLayoutBinding layoutBinding{binding, descriptorType, count, stageFlags};
     bindings[binding] = layoutBinding;
+    if (flags) {
+        bindingFlags[binding] = flags;
+    }
+    return *this;
+}
+
+DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::setLayoutFlags(vk::DescriptorSetLayoutCreateFlags flags) {
+    layoutFlags = flags;
     return *this;
 }
  
 std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const {
-    return std::make_unique<DescriptorSetLayout>(device, bindings);
+    return std::make_unique<DescriptorSetLayout>(device, bindings, bindingFlags, layoutFlags);
 }
  
 // *************** Descriptor Set Layout *********************
  
-DescriptorSetLayout::DescriptorSetLayout(Engine::Device &device, std::unordered_map<uint32_t, vk::DescriptorSetLayoutBinding> bindings) : device{device}, bindings{bindings} {
+DescriptorSetLayout::DescriptorSetLayout(Engine::Device &device, std::unordered_map<uint32_t, vk::DescriptorSetLayoutBinding> bindings, std::unordered_map<uint32_t, vk::DescriptorBindingFlags> bindingFlags, vk::DescriptorSetLayoutCreateFlags layoutFlags) : device{device}, bindings{bindings} {
     std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings{};
+    std::vector<vk::DescriptorBindingFlags> setLayoutBindingFlags{};
     for (auto kv : bindings) {
         setLayoutBindings.push_back(kv.second);
+        auto flags = bindingFlags.find(kv.first);
+        setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : vk::DescriptorBindingFlags{});
     }
     
-    vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{{}, static_cast<uint32_t>(setLayoutBindings.size()), setLayoutBindings.data()};
+    vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{layoutFlags, static_cast<uint32_t>(setLayoutBindings.size()), setLayoutBindings.data()};
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{static_cast<uint32_t>(setLayoutBindingFlags.size()), setLayoutBindingFlags.data()};
+    if (!bindingFlags.empty()) {
+        descriptorSetLayoutInfo.setPNext(&bindingFlagsInfo);
+    }
     
     if (device.device().createDescriptorSetLayout(&descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != vk::Result::eSuccess) {
         throw std::runtime_error("failed to create descriptor set layout!");
@@ -70,14 +87,13 @@ DescriptorPool::DescriptorPool(Engine::Device &device, uint32_t maxSets, vk::Des
 }
  
 DescriptorPool::~DescriptorPool() {
-    device.device().destroyDescriptorPool(descriptorPool, nullptr);
+    device.deferDestroy(descriptorPool);
 }
  
 bool DescriptorPool::allocateDescriptor(const vk::DescriptorSetLayout descriptorSetLayout, vk::DescriptorSet &descriptor) const {
     vk::DescriptorSetAllocateInfo allocInfo{descriptorPool, 1, &descriptorSetLayout};
     
-    // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-    // a new pool whenever an old pool fills up. But this is beyond our current scope
+    // Fixed size pool, use DescriptorAllocator when the number of sets isn't known up front
     if (device.device().allocateDescriptorSets(&allocInfo, &descriptor) != vk::Result::eSuccess) {
         return false;
     }
@@ -85,16 +101,112 @@ bool DescriptorPool::allocateDescriptor(const vk::DescriptorSetLayout descriptor
 }
  
 void DescriptorPool::freeDescriptors(std::vector<vk::DescriptorSet> &descriptors) const {
-    device.device().freeDescriptorSets(descriptorPool, static_cast<uint32_t>(descriptors.size()), descriptors.data());
+    // the sets may still be bound by frames in flight
+    device.deferFree(descriptorPool, descriptors);
 }
  
 void DescriptorPool::resetPool() {
     device.device().resetDescriptorPool(descriptorPool, {});
 }
  
+// *************** Descriptor Allocator Builder *********************
+
+DescriptorAllocator::Builder &DescriptorAllocator::Builder::addPoolRatio(vk::DescriptorType descriptorType, float ratio) {
+    poolRatios.push_back({descriptorType, ratio});
+    return *this;
+}
+
+DescriptorAllocator::Builder &DescriptorAllocator::Builder::setPoolFlags(vk::DescriptorPoolCreateFlags flags) {
+    poolFlags = flags;
+    return *this;
+}
+
+DescriptorAllocator::Builder &DescriptorAllocator::Builder::setSetsPerPool(uint32_t count) {
+    setsPerPool = count;
+    return *this;
+}
+
+std::unique_ptr<DescriptorAllocator> DescriptorAllocator::Builder::build() const {
+    return std::make_unique<DescriptorAllocator>(device, setsPerPool, poolFlags, poolRatios);
+}
+
+// *************** Descriptor Allocator *********************
+
+DescriptorAllocator::DescriptorAllocator(Engine::Device &device, uint32_t setsPerPool, vk::DescriptorPoolCreateFlags poolFlags, const std::vector<std::pair<vk::DescriptorType, float>> &poolRatios)
+    : device{device}, setsPerPool{setsPerPool}, poolFlags{poolFlags}, poolRatios{poolRatios} {
+    assert(setsPerPool > 0 && "Descriptor allocator needs at least one set per pool");
+    assert(!poolRatios.empty() && "Descriptor allocator needs at least one pool ratio");
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+    for (auto pool : usedPools) {
+        device.deferDestroy(pool);
+    }
+    for (auto pool : freePools) {
+        device.deferDestroy(pool);
+    }
+}
+
+bool DescriptorAllocator::allocateDescriptor(const vk::DescriptorSetLayout descriptorSetLayout, vk::DescriptorSet &descriptor) {
+    if (!currentPool) {
+        currentPool = grabPool();
+    }
+
+    vk::DescriptorSetAllocateInfo allocInfo{currentPool, 1, &descriptorSetLayout};
+    vk::Result result = device.device().allocateDescriptorSets(&allocInfo, &descriptor);
+
+    // current pool is full, chain a new one and retry once
+    if (result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool) {
+        currentPool = grabPool();
+        allocInfo.setDescriptorPool(currentPool);
+        result = device.device().allocateDescriptorSets(&allocInfo, &descriptor);
+    }
+
+    return result == vk::Result::eSuccess;
+}
+
+void DescriptorAllocator::resetPools() {
+    for (auto pool : usedPools) {
+        device.device().resetDescriptorPool(pool, {});
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = nullptr;
+}
+
+vk::DescriptorPool DescriptorAllocator::grabPool() {
+    vk::DescriptorPool pool;
+    if (!freePools.empty()) {
+        pool = freePools.back();
+        freePools.pop_back();
+    } else {
+        pool = createPool();
+    }
+    usedPools.push_back(pool);
+    return pool;
+}
+
+vk::DescriptorPool DescriptorAllocator::createPool() {
+    std::vector<vk::DescriptorPoolSize> poolSizes{};
+    poolSizes.reserve(poolRatios.size());
+    for (auto &ratio : poolRatios) {
+        poolSizes.push_back({ratio.first, std::max(1u, static_cast<uint32_t>(ratio.second * setsPerPool))});
+    }
+
+    vk::DescriptorPoolCreateInfo descriptorPoolInfo{poolFlags, setsPerPool, static_cast<uint32_t>(poolSizes.size()), poolSizes.data()};
+
+    vk::DescriptorPool pool;
+    if (device.device().createDescriptorPool(&descriptorPoolInfo, nullptr, &pool) != vk::Result::eSuccess) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    return pool;
+}
+
 // *************** Descriptor Writer *********************
  
-DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool) : setLayout{setLayout}, pool{pool} {}
+DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool) : setLayout{setLayout}, pool{&pool} {}
+
+DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorAllocator &allocator) : setLayout{setLayout}, allocator{&allocator} {}
  
 DescriptorWriter &DescriptorWriter::writeBuffer(uint32_t binding, vk::DescriptorBufferInfo *bufferInfo) {
     assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
@@ -135,7 +247,8 @@ DescriptorWriter &DescriptorWriter::writeImage(uint32_t binding, vk::DescriptorI
 }
  
 bool DescriptorWriter::build(vk::DescriptorSet &set) {
-    bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+    bool success = pool ? pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)
+        : allocator->allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
     if (!success) {
         return false;
     }
@@ -147,6 +260,6 @@ void DescriptorWriter::overwrite(vk::DescriptorSet &set) {
     for (auto &write : writes) {
         write.dstSet = set;
     }
-    pool.device.device().updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+    setLayout.device.device().updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
 }
 }
\ No newline at end of file
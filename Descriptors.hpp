@@ -19,16 +19,23 @@ namespace Engine {
                 uint32_t binding,
                 vk::DescriptorType descriptorType,
                 vk::ShaderStageFlags stageFlags,
-                uint32_t count = 1);
+                uint32_t count = 1,
+                vk::DescriptorBindingFlags bindingFlags = {});
+            Builder &setLayoutFlags(vk::DescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<DescriptorSetLayout> build() const;
         
         private:
             Device &device;
             std::unordered_map<uint32_t, vk::DescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, vk::DescriptorBindingFlags> bindingFlags{};
+            vk::DescriptorSetLayoutCreateFlags layoutFlags = {};
         };
     
         DescriptorSetLayout(
-            Device &Device, std::unordered_map<uint32_t, vk::DescriptorSetLayoutBinding> bindings);
+            Device &Device,
+            std::unordered_map<uint32_t, vk::DescriptorSetLayoutBinding> bindings,
+            std::unordered_map<uint32_t, vk::DescriptorBindingFlags> bindingFlags = {},
+            vk::DescriptorSetLayoutCreateFlags layoutFlags = {});
         ~DescriptorSetLayout();
         DescriptorSetLayout(const DescriptorSetLayout &) = delete;
         DescriptorSetLayout &operator=(const DescriptorSetLayout &) = delete;
@@ -84,9 +91,60 @@ namespace Engine {
         friend class DescriptorWriter;
     };
         
+    // Growable allocator that chains pools as they fill up. Sets are never freed individually,
+    // all pools are reset at once and recycled (used per frame in flight and for long-lived sets).
+    class DescriptorAllocator {
+        public:
+        class Builder {
+        public:
+            Builder(Device &device) : device{device} {}
+
+            Builder &addPoolRatio(vk::DescriptorType descriptorType, float ratio);
+            Builder &setPoolFlags(vk::DescriptorPoolCreateFlags flags);
+            Builder &setSetsPerPool(uint32_t count);
+            std::unique_ptr<DescriptorAllocator> build() const;
+
+        private:
+            Device &device;
+            std::vector<std::pair<vk::DescriptorType, float>> poolRatios{};
+            uint32_t setsPerPool = 1000;
+            vk::DescriptorPoolCreateFlags poolFlags = {};
+        };
+
+        DescriptorAllocator(
+            Device &device,
+            uint32_t setsPerPool,
+            vk::DescriptorPoolCreateFlags poolFlags,
+            const std::vector<std::pair<vk::DescriptorType, float>> &poolRatios);
+        ~DescriptorAllocator();
+        DescriptorAllocator(const DescriptorAllocator &) = delete;
+        DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+        bool allocateDescriptor(
+            const vk::DescriptorSetLayout descriptorSetLayout, vk::DescriptorSet &descriptor);
+
+        void resetPools();
+
+        size_t poolCount() const { return usedPools.size() + freePools.size(); }
+
+        private:
+        vk::DescriptorPool grabPool();
+        vk::DescriptorPool createPool();
+
+        Device &device;
+        uint32_t setsPerPool;
+        vk::DescriptorPoolCreateFlags poolFlags;
+        std::vector<std::pair<vk::DescriptorType, float>> poolRatios;
+
+        vk::DescriptorPool currentPool = nullptr;
+        std::vector<vk::DescriptorPool> usedPools;
+        std::vector<vk::DescriptorPool> freePools;
+    };
+
     class DescriptorWriter {
         public:
         DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
+        DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorAllocator &allocator);
         
         DescriptorWriter &writeBuffer(uint32_t binding, vk::DescriptorBufferInfo *bufferInfo);
         DescriptorWriter &writeImage(uint32_t binding, vk::DescriptorImageInfo *imageInfo);
@@ -96,7 +154,8 @@ namespace Engine {
         
         private:
         DescriptorSetLayout &setLayout;
-        DescriptorPool &pool;
+        DescriptorPool *pool = nullptr;
+        DescriptorAllocator *allocator = nullptr;
         std::vector<vk::WriteDescriptorSet> writes;
     };
 }
\ No newline at end of file
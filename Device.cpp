@@ -1,6 +1,10 @@
 #include "Device.hpp"
 
+#include "SamplerCache.hpp"
+#include "UploadQueue.hpp"
+
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -20,24 +24,46 @@ namespace Engine {
     }
 
     // class member functions
-    Device::Device(Window &window) : window{window} {
+    Device::Device(Window *window) : window{window} {
+        if (!isHeadless()) {
+            deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+
         createInstance();
         setupDebugMessenger();
-        createSurface();
+        if (!isHeadless()) {
+            createSurface();
+        }
         pickPhysicalDevice();
         createLogicalDevice();
-        createCommandPool();
+        memoryTracker_ = std::make_unique<MemoryTracker>(physicalDevice, memoryBudgetEnabled);
+        createCommandPools();
+        frameScheduler_ = std::make_unique<FrameScheduler>(device_);
+        deletionQueue_ = std::make_unique<DeletionQueue>(*frameScheduler_);
+        createGpuProfiler();
+        uploadQueue_ = std::make_unique<UploadQueue>(*this);
+        samplerCache_ = std::make_unique<SamplerCache>(device_);
     }
 
     Device::~Device() {
-        device_.destroyCommandPool(commandPool, nullptr);
+        // objects released by their owners may still be referenced by in-flight frames
+        device_.waitIdle();
+        // releases staging buffers into the deletion queue
+        uploadQueue_.reset();
+        deletionQueue_.reset();
+        samplerCache_.reset();
+        gpuProfiler_.reset();
+        frameScheduler_.reset();
+        device_.destroyCommandPool(transferCommandPool, nullptr);
         device_.destroy(nullptr);
 
         if (enableValidationLayers) {
             instance.destroyDebugUtilsMessengerEXT(debugMessenger, nullptr, vk::DispatchLoaderDynamic(instance, vkGetInstanceProcAddr));
         }
 
-        instance.destroySurfaceKHR(surface_, nullptr);
+        if (surface_) {
+            instance.destroySurfaceKHR(surface_, nullptr);
+        }
         instance.destroy(nullptr);
     }
 
@@ -96,6 +122,23 @@ namespace Engine {
 
         physicalDevice.getProperties(&properties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
+
+        vk::PhysicalDeviceProperties2 properties2{};
+        properties2.setPNext(&descriptorIndexingProperties);
+        physicalDevice.getProperties2(&properties2);
+
+        // optional, without it the memory tracker reports heap sizes as budget
+        uint32_t extensionCount;
+        physicalDevice.enumerateDeviceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<vk::ExtensionProperties> availableExtensions(extensionCount);
+        physicalDevice.enumerateDeviceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+        for (const auto &extension : availableExtensions) {
+            if (std::string(extension.extensionName) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) {
+                memoryBudgetEnabled = true;
+                deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                break;
+            }
+        }
     }
 
     void Device::createLogicalDevice() {
@@ -103,6 +146,12 @@ namespace Engine {
 
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+        if (indices.transferFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.transferFamily);
+        }
+        if (indices.computeFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.computeFamily);
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -113,7 +162,46 @@ namespace Engine {
         vk::PhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.setSamplerAnisotropy(true);
 
+        vk::PhysicalDeviceVulkan12Features supported12{};
+        vk::PhysicalDeviceFeatures2 supported{};
+        supported.setPNext(&supported12);
+        physicalDevice.getFeatures2(&supported);
+
+        // virtual texture feedback is written from fragment shaders
+        fragmentStoresEnabled = supported.features.fragmentStoresAndAtomics;
+        deviceFeatures.setFragmentStoresAndAtomics(fragmentStoresEnabled);
+        // post processing writes the swapchain format, which has no glsl format qualifier for bgra
+        storageWriteWithoutFormatEnabled = supported.features.shaderStorageImageWriteWithoutFormat;
+        deviceFeatures.setShaderStorageImageWriteWithoutFormat(storageWriteWithoutFormatEnabled);
+
+        // frame pacing is built on timeline semaphores, required by every 1.2 implementation
+        vk::PhysicalDeviceVulkan12Features features12{};
+        features12.setTimelineSemaphore(true);
+
+        // lets the gpu profiler reset its queries on the host, so async compute can write them before the graphics submit
+        hostQueryResetEnabled = supported12.hostQueryReset;
+        features12.setHostQueryReset(hostQueryResetEnabled);
+
+        descriptorIndexingEnabled = supported12.descriptorIndexing &&
+            supported12.runtimeDescriptorArray &&
+            supported12.descriptorBindingPartiallyBound &&
+            supported12.descriptorBindingUpdateUnusedWhilePending &&
+            supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+            supported12.descriptorBindingSampledImageUpdateAfterBind &&
+            supported12.shaderSampledImageArrayNonUniformIndexing;
+        if (descriptorIndexingEnabled) {
+            features12.setDescriptorIndexing(true);
+            features12.setRuntimeDescriptorArray(true);
+            features12.setDescriptorBindingPartiallyBound(true);
+            features12.setDescriptorBindingUpdateUnusedWhilePending(true);
+            features12.setDescriptorBindingStorageBufferUpdateAfterBind(true);
+            features12.setDescriptorBindingSampledImageUpdateAfterBind(true);
+            features12.setShaderSampledImageArrayNonUniformIndexing(true);
+        }
+        std::cout << "bindless descriptors: " << (descriptorIndexingEnabled ? "enabled" : "unsupported") << std::endl;
+
         vk::DeviceCreateInfo createInfo{};
+        createInfo.setPNext(&features12);
 
         createInfo.setQueueCreateInfoCount(static_cast<uint32_t>(queueCreateInfos.size()));
         createInfo.setPQueueCreateInfos(queueCreateInfos.data());
@@ -137,27 +225,82 @@ namespace Engine {
 
         device_.getQueue(indices.graphicsFamily, 0, &graphicsQueue_);
         device_.getQueue(indices.presentFamily, 0, &presentQueue_);
+        device_.getQueue(indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily, 0, &transferQueue_);
+        std::cout << "upload queue: " << (indices.transferFamilyHasValue ? "dedicated transfer family" : "graphics") << std::endl;
+
+        if (indices.computeFamilyHasValue) {
+            asyncComputeFamily = indices.computeFamily;
+            sharedQueueFamilies = {indices.graphicsFamily, indices.computeFamily};
+        }
+        device_.getQueue(indices.computeFamilyHasValue ? indices.computeFamily : indices.graphicsFamily, 0, &computeQueue_);
+        std::cout << "compute queue: " << (indices.computeFamilyHasValue ? "async" : "graphics") << std::endl;
+    }
+
+    void Device::createCommandPools() {
+        // single time upload commands get their own pool so they never contend with frame recording
+        transferCommandPool = createCommandPool(vk::CommandPoolCreateFlagBits::eTransient);
     }
 
-    void Device::createCommandPool() {
+    void Device::createGpuProfiler() {
+        QueueFamilyIndices indices = findPhysicalQueueFamilies();
+        std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
+        uint32_t timestampValidBits = queueFamilies[indices.graphicsFamily].timestampValidBits;
+
+        // async compute scopes write into the frame's queries before the graphics submit, which needs host resets
+        bool computeTimestamps = false;
+        if (asyncComputeFamily && hostQueryResetEnabled) {
+            uint32_t computeValidBits = queueFamilies[*asyncComputeFamily].timestampValidBits;
+            computeTimestamps = computeValidBits > 0;
+            if (computeTimestamps) {
+                timestampValidBits = std::min(timestampValidBits, computeValidBits);
+            }
+        }
+
+        const vk::DispatchLoaderDynamic *debugUtils = nullptr;
+        if (enableValidationLayers) {
+            debugUtilsDispatch.init(instance, vkGetInstanceProcAddr, device_, vkGetDeviceProcAddr);
+            debugUtils = &debugUtilsDispatch;
+        }
+
+        gpuProfiler_ = std::make_unique<GpuProfiler>(device_, *frameScheduler_, properties.limits.timestampPeriod, timestampValidBits, hostQueryResetEnabled, computeTimestamps, debugUtils);
+    }
+
+    vk::CommandPool Device::createCommandPool(vk::CommandPoolCreateFlags flags) {
         QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
 
-        vk::CommandPoolCreateInfo poolInfo{{vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer}, queueFamilyIndices.graphicsFamily};
+        vk::CommandPoolCreateInfo poolInfo{flags, queueFamilyIndices.graphicsFamily};
 
-        if (device_.createCommandPool(&poolInfo, nullptr, &commandPool) != vk::Result::eSuccess) {
+        vk::CommandPool pool;
+        if (device_.createCommandPool(&poolInfo, nullptr, &pool) != vk::Result::eSuccess) {
             throw std::runtime_error("failed to create command pool!");
         }
+        return pool;
     }
 
-    void Device::createSurface() { window.createWindowSurface(instance, &surface_); }
+    vk::CommandPool Device::createComputeCommandPool(vk::CommandPoolCreateFlags flags) {
+        if (!asyncComputeFamily) {
+            return createCommandPool(flags);
+        }
+
+        vk::CommandPoolCreateInfo poolInfo{flags, *asyncComputeFamily};
+
+        vk::CommandPool pool;
+        if (device_.createCommandPool(&poolInfo, nullptr, &pool) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create compute command pool!");
+        }
+        return pool;
+    }
+
+    void Device::createSurface() { window->createWindowSurface(instance, &surface_); }
 
     bool Device::isDeviceSuitable(vk::PhysicalDevice device) {
         QueueFamilyIndices indices = findQueueFamilies(device);
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        // headless rendering never presents, so any device that can draw is fine
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -165,8 +308,11 @@ namespace Engine {
         vk::PhysicalDeviceFeatures supportedFeatures;
         device.getFeatures(&supportedFeatures);
 
+        vk::PhysicalDeviceProperties deviceProperties;
+        device.getProperties(&deviceProperties);
+
         return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-                supportedFeatures.samplerAnisotropy;
+                supportedFeatures.samplerAnisotropy && deviceProperties.apiVersion >= VK_API_VERSION_1_2;
     }
 
     void Device::populateDebugMessengerCreateInfo(vk::DebugUtilsMessengerCreateInfoEXT &createInfo) {
@@ -211,10 +357,13 @@ namespace Engine {
     }
 
     std::vector<const char *> Device::getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        SDL_Vulkan_GetInstanceExtensions(window.getSDLwindow(), &extensionCount, nullptr);
-        std::vector<const char *> extensions(extensionCount);
-        SDL_Vulkan_GetInstanceExtensions(window.getSDLwindow(), &extensionCount, extensions.data());
+        std::vector<const char *> extensions;
+        if (!isHeadless()) {
+            uint32_t extensionCount = 0;
+            SDL_Vulkan_GetInstanceExtensions(window->getSDLwindow(), &extensionCount, nullptr);
+            extensions.resize(extensionCount);
+            SDL_Vulkan_GetInstanceExtensions(window->getSDLwindow(), &extensionCount, extensions.data());
+        }
 
 
         if (enableValidationLayers) {
@@ -274,18 +423,36 @@ namespace Engine {
 
         int i = 0;
         for (const auto &queueFamily : queueFamilies) {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
-                indices.graphicsFamily = i;
-                indices.graphicsFamilyHasValue = true;
+            // dma engines expose families with neither graphics nor compute support
+            vk::QueueFlags transferOnlyMask = vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute;
+            if (!indices.transferFamilyHasValue && queueFamily.queueCount > 0 &&
+                (queueFamily.queueFlags & transferOnlyMask) == vk::QueueFlagBits::eTransfer) {
+                indices.transferFamily = i;
+                indices.transferFamilyHasValue = true;
             }
-            vk::Bool32 presentSupport = false;
-            device.getSurfaceSupportKHR(i, surface_, &presentSupport);
-            if (queueFamily.queueCount > 0 && presentSupport) {
-                indices.presentFamily = i;
-                indices.presentFamilyHasValue = true;
+
+            if (!indices.computeFamilyHasValue && queueFamily.queueCount > 0 &&
+                (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) && !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)) {
+                indices.computeFamily = i;
+                indices.computeFamilyHasValue = true;
             }
-            if (indices.isComplete()) {
-                break;
+
+            if (!indices.isComplete()) {
+                if (queueFamily.queueCount > 0 && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+                    indices.graphicsFamily = i;
+                    indices.graphicsFamilyHasValue = true;
+                }
+                vk::Bool32 presentSupport = false;
+                if (isHeadless()) {
+                    // nothing is presented, the graphics queue stands in for the present queue
+                    presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == i;
+                } else {
+                    device.getSurfaceSupportKHR(i, surface_, &presentSupport);
+                }
+                if (queueFamily.queueCount > 0 && presentSupport) {
+                    indices.presentFamily = i;
+                    indices.presentFamilyHasValue = true;
+                }
             }
 
             i++;
@@ -319,32 +486,58 @@ namespace Engine {
     vk::Format Device::findSupportedFormat(
         const std::vector<vk::Format> &candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features) {
         for (vk::Format format : candidates) {
-            vk::FormatProperties props;
-            physicalDevice.getFormatProperties(format, &props);
-
-            if (tiling == vk::ImageTiling::eLinear && (props.linearTilingFeatures & features) == features) {
-                return format;
-            } else if (
-                tiling == vk::ImageTiling::eOptimal && (props.optimalTilingFeatures & features) == features) {
+            if (supportsFormat(format, tiling, features)) {
                 return format;
             }
         }
         throw std::runtime_error("failed to find supported format!");
     }
 
-    uint32_t Device::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
-        vk::PhysicalDeviceMemoryProperties memProperties;
-        physicalDevice.getMemoryProperties(&memProperties);
+    bool Device::supportsFormat(vk::Format format, vk::ImageTiling tiling, vk::FormatFeatureFlags features) {
+        vk::FormatProperties props;
+        physicalDevice.getFormatProperties(format, &props);
+
+        if (tiling == vk::ImageTiling::eLinear) {
+            return (props.linearTilingFeatures & features) == features;
+        }
+        return (props.optimalTilingFeatures & features) == features;
+    }
+
+    uint32_t Device::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::DeviceSize size) {
+        const vk::PhysicalDeviceMemoryProperties &memProperties = memoryTracker_->getMemoryProperties();
+        MemoryTracker::Stats stats = memoryTracker_->getStats();
+
+        uint32_t firstMatch = memProperties.memoryTypeCount;
         for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
             if ((typeFilter & (1 << i)) &&
                 (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
+                const MemoryTracker::HeapStats &heap = stats.heaps[memProperties.memoryTypes[i].heapIndex];
+                if (heap.usage + size <= heap.budget) {
+                    return i;
+                }
+                if (firstMatch == memProperties.memoryTypeCount) {
+                    firstMatch = i;
+                }
             }
         }
 
+        // every matching heap is over budget, let the driver decide whether it can still allocate
+        if (firstMatch != memProperties.memoryTypeCount) {
+            return firstMatch;
+        }
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
+    bool Device::hasMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
+        const vk::PhysicalDeviceMemoryProperties &memProperties = memoryTracker_->getMemoryProperties();
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void Device::createBuffer(
         vk::DeviceSize size,
         vk::BufferUsageFlags usage,
@@ -352,6 +545,12 @@ namespace Engine {
         vk::Buffer &buffer,
         vk::DeviceMemory &bufferMemory) {
         vk::BufferCreateInfo bufferInfo{{}, size, usage, vk::SharingMode::eExclusive};
+        // written by async compute and read by graphics without ownership transfers
+        if (!sharedQueueFamilies.empty() && (usage & vk::BufferUsageFlagBits::eStorageBuffer)) {
+            bufferInfo.setSharingMode(vk::SharingMode::eConcurrent);
+            bufferInfo.setQueueFamilyIndexCount(static_cast<uint32_t>(sharedQueueFamilies.size()));
+            bufferInfo.setPQueueFamilyIndices(sharedQueueFamilies.data());
+        }
 
         if (device_.createBuffer(&bufferInfo, nullptr, &buffer) != vk::Result::eSuccess) {
             throw std::runtime_error("failed to create vertex buffer!");
@@ -360,17 +559,13 @@ namespace Engine {
         vk::MemoryRequirements memRequirements;
         device_.getBufferMemoryRequirements(buffer, &memRequirements);
 
-        vk::MemoryAllocateInfo allocInfo{memRequirements.size, findMemoryType(memRequirements.memoryTypeBits, properties)};
-
-        if (device_.allocateMemory(&allocInfo, nullptr, &bufferMemory) != vk::Result::eSuccess) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
-        }
+        bufferMemory = allocateMemory(memRequirements, properties, MemoryTracker::categorize(usage, properties));
 
         device_.bindBufferMemory(buffer, bufferMemory, 0);
     }
 
     vk::CommandBuffer Device::beginSingleTimeCommands() {
-        vk::CommandBufferAllocateInfo allocInfo{commandPool, vk::CommandBufferLevel::ePrimary, 1};
+        vk::CommandBufferAllocateInfo allocInfo{transferCommandPool, vk::CommandBufferLevel::ePrimary, 1};
 
         vk::CommandBuffer commandBuffer;
         device_.allocateCommandBuffers(&allocInfo, &commandBuffer);
@@ -388,7 +583,7 @@ namespace Engine {
         graphicsQueue_.submit(1, &submitInfo, nullptr);
         graphicsQueue_.waitIdle();
 
-        device_.freeCommandBuffers(commandPool, 1, &commandBuffer);
+        device_.freeCommandBuffers(transferCommandPool, 1, &commandBuffer);
     }
 
     void Device::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size) {
@@ -416,19 +611,73 @@ namespace Engine {
         vk::MemoryPropertyFlags properties,
         vk::Image &image,
         vk::DeviceMemory &imageMemory) {
-        if (device_.createImage(&imageInfo, nullptr, &image) != vk::Result::eSuccess) {
+        vk::ImageCreateInfo createInfo = imageInfo;
+        if (!sharedQueueFamilies.empty() && (imageInfo.usage & vk::ImageUsageFlagBits::eStorage)) {
+            createInfo.setSharingMode(vk::SharingMode::eConcurrent);
+            createInfo.setQueueFamilyIndexCount(static_cast<uint32_t>(sharedQueueFamilies.size()));
+            createInfo.setPQueueFamilyIndices(sharedQueueFamilies.data());
+        }
+
+        if (device_.createImage(&createInfo, nullptr, &image) != vk::Result::eSuccess) {
             throw std::runtime_error("failed to create image!");
         }
 
         vk::MemoryRequirements memRequirements;
         device_.getImageMemoryRequirements(image, &memRequirements);
 
-        vk::MemoryAllocateInfo allocInfo{memRequirements.size, findMemoryType(memRequirements.memoryTypeBits, properties)};
+        imageMemory = allocateMemory(memRequirements, properties, MemoryTracker::categorize(imageInfo.usage));
+
+        device_.bindImageMemory(image, imageMemory, 0);
+    }
+
+    vk::DeviceMemory Device::allocateMemory(const vk::MemoryRequirements &requirements, vk::MemoryPropertyFlags properties, MemoryCategory category) {
+        vk::MemoryAllocateInfo allocInfo{requirements.size, findMemoryType(requirements.memoryTypeBits, properties, requirements.size)};
 
-        if (device_.allocateMemory(&allocInfo, nullptr, &imageMemory) != vk::Result::eSuccess) {
-            throw std::runtime_error("failed to allocate image memory!");
+        vk::DeviceMemory memory;
+        if (device_.allocateMemory(&allocInfo, nullptr, &memory) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to allocate device memory!");
         }
+        memoryTracker_->trackAllocation(memory, allocInfo.allocationSize, allocInfo.memoryTypeIndex, category);
+        return memory;
+    }
 
-        device_.bindImageMemory(image, imageMemory, 0);
+    void Device::freeMemory(vk::DeviceMemory memory) {
+        memoryTracker_->trackFree(memory);
+        device_.freeMemory(memory, nullptr);
+    }
+
+    void Device::deferDestroy(vk::Buffer buffer, vk::DeviceMemory memory) {
+        deletionQueue_->push([this, buffer, memory]() {
+            device_.destroyBuffer(buffer, nullptr);
+            freeMemory(memory);
+        });
+    }
+
+    void Device::deferDestroy(vk::Image image, vk::ImageView imageView, vk::DeviceMemory memory) {
+        deletionQueue_->push([this, image, imageView, memory]() {
+            if (imageView) {
+                device_.destroyImageView(imageView, nullptr);
+            }
+            device_.destroyImage(image, nullptr);
+            freeMemory(memory);
+        });
+    }
+
+    void Device::deferDestroy(vk::Pipeline pipeline) {
+        deletionQueue_->push([device = device_, pipeline]() { device.destroyPipeline(pipeline, nullptr); });
+    }
+
+    void Device::deferDestroy(vk::PipelineLayout pipelineLayout) {
+        deletionQueue_->push([device = device_, pipelineLayout]() { device.destroyPipelineLayout(pipelineLayout, nullptr); });
+    }
+
+    void Device::deferDestroy(vk::DescriptorPool descriptorPool) {
+        deletionQueue_->push([device = device_, descriptorPool]() { device.destroyDescriptorPool(descriptorPool, nullptr); });
+    }
+
+    void Device::deferFree(vk::DescriptorPool descriptorPool, std::vector<vk::DescriptorSet> descriptorSets) {
+        deletionQueue_->push([device = device_, descriptorPool, descriptorSets = std::move(descriptorSets)]() {
+            device.freeDescriptorSets(descriptorPool, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data());
+        });
     }
-}
\ No newline at end of file
+}
@@ -1,13 +1,22 @@
 #pragma once
 
+#include "DeletionQueue.hpp"
+#include "FrameScheduler.hpp"
+#include "GpuProfiler.hpp"
+#include "MemoryTracker.hpp"
 #include "Window.hpp"
 
 // std lib headers
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 namespace Engine {
 
+    class SamplerCache;
+    class UploadQueue;
+
     struct SwapChainSupportDetails {
         vk::SurfaceCapabilitiesKHR capabilities;
         std::vector<vk::SurfaceFormatKHR> formats;
@@ -17,8 +26,14 @@ namespace Engine {
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        // only set for a transfer-only family, uploads fall back to the graphics queue otherwise
+        uint32_t transferFamily;
+        // only set for a compute family without graphics, async compute falls back to the graphics queue otherwise
+        uint32_t computeFamily;
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool transferFamilyHasValue = false;
+        bool computeFamilyHasValue = false;
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
@@ -30,7 +45,9 @@ namespace Engine {
             const bool enableValidationLayers = true;
         #endif
 
-        Device(Window &window);
+        Device(Window &window) : Device(&window) {}
+        // Without a window no surface or swapchain extension is used, frames are rendered offscreen
+        explicit Device(Window *window);
         ~Device();
 
         // Not copyable or movable
@@ -39,25 +56,45 @@ namespace Engine {
         Device(Device &&) = delete;
         Device &operator=(Device &&) = delete;
 
-        vk::CommandPool getCommandPool() { return commandPool; }
+        vk::CommandPool getTransferCommandPool() { return transferCommandPool; }
         vk::Device device() { return device_; }
         vk::SurfaceKHR surface() { return surface_; }
+        bool isHeadless() const { return window == nullptr; }
         vk::Queue graphicsQueue() { return graphicsQueue_; }
         vk::Queue presentQueue() { return presentQueue_; }
+        // the graphics queue without a transfer-only family, only UploadQueue submits to it
+        vk::Queue transferQueue() { return transferQueue_; }
+        // the graphics queue without a separate compute family
+        vk::Queue computeQueue() { return computeQueue_; }
+        bool hasAsyncCompute() const { return asyncComputeFamily.has_value(); }
+        FrameScheduler &frameScheduler() { return *frameScheduler_; }
+        DeletionQueue &deletionQueue() { return *deletionQueue_; }
+        GpuProfiler &gpuProfiler() { return *gpuProfiler_; }
+        MemoryTracker &memoryTracker() { return *memoryTracker_; }
+        UploadQueue &uploadQueue() { return *uploadQueue_; }
+        SamplerCache &samplerCache() { return *samplerCache_; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
-        uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+        // Prefers a memory type whose heap still has size bytes of budget left, falls back to the first match
+        uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::DeviceSize size = 0);
+        bool hasMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
         vk::Format findSupportedFormat(
             const std::vector<vk::Format> &candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
+        bool supportsFormat(vk::Format format, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
 
-        // Buffer Helper Functions
+        // Buffer Helper Functions, storage buffers and images are shared concurrently with the async compute family
         void createBuffer(
             vk::DeviceSize size,
             vk::BufferUsageFlags usage,
             vk::MemoryPropertyFlags properties,
             vk::Buffer &buffer,
             vk::DeviceMemory &bufferMemory);
+        // Pools on the graphics family, owners reset them wholesale with resetCommandPool
+        vk::CommandPool createCommandPool(vk::CommandPoolCreateFlags flags = vk::CommandPoolCreateFlagBits::eTransient);
+        // Pool for command buffers submitted to computeQueue
+        vk::CommandPool createComputeCommandPool(vk::CommandPoolCreateFlags flags = vk::CommandPoolCreateFlagBits::eTransient);
+
         vk::CommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(vk::CommandBuffer commandBuffer);
         void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
@@ -70,7 +107,26 @@ namespace Engine {
             vk::Image &image,
             vk::DeviceMemory &imageMemory);
 
+        // Tracked allocation for resources that bind memory themselves, e.g. aliased images
+        vk::DeviceMemory allocateMemory(const vk::MemoryRequirements &requirements, vk::MemoryPropertyFlags properties, MemoryCategory category);
+        // Memory from allocateMemory, createBuffer and createImageWithInfo has to be released here so the tracker sees it
+        void freeMemory(vk::DeviceMemory memory);
+
+        // Destroy once every frame that may reference the object has completed, never stalls
+        void deferDestroy(vk::Buffer buffer, vk::DeviceMemory memory);
+        void deferDestroy(vk::Image image, vk::ImageView imageView, vk::DeviceMemory memory);
+        void deferDestroy(vk::Pipeline pipeline);
+        void deferDestroy(vk::PipelineLayout pipelineLayout);
+        void deferDestroy(vk::DescriptorPool descriptorPool);
+        void deferFree(vk::DescriptorPool descriptorPool, std::vector<vk::DescriptorSet> descriptorSets);
+
+        // VK_EXT_descriptor_indexing (core in 1.2) features needed for update-after-bind arrays
+        bool supportsBindless() const { return descriptorIndexingEnabled; }
+        bool supportsFragmentStores() const { return fragmentStoresEnabled; }
+        bool supportsStorageWriteWithoutFormat() const { return storageWriteWithoutFormatEnabled; }
+
         vk::PhysicalDeviceProperties properties;
+        vk::PhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties;
 
         private:
         void createInstance();
@@ -78,7 +134,8 @@ namespace Engine {
         void createSurface();
         void pickPhysicalDevice();
         void createLogicalDevice();
-        void createCommandPool();
+        void createCommandPools();
+        void createGpuProfiler();
 
         // helper functions
         bool isDeviceSuitable(vk::PhysicalDevice device);
@@ -93,15 +150,34 @@ namespace Engine {
         vk::Instance instance;
         vk::DebugUtilsMessengerEXT debugMessenger;
         vk::PhysicalDevice physicalDevice;
-        Window &window;
-        vk::CommandPool commandPool;
+        Window *window;
+        vk::CommandPool transferCommandPool;
+
+        bool descriptorIndexingEnabled = false;
+        bool fragmentStoresEnabled = false;
+        bool storageWriteWithoutFormatEnabled = false;
+        bool memoryBudgetEnabled = false;
+        bool hostQueryResetEnabled = false;
+        std::optional<uint32_t> asyncComputeFamily;
+        // graphics and async compute family for resources both queues access
+        std::vector<uint32_t> sharedQueueFamilies;
 
         vk::Device device_;
         vk::SurfaceKHR surface_;
         vk::Queue graphicsQueue_;
         vk::Queue presentQueue_;
+        vk::Queue transferQueue_;
+        vk::Queue computeQueue_;
+        std::unique_ptr<FrameScheduler> frameScheduler_;
+        std::unique_ptr<DeletionQueue> deletionQueue_;
+        std::unique_ptr<GpuProfiler> gpuProfiler_;
+        std::unique_ptr<MemoryTracker> memoryTracker_;
+        std::unique_ptr<UploadQueue> uploadQueue_;
+        std::unique_ptr<SamplerCache> samplerCache_;
+        // device level VK_EXT_debug_utils entry points, only loaded with validation layers enabled
+        vk::DispatchLoaderDynamic debugUtilsDispatch;
 
         const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-        const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        std::vector<const char *> deviceExtensions;
     };
 }
@@ -1,17 +1,44 @@
 #pragma once
 
 #include "Camera.hpp"
+#include "Descriptors.hpp"
 #include "GameObject.hpp"
+#include "UniformRingBuffer.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+// std
+#include <array>
+
 namespace Engine {
+    // keep in sync with Shading.glsl
+    constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+
+    struct GlobalUbo {
+        glm::mat4 projectionView{1.f};
+        glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .02f};
+        // direction the light travels in, w unused
+        glm::vec4 directionalLightDirection{0.f, 1.f, 0.f, 0.f};
+        // rgb and intensity
+        glm::vec4 directionalLightColor{1.f, 1.f, 1.f, .6f};
+        // view depth each cascade ends at, see ShadowSystem
+        glm::vec4 cascadeSplits{};
+        glm::mat4 cascadeViewProjections[SHADOW_CASCADE_COUNT]{};
+    };
+
     struct FrameInfo {
         int frameIndex;
         float frameTime;
         vk::CommandBuffer commandBuffer;
         Camera &camera;
         vk::DescriptorSet globalDescriptorSet;
+        uint32_t globalUboOffset;
         GameObject::Map &gameObjects;
+        DescriptorAllocator &frameDescriptorAllocator;
+        UniformRingBuffer &uniformRing;
+        // dynamic offsets of the light and cluster buffers in the global set, see ClusteredLighting
+        std::array<uint32_t, 2> lightingOffsets{};
+        // this frame's region of the virtual texture feedback buffer
+        uint32_t virtualTextureFeedbackOffset = 0;
     };
 }
\ No newline at end of file
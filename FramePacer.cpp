@@ -0,0 +1,96 @@
+#include "FramePacer.hpp"
+
+// std
+#include <algorithm>
+#include <thread>
+
+namespace Engine {
+
+    void FramePacer::waitForFrameStart() {
+        if (settings.lowLatency) {
+            waitForLowLatencyStart();
+        }
+
+        auto now = Clock::now();
+        if (settings.maxFrameRate > 0.f) {
+            auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.f / settings.maxFrameRate));
+            // fell behind by more than a frame, restart the schedule instead of bursting to catch up
+            if (now > nextFrameStart + period) {
+                nextFrameStart = now;
+            }
+            sleepUntil(nextFrameStart);
+            nextFrameStart += period;
+            now = Clock::now();
+        }
+        inputSampleTime = now;
+    }
+
+    void FramePacer::waitForLowLatencyStart() {
+        uint64_t lastSubmitted = scheduler.lastSubmittedFrame();
+        if (lastSubmitted == 0) {
+            return;
+        }
+        if (averageGpuTime == 0.f) {
+            // nothing measured yet, wait for the gpu to drain like a frame rate limited engine would
+            measureFrame(lastSubmitted);
+            return;
+        }
+
+        if (settings.queueAhead && lastSubmitted > 1) {
+            measureFrame(lastSubmitted - 1);
+        }
+        // the previous frame starts on the gpu once its predecessor is done
+        Clock::time_point gpuStart = std::max(submitTimes[lastSubmitted % submitTimes.size()], lastCompletionTime);
+        if (!settings.queueAhead) {
+            measureFrame(lastSubmitted);
+        }
+
+        // record and submit this frame in the time the gpu is predicted to still need for the previous one, but never
+        // before the wait above returned, the estimate may be off
+        Clock::time_point deadline = gpuStart + toDuration(averageGpuTime - averageInputLatency - DEADLINE_MARGIN);
+        sleepUntil(std::max(deadline, Clock::now()));
+    }
+
+    void FramePacer::measureFrame(uint64_t frame) {
+        if (frame <= lastMeasuredFrame) {
+            return;
+        }
+        // only a frame that was still running gives its completion time, one that finished earlier would only bound
+        // it and bias the average either way
+        bool alreadyComplete = scheduler.isFrameComplete(frame);
+        scheduler.waitForFrame(frame);
+        auto now = Clock::now();
+
+        Clock::time_point gpuStart = std::max(submitTimes[frame % submitTimes.size()], lastCompletionTime);
+        float gpuTime = std::chrono::duration<float, std::chrono::milliseconds::period>(now - gpuStart).count();
+        if (averageGpuTime == 0.f) {
+            averageGpuTime = gpuTime;
+        } else if (!alreadyComplete) {
+            averageGpuTime = averageGpuTime * .9f + gpuTime * .1f;
+        }
+        lastCompletionTime = now;
+        lastMeasuredFrame = frame;
+    }
+
+    void FramePacer::frameSubmitted() {
+        submitTimes[scheduler.lastSubmittedFrame() % submitTimes.size()] = Clock::now();
+        lastInputLatency = std::chrono::duration<float, std::chrono::milliseconds::period>(Clock::now() - inputSampleTime).count();
+        averageInputLatency = averageInputLatency == 0.f ? lastInputLatency : averageInputLatency * .95f + lastInputLatency * .05f;
+    }
+
+    FramePacer::Clock::duration FramePacer::toDuration(float milliseconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::chrono::milliseconds::period>(milliseconds));
+    }
+
+    void FramePacer::sleepUntil(Clock::time_point deadline) {
+        // the OS sleep overshoots, so sleep coarse and spin the last millisecond
+        constexpr auto spinThreshold = std::chrono::milliseconds(1);
+        auto now = Clock::now();
+        if (deadline - now > spinThreshold) {
+            std::this_thread::sleep_until(deadline - spinThreshold);
+        }
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "FrameScheduler.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <array>
+#include <chrono>
+
+namespace Engine {
+
+    struct FramePacingSettings {
+        // sample input as late as the gpu allows instead of queueing frames ahead of it
+        bool lowLatency = false;
+        // in low-latency mode, start recording while the previous frame is still on the gpu so it never idles between
+        // frames, at the cost of up to a frame of latency when the gpu time estimate is off
+        bool queueAhead = false;
+        vk::PresentModeKHR presentMode = vk::PresentModeKHR::eMailbox;
+        // 0 disables the cap
+        float maxFrameRate = 0.f;
+        // print the measured input to submit latency of every frame
+        bool reportLatency = false;
+    };
+
+    class FramePacer {
+        public:
+        using Clock = std::chrono::steady_clock;
+
+        FramePacer(FrameScheduler &scheduler) : scheduler{scheduler} {}
+
+        FramePacer(const FramePacer &) = delete;
+        FramePacer &operator=(const FramePacer &) = delete;
+
+        void setSettings(const FramePacingSettings &newSettings) { settings = newSettings; }
+        const FramePacingSettings &getSettings() const { return settings; }
+
+        // Call before input is polled. Sleeps until the predicted start of the next frame and marks the input sample time.
+        // In low-latency mode it first waits for the previous frame to complete, so no frame ever queues behind another,
+        // then sleeps until the start predicted from the measured gpu and present time, with or without a frame rate
+        // cap. With queueAhead only the frame before the previous one is waited for.
+        void waitForFrameStart();
+        // Call right after the frame's command buffers were submitted
+        void frameSubmitted();
+
+        float getLastInputLatency() const { return lastInputLatency; }
+        float getAverageInputLatency() const { return averageInputLatency; }
+        // submission to completion on the timeline, covering the gpu work and the wait for the swapchain image
+        float getAverageGpuTime() const { return averageGpuTime; }
+
+        private:
+        // left between the predicted submission and the gpu running dry, absorbs jitter in the estimates
+        static constexpr float DEADLINE_MARGIN = 1.f;
+
+        void waitForLowLatencyStart();
+        // Blocks until frame completed and folds its gpu time into the average
+        void measureFrame(uint64_t frame);
+        static void sleepUntil(Clock::time_point deadline);
+        static Clock::duration toDuration(float milliseconds);
+
+        FrameScheduler &scheduler;
+        FramePacingSettings settings{};
+
+        Clock::time_point nextFrameStart{};
+        Clock::time_point inputSampleTime{};
+        float lastInputLatency = 0.f;
+        float averageInputLatency = 0.f;
+
+        std::array<Clock::time_point, FrameScheduler::MAX_FRAMES_IN_FLIGHT> submitTimes{};
+        uint64_t lastMeasuredFrame = 0;
+        Clock::time_point lastCompletionTime{};
+        float averageGpuTime = 0.f;
+    };
+}
@@ -0,0 +1,64 @@
+#include "FrameScheduler.hpp"
+
+#include "CpuProfiler.hpp"
+
+// std
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace Engine {
+
+    FrameScheduler::FrameScheduler(vk::Device device, uint32_t framesInFlight) : device{device} {
+        setFramesInFlight(framesInFlight);
+
+        vk::SemaphoreTypeCreateInfo typeInfo{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.setPNext(&typeInfo);
+
+        if (device.createSemaphore(&semaphoreInfo, nullptr, &timeline_) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create frame timeline semaphore!");
+        }
+    }
+
+    FrameScheduler::~FrameScheduler() {
+        device.destroySemaphore(timeline_, nullptr);
+    }
+
+    void FrameScheduler::beginFrame() {
+        uint64_t frame = currentFrame();
+        if (frame > framesInFlight) {
+            CpuProfiler::Zone zone{"Wait for frame slot"};
+            waitForFrame(frame - framesInFlight);
+        }
+    }
+
+    uint64_t FrameScheduler::completedFrame() {
+        uint64_t value = 0;
+        if (device.getSemaphoreCounterValue(timeline_, &value) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to query frame timeline semaphore!");
+        }
+        completedFrame_ = value;
+        return completedFrame_;
+    }
+
+    bool FrameScheduler::isFrameComplete(uint64_t frame) {
+        return completedFrame_ >= frame || completedFrame() >= frame;
+    }
+
+    void FrameScheduler::waitForFrame(uint64_t frame) {
+        if (isFrameComplete(frame)) {
+            return;
+        }
+
+        vk::SemaphoreWaitInfo waitInfo{{}, 1, &timeline_, &frame};
+        if (device.waitSemaphores(&waitInfo, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to wait for frame timeline semaphore!");
+        }
+        completedFrame_ = std::max(completedFrame_, frame);
+    }
+
+    void FrameScheduler::setFramesInFlight(uint32_t count) {
+        framesInFlight = std::clamp(count, 1u, MAX_FRAMES_IN_FLIGHT);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <atomic>
+#include <cstdint>
+
+namespace Engine {
+
+    // Tracks frames with a single timeline semaphore whose value is the number of the last completed
+    // frame. Frame numbers start at 1 and increase monotonically, so deferred work can key on them.
+    class FrameScheduler {
+        public:
+        // upper bound for the runtime configurable depth, per-frame resources are allocated for this many slots
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+        static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+        FrameScheduler(vk::Device device, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+        ~FrameScheduler();
+
+        FrameScheduler(const FrameScheduler &) = delete;
+        FrameScheduler &operator=(const FrameScheduler &) = delete;
+
+        // Blocks only while the frame about to be recorded would exceed the frames in flight depth
+        void beginFrame();
+        // Call once the current frame's submission has been queued to signal the timeline. The frame counters may be
+        // read from other threads (e.g. loaders stamping deferred deletions), only the render thread advances them.
+        void frameSubmitted() { lastSubmittedFrame_.fetch_add(1, std::memory_order_release); }
+
+        uint64_t currentFrame() const { return lastSubmittedFrame() + 1; }
+        uint64_t lastSubmittedFrame() const { return lastSubmittedFrame_.load(std::memory_order_acquire); }
+        uint32_t currentFrameIndex() const { return static_cast<uint32_t>(currentFrame() % MAX_FRAMES_IN_FLIGHT); }
+
+        uint64_t completedFrame();
+        bool isFrameComplete(uint64_t frame);
+        void waitForFrame(uint64_t frame);
+
+        void setFramesInFlight(uint32_t count);
+        uint32_t getFramesInFlight() const { return framesInFlight; }
+
+        vk::Semaphore timeline() const { return timeline_; }
+
+        private:
+        vk::Device device;
+        vk::Semaphore timeline_;
+
+        uint32_t framesInFlight;
+        std::atomic<uint64_t> lastSubmittedFrame_{0};
+        uint64_t completedFrame_ = 0;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Material.hpp"
 #include "Model.hpp"
 
 // libs
@@ -41,8 +42,11 @@ namespace Engine {
         id_t getId() { return id; }
 
         std::shared_ptr<Model> model{};
-        glm::vec3 color{};
+        // null draws with MaterialSystem::getDefaultMaterial
+        std::shared_ptr<Material> material{};
         TransformComponent transform{};
+        // never moves, lets cached shadow cascades skip it, see ShadowSystem
+        bool isStatic = false;
 
         private:
         GameObject(id_t objId) : id{objId} {}
@@ -0,0 +1,193 @@
+#include "GpuProfiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace Engine {
+
+    // queries 0 and 1 bracket the whole frame, scope i uses 2 + 2i and 3 + 2i
+    static constexpr uint32_t QUERIES_PER_FRAME = 2 + 2 * GpuProfiler::MAX_SCOPES_PER_FRAME;
+    static constexpr uint32_t DROPPED_SCOPE = std::numeric_limits<uint32_t>::max();
+
+    GpuProfiler::GpuProfiler(
+        vk::Device device,
+        FrameScheduler &scheduler,
+        float timestampPeriod,
+        uint32_t timestampValidBits,
+        bool hostQueryReset,
+        bool computeTimestamps,
+        const vk::DispatchLoaderDynamic *debugUtils)
+        : device{device}, scheduler{scheduler}, debugUtils{debugUtils}, timestampPeriod{timestampPeriod},
+          timestampMask{timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1},
+          hostQueryReset{hostQueryReset}, computeTimestamps{computeTimestamps} {
+        slots.resize(FrameScheduler::MAX_FRAMES_IN_FLIGHT);
+        if (!timestampsSupported()) {
+            return;
+        }
+
+        vk::QueryPoolCreateInfo poolInfo{{}, vk::QueryType::eTimestamp, QUERIES_PER_FRAME};
+        for (auto &slot : slots) {
+            if (device.createQueryPool(&poolInfo, nullptr, &slot.queryPool) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to create timestamp query pool!");
+            }
+        }
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        for (auto &slot : slots) {
+            if (slot.queryPool) {
+                device.destroyQueryPool(slot.queryPool, nullptr);
+            }
+        }
+    }
+
+    void GpuProfiler::beginFrame(vk::CommandBuffer commandBuffer) {
+        assert(currentSlot == nullptr && "GpuProfiler frame already in progress");
+
+        // the scheduler has waited for the previous frame in this slot, its results are available without stalling
+        FrameSlot &slot = slots[scheduler.currentFrameIndex()];
+        resolve(slot);
+
+        slot.frame = scheduler.currentFrame();
+        slot.ended = false;
+        slot.scopes.clear();
+        currentSlot = &slot;
+
+        if (timestampsSupported()) {
+            if (hostQueryReset) {
+                device.resetQueryPool(slot.queryPool, 0, QUERIES_PER_FRAME);
+            } else {
+                commandBuffer.resetQueryPool(slot.queryPool, 0, QUERIES_PER_FRAME);
+            }
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, slot.queryPool, 0);
+        }
+    }
+
+    void GpuProfiler::endFrame(vk::CommandBuffer commandBuffer) {
+        assert(currentSlot != nullptr && "GpuProfiler frame not in progress");
+        assert(openScopes.empty() && "GpuProfiler scopes still open at the end of the frame");
+
+        if (timestampsSupported()) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, currentSlot->queryPool, 1);
+        }
+        currentSlot->ended = true;
+        currentSlot = nullptr;
+    }
+
+    void GpuProfiler::beginComputeFrame(vk::CommandBuffer commandBuffer) {
+        assert(currentSlot != nullptr && "Async compute has to be recorded inside a frame");
+        computeCommandBuffer = commandBuffer;
+    }
+
+    void GpuProfiler::endComputeFrame() { computeCommandBuffer = nullptr; }
+
+    void GpuProfiler::beginScope(vk::CommandBuffer commandBuffer, const char *name) {
+        assert(currentSlot != nullptr && "GpuProfiler scopes have to be inside a frame");
+
+        if (debugUtils) {
+            vk::DebugUtilsLabelEXT label{name};
+            commandBuffer.beginDebugUtilsLabelEXT(&label, *debugUtils);
+        }
+
+        // past the query budget scopes only get a label
+        bool compute = computeCommandBuffer && commandBuffer == computeCommandBuffer;
+        if (currentSlot->scopes.size() >= MAX_SCOPES_PER_FRAME || (compute && !computeTimestamps)) {
+            openScopes.push_back(DROPPED_SCOPE);
+            return;
+        }
+
+        uint32_t scope = static_cast<uint32_t>(currentSlot->scopes.size());
+        currentSlot->scopes.push_back({name, static_cast<uint32_t>(openScopes.size()), compute});
+        openScopes.push_back(scope);
+
+        if (timestampsSupported()) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, currentSlot->queryPool, 2 + 2 * scope);
+        }
+    }
+
+    void GpuProfiler::endScope(vk::CommandBuffer commandBuffer) {
+        assert(!openScopes.empty() && "GpuProfiler endScope without matching beginScope");
+
+        uint32_t scope = openScopes.back();
+        openScopes.pop_back();
+
+        if (scope != DROPPED_SCOPE && timestampsSupported()) {
+            commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, currentSlot->queryPool, 3 + 2 * scope);
+        }
+
+        if (debugUtils) {
+            commandBuffer.endDebugUtilsLabelEXT(*debugUtils);
+        }
+    }
+
+    void GpuProfiler::flush() {
+        assert(currentSlot == nullptr && "Can't flush the GpuProfiler while a frame is in progress");
+
+        std::vector<FrameSlot *> pending;
+        for (auto &slot : slots) {
+            if (slot.ended) {
+                pending.push_back(&slot);
+            }
+        }
+        std::sort(pending.begin(), pending.end(), [](const FrameSlot *a, const FrameSlot *b) { return a->frame < b->frame; });
+
+        for (FrameSlot *slot : pending) {
+            scheduler.waitForFrame(slot->frame);
+            resolve(*slot);
+        }
+    }
+
+    void GpuProfiler::resolve(FrameSlot &slot) {
+        if (!slot.ended) {
+            return;
+        }
+        slot.ended = false;
+        if (!timestampsSupported()) {
+            return;
+        }
+
+        uint32_t queryCount = 2 + 2 * static_cast<uint32_t>(slot.scopes.size());
+        std::vector<uint64_t> timestamps(queryCount);
+        // no wait flag, a frame that has not finished is skipped instead of stalling the cpu
+        vk::Result result = device.getQueryPoolResults(
+            slot.queryPool, 0, queryCount, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eNotReady) {
+            return;
+        }
+        if (result != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to read timestamp queries!");
+        }
+
+        auto toMilliseconds = [&](uint64_t begin, uint64_t end) {
+            uint64_t ticks = ((end & timestampMask) - (begin & timestampMask)) & timestampMask;
+            return static_cast<float>(static_cast<double>(ticks) * timestampPeriod / 1e6);
+        };
+
+        latest.frame = slot.frame;
+        latest.milliseconds = toMilliseconds(timestamps[0], timestamps[1]);
+        // signed, compute scopes may start before the graphics work of their frame
+        auto offsetMilliseconds = [&](uint64_t begin, uint64_t time) {
+            uint64_t ticks = ((time & timestampMask) - (begin & timestampMask)) & timestampMask;
+            int64_t signedTicks = ticks > timestampMask / 2 ? static_cast<int64_t>(ticks) - static_cast<int64_t>(timestampMask) - 1 : static_cast<int64_t>(ticks);
+            return static_cast<float>(static_cast<double>(signedTicks) * timestampPeriod / 1e6);
+        };
+
+        latest.scopes.clear();
+        for (uint32_t i = 0; i < slot.scopes.size(); i++) {
+            latest.scopes.push_back({
+                slot.scopes[i].name,
+                slot.scopes[i].depth,
+                toMilliseconds(timestamps[2 + 2 * i], timestamps[3 + 2 * i]),
+                offsetMilliseconds(timestamps[0], timestamps[2 + 2 * i]),
+                slot.scopes[i].compute});
+        }
+
+        if (resolveCallback) {
+            resolveCallback(latest);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "FrameScheduler.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Engine {
+
+    // Timestamp queries around named scopes of the primary command buffer. Every frame slot owns a query pool,
+    // which is read back when the slot comes around again, so the frame it belongs to has already completed.
+    // Scopes are mirrored as VK_EXT_debug_utils labels so captures show the same names. Scopes recorded into the
+    // frame's async compute command buffer share the frame's queries, their start offsets show the overlap.
+    class GpuProfiler {
+        public:
+        static constexpr uint32_t MAX_SCOPES_PER_FRAME = 128;
+
+        struct ScopeTiming {
+            std::string name;
+            uint32_t depth;
+            float milliseconds;
+            // relative to the start of the frame's graphics work, negative for compute that started earlier
+            float startMilliseconds;
+            bool compute;
+        };
+
+        struct FrameTimings {
+            uint64_t frame = 0;
+            float milliseconds = 0.f;
+            std::vector<ScopeTiming> scopes;
+        };
+
+        // Closes the scope when it goes out of scope, keep it outside of render passes with secondary contents
+        class Scope {
+            public:
+            Scope(GpuProfiler &profiler, vk::CommandBuffer commandBuffer, const char *name)
+                : profiler{profiler}, commandBuffer{commandBuffer} {
+                profiler.beginScope(commandBuffer, name);
+            }
+            ~Scope() { profiler.endScope(commandBuffer); }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+            private:
+            GpuProfiler &profiler;
+            vk::CommandBuffer commandBuffer;
+        };
+
+        // timestampValidBits of zero disables the queries, a null debugUtils disables the labels. Without hostQueryReset
+        // the queries are reset in the graphics command buffer and async compute scopes only get labels.
+        GpuProfiler(
+            vk::Device device,
+            FrameScheduler &scheduler,
+            float timestampPeriod,
+            uint32_t timestampValidBits,
+            bool hostQueryReset,
+            bool computeTimestamps,
+            const vk::DispatchLoaderDynamic *debugUtils);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+        // Recorded right after the frame's command buffer was begun, resolves the results of this slot's previous frame
+        void beginFrame(vk::CommandBuffer commandBuffer);
+        void endFrame(vk::CommandBuffer commandBuffer);
+        // Scopes recorded into this command buffer until endComputeFrame are tagged as async compute
+        void beginComputeFrame(vk::CommandBuffer commandBuffer);
+        void endComputeFrame();
+
+        void beginScope(vk::CommandBuffer commandBuffer, const char *name);
+        void endScope(vk::CommandBuffer commandBuffer);
+
+        // Waits for and resolves every recorded frame, e.g. before shutdown
+        void flush();
+
+        bool timestampsSupported() const { return timestampMask != 0; }
+        // Most recent resolved frame, lags the recorded frame by the number of frame slots
+        const FrameTimings &getLatestTimings() const { return latest; }
+        // Invoked for every resolved frame, in frame order
+        void setResolveCallback(std::function<void(const FrameTimings &)> callback) { resolveCallback = std::move(callback); }
+
+        private:
+        struct ScopeRecord {
+            std::string name;
+            uint32_t depth;
+            bool compute;
+        };
+
+        struct FrameSlot {
+            vk::QueryPool queryPool;
+            uint64_t frame = 0;
+            bool ended = false;
+            std::vector<ScopeRecord> scopes;
+        };
+
+        void resolve(FrameSlot &slot);
+
+        vk::Device device;
+        FrameScheduler &scheduler;
+        const vk::DispatchLoaderDynamic *debugUtils;
+        float timestampPeriod;
+        uint64_t timestampMask;
+        bool hostQueryReset;
+        bool computeTimestamps;
+
+        std::vector<FrameSlot> slots;
+        FrameSlot *currentSlot = nullptr;
+        vk::CommandBuffer computeCommandBuffer;
+        // indices into currentSlot->scopes of the open scopes, innermost last
+        std::vector<uint32_t> openScopes;
+
+        FrameTimings latest{};
+        std::function<void(const FrameTimings &)> resolveCallback;
+    };
+}
@@ -0,0 +1,124 @@
+#include "ImageWriter.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+namespace Engine {
+
+    static std::ofstream openOutput(const std::string &filepath) {
+        std::ofstream file{filepath, std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        return file;
+    }
+
+    void writePPM(const std::string &filepath, const CapturedImage &image) {
+        auto file = openOutput(filepath);
+        file << "P6\n" << image.width << " " << image.height << "\n255\n";
+
+        std::vector<char> row(static_cast<size_t>(image.width) * 3);
+        for (uint32_t y = 0; y < image.height; y++) {
+            const uint8_t *src = image.pixels.data() + static_cast<size_t>(y) * image.width * 4;
+            for (uint32_t x = 0; x < image.width; x++) {
+                row[x * 3 + 0] = static_cast<char>(src[x * 4 + 0]);
+                row[x * 3 + 1] = static_cast<char>(src[x * 4 + 1]);
+                row[x * 3 + 2] = static_cast<char>(src[x * 4 + 2]);
+            }
+            file.write(row.data(), row.size());
+        }
+    }
+
+    static uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    static void appendBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static void writeChunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &data) {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(data.size() + 12);
+        appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        // the crc covers the type and the data but not the length
+        appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+    }
+
+    void writePNG(const std::string &filepath, const CapturedImage &image) {
+        auto file = openOutput(filepath);
+
+        const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+
+        std::vector<uint8_t> header;
+        appendBigEndian(header, image.width);
+        appendBigEndian(header, image.height);
+        // 8 bit depth, truecolor with alpha, deflate, adaptive filtering, no interlace
+        header.insert(header.end(), {8, 6, 0, 0, 0});
+        writeChunk(file, "IHDR", header);
+
+        // every scanline is prefixed with filter type 0 (none)
+        size_t rowSize = static_cast<size_t>(image.width) * 4;
+        std::vector<uint8_t> raw;
+        raw.reserve((rowSize + 1) * image.height);
+        for (uint32_t y = 0; y < image.height; y++) {
+            raw.push_back(0);
+            const uint8_t *src = image.pixels.data() + y * rowSize;
+            raw.insert(raw.end(), src, src + rowSize);
+        }
+
+        // zlib stream made of stored deflate blocks, at most 65535 bytes each
+        std::vector<uint8_t> zlib;
+        zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+        size_t offset = 0;
+        do {
+            size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+            bool last = offset + blockSize == raw.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back(static_cast<uint8_t>(blockSize));
+            zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+            zlib.push_back(static_cast<uint8_t>(~blockSize));
+            zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+            offset += blockSize;
+        } while (offset < raw.size());
+
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : raw) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(zlib, (b << 16) | a);
+        writeChunk(file, "IDAT", zlib);
+
+        writeChunk(file, "IEND", {});
+    }
+}
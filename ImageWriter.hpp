@@ -0,0 +1,21 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Engine {
+
+    // Tightly packed 8 bit RGBA pixels, rows top to bottom
+    struct CapturedImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;
+    };
+
+    // Binary P6, alpha is dropped
+    void writePPM(const std::string &filepath, const CapturedImage &image);
+    // Uncompressed (stored deflate blocks) RGBA png, large but dependency free and byte exact
+    void writePNG(const std::string &filepath, const CapturedImage &image);
+}
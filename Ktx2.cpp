@@ -0,0 +1,50 @@
+#include "Ktx2.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+
+    static constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    Ktx2Index readKtx2Index(std::istream &file, const std::string &filepath) {
+        file.seekg(0, std::ios::end);
+        uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        Ktx2Header header;
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+            throw std::runtime_error("invalid KTX2 file: " + filepath);
+        }
+        if (header.supercompressionScheme != 0 || header.vkFormat == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("supercompressed and basis KTX2 textures are not supported: " + filepath);
+        }
+        if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+            throw std::runtime_error("only 2D KTX2 textures are supported: " + filepath);
+        }
+
+        Ktx2Index index{};
+        index.format = static_cast<vk::Format>(header.vkFormat);
+        index.width = header.pixelWidth;
+        index.height = std::max(header.pixelHeight, 1u);
+        index.levelCount = header.levelCount;
+        // a 32 bit size has at most 32 levels, anything more is a corrupt header
+        if (index.width == 0 || header.levelCount > 32) {
+            throw std::runtime_error("invalid KTX2 header: " + filepath);
+        }
+
+        index.levels.resize(std::max(header.levelCount, 1u));
+        if (!file.read(reinterpret_cast<char *>(index.levels.data()), index.levels.size() * sizeof(Ktx2Level))) {
+            throw std::runtime_error("truncated KTX2 level index: " + filepath);
+        }
+        for (const Ktx2Level &level : index.levels) {
+            // checked separately, their sum could wrap around
+            if (level.byteOffset > fileSize || level.byteLength > fileSize - level.byteOffset) {
+                throw std::runtime_error("truncated KTX2 level data: " + filepath);
+            }
+        }
+        return index;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace Engine {
+
+    // KTX2 file layout, little endian like every platform we run on
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header has to match the file layout");
+
+    struct Ktx2Level {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    struct Ktx2Index {
+        vk::Format format;
+        uint32_t width;
+        uint32_t height;
+        // as stored, zero asks the loader to generate the mip chain
+        uint32_t levelCount;
+        // at least the base level, every range lies within the file
+        std::vector<Ktx2Level> levels;
+    };
+
+    // Reads the header and level index of an uncompressed 2D KTX2 file, the texel data is left to the caller.
+    // Throws for anything else, filepath only names the file in the errors.
+    Ktx2Index readKtx2Index(std::istream &file, const std::string &filepath);
+}
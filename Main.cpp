@@ -6,10 +6,9 @@
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-    Engine::Core engine{};
-
+int main(int argc, char **argv) {
     try {
+        Engine::Core engine{Engine::EngineSettings::fromCommandLine(argc, argv)};
         engine.run();
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -0,0 +1,136 @@
+#include "Material.hpp"
+
+#include "GpuProfiler.hpp"
+#include "SwapChain.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+
+    static_assert(sizeof(MaterialParameters) == 48, "MaterialParameters has to match the std430 buffer in Shading.glsl");
+
+    Material::Material(MaterialSystem &system, uint32_t id, MaterialPipeline pipeline) : system{system}, id{id}, pipeline{pipeline} {}
+
+    Material::~Material() { system.release(id); }
+
+    const MaterialParameters &Material::getParameters() const { return system.parameters[id]; }
+
+    void Material::setParameters(const MaterialParameters &parameters) { system.write(id, parameters); }
+
+    MaterialSystem::MaterialSystem(Device &device, DescriptorAllocator &allocator, BindlessDescriptors *bindless, uint32_t maxMaterials)
+        : device{device}, bindless{bindless}, maxMaterials{maxMaterials} {
+        assert(maxMaterials > 0 && maxMaterials <= (1u << 16) && "Material ids have to fit the render queue key");
+
+        parameterBuffer = std::make_unique<Buffer>(device, sizeof(MaterialParameters), maxMaterials,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal,
+            device.properties.limits.minStorageBufferOffsetAlignment);
+        stagingBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        setLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eFragment)
+            .build();
+        auto bufferInfo = parameterBuffer->descriptorInfo(sizeof(MaterialParameters));
+        if (!DescriptorWriter(*setLayout, allocator)
+            .writeBuffer(0, &bufferInfo)
+            .build(descriptorSet)) {
+            throw std::runtime_error("failed to allocate material descriptor set!");
+        }
+
+        parameters.resize(maxMaterials);
+        dirty.resize(maxMaterials, false);
+        defaultMaterial = createMaterial();
+    }
+
+    MaterialSystem::~MaterialSystem() {
+        defaultMaterial.reset();
+        assert(getMaterialCount() == 0 && "Materials have to be released before their MaterialSystem");
+        for (BindlessHandle handle : textureHandles) {
+            bindless->freeSampledImage(handle);
+        }
+    }
+
+    uint32_t MaterialSystem::addTexture(std::shared_ptr<Texture> texture) {
+        if (!bindless) {
+            return BindlessHandle::INVALID_INDEX;
+        }
+        BindlessHandle handle = bindless->addSampledImage(texture->descriptorInfo());
+        textures.push_back(std::move(texture));
+        textureHandles.push_back(handle);
+        return handle.index;
+    }
+
+    std::shared_ptr<Material> MaterialSystem::createMaterial(const MaterialParameters &parameters, MaterialPipeline pipeline) {
+        uint32_t id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else if (nextId < maxMaterials) {
+            id = nextId++;
+        } else {
+            throw std::runtime_error("too many materials!");
+        }
+
+        write(id, parameters);
+        return std::make_shared<Material>(*this, id, pipeline);
+    }
+
+    void MaterialSystem::write(uint32_t id, const MaterialParameters &materialParameters) {
+        parameters[id] = materialParameters;
+        if (!dirty[id]) {
+            dirty[id] = true;
+            dirtyIds.push_back(id);
+        }
+    }
+
+    void MaterialSystem::release(uint32_t id) {
+        // in flight frames keep reading the old entry, a reused id is rewritten by a copy ordered after them
+        freeIds.push_back(id);
+    }
+
+    void MaterialSystem::recordUploads(vk::CommandBuffer commandBuffer, int frameIndex) {
+        if (dirtyIds.empty()) {
+            return;
+        }
+        GpuProfiler::Scope profileScope{device.gpuProfiler(), commandBuffer, "MaterialUpload"};
+
+        // this frame's staging buffer was last read MAX_FRAMES_IN_FLIGHT frames ago, a replaced one is destroyed once
+        // its frame completed
+        std::unique_ptr<Buffer> &stagingBuffer = stagingBuffers[frameIndex];
+        uint32_t dirtyCount = static_cast<uint32_t>(dirtyIds.size());
+        if (!stagingBuffer || stagingBuffer->getInstanceCount() < dirtyCount) {
+            uint32_t capacity = stagingBuffer ? stagingBuffer->getInstanceCount() : INITIAL_STAGING_ENTRIES;
+            while (capacity < dirtyCount) {
+                capacity *= 2;
+            }
+            stagingBuffer = std::make_unique<Buffer>(device, sizeof(MaterialParameters), capacity, vk::BufferUsageFlagBits::eTransferSrc,
+                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+            stagingBuffer->map();
+        }
+
+        vk::DeviceSize stride = parameterBuffer->getAlignmentSize();
+        char *staging = static_cast<char *>(stagingBuffer->getMappedMemory());
+        std::vector<vk::BufferCopy> copies;
+        copies.reserve(dirtyCount);
+        for (uint32_t i = 0; i < dirtyCount; i++) {
+            uint32_t id = dirtyIds[i];
+            vk::DeviceSize stagingOffset = i * stagingBuffer->getAlignmentSize();
+            std::memcpy(staging + stagingOffset, &parameters[id], sizeof(MaterialParameters));
+            dirty[id] = false;
+            copies.push_back({stagingOffset, id * stride, sizeof(MaterialParameters)});
+        }
+        dirtyIds.clear();
+
+        vk::BufferMemoryBarrier toTransfer{
+            vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, parameterBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 1, &toTransfer, 0, nullptr);
+        commandBuffer.copyBuffer(stagingBuffer->getBuffer(), parameterBuffer->getBuffer(), static_cast<uint32_t>(copies.size()), copies.data());
+        vk::BufferMemoryBarrier toShader{
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, parameterBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 1, &toShader, 0, nullptr);
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "BindlessDescriptors.hpp"
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "Device.hpp"
+#include "Texture.hpp"
+#include "VirtualTextureSystem.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Engine {
+
+    class MaterialSystem;
+
+    // Pipeline variants RenderSystem builds for every pass, the variant is the most significant part of a draw's sort key
+    enum class MaterialPipeline : uint32_t {
+        Opaque = 0,
+        // back faces are culled, for closed meshes
+        OpaqueCulled,
+        Count
+    };
+
+    // std430 layout of the material buffer in Shading.glsl
+    struct MaterialParameters {
+        // multiplies the base color with the vertex color
+        static constexpr uint32_t VERTEX_COLOR = 1;
+
+        glm::vec4 baseColor{1.f};
+        // rgb and intensity
+        glm::vec4 emissive{0.f};
+        // texture slots, VirtualTextureSystem ids
+        uint32_t baseColorTexture = VirtualTextureSystem::INVALID_TEXTURE;
+        uint32_t emissiveTexture = VirtualTextureSystem::INVALID_TEXTURE;
+        uint32_t flags = VERTEX_COLOR;
+        // bindless sampled image from MaterialSystem::addTexture, multiplies the base color
+        uint32_t baseColorImage = BindlessHandle::INVALID_INDEX;
+    };
+
+    // One entry of a MaterialSystem, shared by the game objects using it and released with the last of them
+    class Material {
+        public:
+        Material(MaterialSystem &system, uint32_t id, MaterialPipeline pipeline);
+        ~Material();
+
+        Material(const Material &) = delete;
+        Material &operator=(const Material &) = delete;
+
+        uint32_t getId() const { return id; }
+        MaterialPipeline getPipeline() const { return pipeline; }
+
+        const MaterialParameters &getParameters() const;
+        // Only this material's entry is uploaded, before the next frame's draws
+        void setParameters(const MaterialParameters &parameters);
+
+        private:
+        MaterialSystem &system;
+        uint32_t id;
+        MaterialPipeline pipeline;
+    };
+
+    // Parameters of every material packed into one device local storage buffer. A draw selects its material with the
+    // dynamic offset of a single descriptor set, so switching materials never allocates or writes descriptors.
+    // Edited entries are tracked on the cpu and only those go through a small per-frame staging buffer, the rest of
+    // the buffer stays untouched.
+    //
+    // Not thread safe, materials are created and edited on the thread recording the frame.
+    class MaterialSystem {
+        public:
+        // The allocator needs room for a set with one dynamic storage buffer. Ids go into the 16 bit material part of
+        // RenderQueue keys.
+        MaterialSystem(Device &device, DescriptorAllocator &allocator, BindlessDescriptors *bindless = nullptr, uint32_t maxMaterials = 4096);
+        ~MaterialSystem();
+
+        MaterialSystem(const MaterialSystem &) = delete;
+        MaterialSystem &operator=(const MaterialSystem &) = delete;
+
+        std::shared_ptr<Material> createMaterial(const MaterialParameters &parameters = {}, MaterialPipeline pipeline = MaterialPipeline::Opaque);
+        // Makes the texture sampleable through MaterialParameters::baseColorImage and keeps it alive as long as the
+        // material system, set its sampler before. Without bindless descriptors nothing can sample it and this returns
+        // BindlessHandle::INVALID_INDEX, which materials ignore.
+        uint32_t addTexture(std::shared_ptr<Texture> texture);
+        // Vertex colored and lit, drawn for game objects without a material
+        const Material &getDefaultMaterial() const { return *defaultMaterial; }
+
+        // Copies the entries edited since the last call, outside of any render pass and before the draws
+        void recordUploads(vk::CommandBuffer commandBuffer, int frameIndex);
+
+        vk::DescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+        vk::DescriptorSet getDescriptorSet() const { return descriptorSet; }
+        uint32_t getDynamicOffset(const Material &material) const { return static_cast<uint32_t>(material.getId() * parameterBuffer->getAlignmentSize()); }
+        uint32_t getMaterialCount() const { return nextId - static_cast<uint32_t>(freeIds.size()); }
+
+        private:
+        friend class Material;
+
+        void write(uint32_t id, const MaterialParameters &parameters);
+        void release(uint32_t id);
+
+        Device &device;
+        BindlessDescriptors *bindless;
+        uint32_t maxMaterials;
+
+        // entries staged by the first uploads, regrown to the largest batch of edits seen so far
+        static constexpr uint32_t INITIAL_STAGING_ENTRIES = 64;
+
+        std::unique_ptr<Buffer> parameterBuffer;
+        // per frame in flight, the dirty entries packed back to back
+        std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        vk::DescriptorSet descriptorSet;
+
+        // cpu copy of every entry
+        std::vector<MaterialParameters> parameters;
+        std::vector<bool> dirty;
+        std::vector<uint32_t> dirtyIds;
+        std::vector<uint32_t> freeIds;
+        uint32_t nextId = 0;
+
+        std::vector<std::shared_ptr<Texture>> textures;
+        std::vector<BindlessHandle> textureHandles;
+
+        std::shared_ptr<Material> defaultMaterial;
+    };
+}
@@ -0,0 +1,153 @@
+#include "MemoryTracker.hpp"
+
+// std
+#include <cassert>
+#include <iomanip>
+
+namespace Engine {
+
+    const char *toString(MemoryCategory category) {
+        switch (category) {
+            case MemoryCategory::Geometry: return "geometry";
+            case MemoryCategory::Uniform: return "uniform";
+            case MemoryCategory::Storage: return "storage";
+            case MemoryCategory::Staging: return "staging";
+            case MemoryCategory::Attachment: return "attachment";
+            case MemoryCategory::Texture: return "texture";
+            default: return "other";
+        }
+    }
+
+    MemoryTracker::MemoryTracker(vk::PhysicalDevice physicalDevice, bool budgetExtension)
+        : physicalDevice{physicalDevice}, budgetExtension{budgetExtension} {
+        physicalDevice.getMemoryProperties(&memoryProperties);
+
+        heaps.resize(memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            heaps[i].size = memoryProperties.memoryHeaps[i].size;
+            heaps[i].flags = memoryProperties.memoryHeaps[i].flags;
+        }
+    }
+
+    void MemoryTracker::trackAllocation(vk::DeviceMemory memory, vk::DeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category) {
+        uint32_t heapIndex = heapIndexForMemoryType(memoryTypeIndex);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        allocations[static_cast<VkDeviceMemory>(memory)] = {size, heapIndex, category};
+
+        HeapStats &heap = heaps[heapIndex];
+        heap.allocated += size;
+        heap.allocatedByCategory[static_cast<size_t>(category)] += size;
+        heap.allocationCount++;
+    }
+
+    void MemoryTracker::trackFree(vk::DeviceMemory memory) {
+        if (!memory) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = allocations.find(static_cast<VkDeviceMemory>(memory));
+        assert(it != allocations.end() && "Freeing memory that was not allocated through the tracker");
+        if (it == allocations.end()) {
+            return;
+        }
+
+        HeapStats &heap = heaps[it->second.heapIndex];
+        heap.allocated -= it->second.size;
+        heap.allocatedByCategory[static_cast<size_t>(it->second.category)] -= it->second.size;
+        heap.allocationCount--;
+        allocations.erase(it);
+    }
+
+    void MemoryTracker::queryBudget(std::vector<HeapStats> &stats) {
+        if (!budgetExtension) {
+            for (auto &heap : stats) {
+                heap.budget = heap.size;
+                heap.usage = heap.allocated;
+            }
+            return;
+        }
+
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        vk::PhysicalDeviceMemoryProperties2 properties2{};
+        properties2.setPNext(&budgetProperties);
+        physicalDevice.getMemoryProperties2(&properties2);
+
+        for (uint32_t i = 0; i < stats.size(); i++) {
+            stats[i].budget = budgetProperties.heapBudget[i];
+            stats[i].usage = budgetProperties.heapUsage[i];
+        }
+    }
+
+    MemoryTracker::Stats MemoryTracker::getStats() {
+        Stats stats{};
+        stats.budgetExtension = budgetExtension;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stats.heaps = heaps;
+        }
+        queryBudget(stats.heaps);
+        return stats;
+    }
+
+    vk::DeviceSize MemoryTracker::getAvailableBudget(uint32_t heapIndex) {
+        Stats stats = getStats();
+        const HeapStats &heap = stats.heaps[heapIndex];
+        return heap.usage < heap.budget ? heap.budget - heap.usage : 0;
+    }
+
+    vk::DeviceSize MemoryTracker::getTotalAllocated() {
+        std::lock_guard<std::mutex> lock{mutex};
+        vk::DeviceSize total = 0;
+        for (const auto &heap : heaps) {
+            total += heap.allocated;
+        }
+        return total;
+    }
+
+    void MemoryTracker::printReport(std::ostream &out) {
+        constexpr double MiB = 1024.0 * 1024.0;
+        Stats stats = getStats();
+
+        out << std::fixed << std::setprecision(1);
+        out << "gpu memory" << (stats.budgetExtension ? "" : " (VK_EXT_memory_budget unavailable, budget is heap size)") << ":\n";
+        for (uint32_t i = 0; i < stats.heaps.size(); i++) {
+            const HeapStats &heap = stats.heaps[i];
+            bool deviceLocal = static_cast<bool>(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+            out << "  heap " << i << (deviceLocal ? " (device local)" : " (host)") << ": "
+                << heap.allocated / MiB << " MiB in " << heap.allocationCount << " allocations, usage "
+                << heap.usage / MiB << " / budget " << heap.budget / MiB << " / size " << heap.size / MiB << " MiB\n";
+            for (size_t c = 0; c < CATEGORY_COUNT; c++) {
+                if (heap.allocatedByCategory[c] > 0) {
+                    out << "    " << toString(static_cast<MemoryCategory>(c)) << ": " << heap.allocatedByCategory[c] / MiB << " MiB\n";
+                }
+            }
+        }
+        out << std::defaultfloat;
+    }
+
+    MemoryCategory MemoryTracker::categorize(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties) {
+        if (usage & (vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer)) {
+            return MemoryCategory::Geometry;
+        }
+        if (usage & vk::BufferUsageFlagBits::eUniformBuffer) {
+            return MemoryCategory::Uniform;
+        }
+        if (usage & vk::BufferUsageFlagBits::eStorageBuffer) {
+            return MemoryCategory::Storage;
+        }
+        if ((usage & (vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst)) &&
+            (properties & vk::MemoryPropertyFlagBits::eHostVisible)) {
+            return MemoryCategory::Staging;
+        }
+        return MemoryCategory::Other;
+    }
+
+    MemoryCategory MemoryTracker::categorize(vk::ImageUsageFlags usage) {
+        if (usage & (vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment)) {
+            return MemoryCategory::Attachment;
+        }
+        return MemoryCategory::Texture;
+    }
+}
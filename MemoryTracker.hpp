@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine {
+
+    enum class MemoryCategory : uint32_t {
+        Geometry,
+        Uniform,
+        Storage,
+        Staging,
+        Attachment,
+        Texture,
+        Other,
+        Count
+    };
+
+    const char *toString(MemoryCategory category);
+
+    // Accounts every vkAllocateMemory made through Device per heap and category. With VK_EXT_memory_budget
+    // the driver's budget and usage (including memory allocated by other processes) are reported as well,
+    // otherwise the budget falls back to the heap size.
+    class MemoryTracker {
+        public:
+        static constexpr size_t CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::Count);
+
+        struct HeapStats {
+            vk::DeviceSize size = 0;
+            vk::MemoryHeapFlags flags{};
+            // what this process allocated through the tracker
+            vk::DeviceSize allocated = 0;
+            std::array<vk::DeviceSize, CATEGORY_COUNT> allocatedByCategory{};
+            uint32_t allocationCount = 0;
+            // driver reported values, heap size and tracked allocations without VK_EXT_memory_budget
+            vk::DeviceSize budget = 0;
+            vk::DeviceSize usage = 0;
+        };
+
+        struct Stats {
+            bool budgetExtension = false;
+            std::vector<HeapStats> heaps;
+        };
+
+        MemoryTracker(vk::PhysicalDevice physicalDevice, bool budgetExtension);
+
+        MemoryTracker(const MemoryTracker &) = delete;
+        MemoryTracker &operator=(const MemoryTracker &) = delete;
+
+        void trackAllocation(vk::DeviceMemory memory, vk::DeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category);
+        void trackFree(vk::DeviceMemory memory);
+
+        // Queries the current budget, cheap enough to call once per frame
+        Stats getStats();
+        // Bytes that can still be allocated from the heap before exceeding its budget, streaming systems should
+        // evict when this runs low
+        vk::DeviceSize getAvailableBudget(uint32_t heapIndex);
+        vk::DeviceSize getTotalAllocated();
+
+        uint32_t heapIndexForMemoryType(uint32_t memoryTypeIndex) const { return memoryProperties.memoryTypes[memoryTypeIndex].heapIndex; }
+        const vk::PhysicalDeviceMemoryProperties &getMemoryProperties() const { return memoryProperties; }
+
+        void printReport(std::ostream &out);
+
+        static MemoryCategory categorize(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+        static MemoryCategory categorize(vk::ImageUsageFlags usage);
+
+        private:
+        struct Allocation {
+            vk::DeviceSize size;
+            uint32_t heapIndex;
+            MemoryCategory category;
+        };
+
+        void queryBudget(std::vector<HeapStats> &heaps);
+
+        vk::PhysicalDevice physicalDevice;
+        vk::PhysicalDeviceMemoryProperties memoryProperties;
+        bool budgetExtension;
+
+        std::mutex mutex;
+        std::unordered_map<VkDeviceMemory, Allocation> allocations;
+        std::vector<HeapStats> heaps;
+    };
+}
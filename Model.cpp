@@ -1,5 +1,6 @@
 #include "Model.hpp"
 
+#include "UploadQueue.hpp"
 #include "Utils.hpp"
 
 // libs
@@ -9,6 +10,7 @@
 #include <glm/gtx/hash.hpp>
 
 // std
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <unordered_map>
@@ -27,7 +29,11 @@ namespace std {
 namespace Engine {
 
     Model::Model(Device &device, const Model::Builder &builder) : device{device} {
+        // models may be created on loader threads
+        static std::atomic<uint32_t> currentId{0};
+        id = currentId.fetch_add(1, std::memory_order_relaxed);
         createVertexBuffers(builder.vertices);
+        createPositionBuffer(builder.vertices);
         createIndexBuffers(builder.indices);
     }
 
@@ -46,18 +52,39 @@ namespace Engine {
         vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
         uint32_t vertexSize = sizeof(vertices[0]);
 
-        Buffer stagingBuffer{device, vertexSize, vertexCount, vk::BufferUsageFlagBits::eTransferSrc,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent};
+        auto stagingBuffer = std::make_unique<Buffer>(device, vertexSize, vertexCount, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *)vertices.data());
+        stagingBuffer->map();
+        stagingBuffer->writeToBuffer((void *)vertices.data());
 
         vertexBuffer = std::make_unique<Buffer>(device, vertexSize, vertexCount, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
             vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-        
+        // the copy overlaps rendering, the first frame drawing the model waits for it
+        device.uploadQueue().uploadBuffer(std::move(stagingBuffer), vertexBuffer->getBuffer(), bufferSize,
+            vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
+    }
+
+    void Model::createPositionBuffer(const std::vector<Vertex> &vertices) {
+        std::vector<glm::vec3> positions(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].position;
+        }
+        vk::DeviceSize bufferSize = sizeof(positions[0]) * vertexCount;
+        uint32_t positionSize = sizeof(positions[0]);
+
+        auto stagingBuffer = std::make_unique<Buffer>(device, positionSize, vertexCount, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+        stagingBuffer->map();
+        stagingBuffer->writeToBuffer((void *)positions.data());
 
-        device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+        positionBuffer = std::make_unique<Buffer>(device, positionSize, vertexCount, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        device.uploadQueue().uploadBuffer(std::move(stagingBuffer), positionBuffer->getBuffer(), bufferSize,
+            vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
     }
 
     void Model::createIndexBuffers(const std::vector<uint32_t> &indices) {
@@ -71,16 +98,17 @@ namespace Engine {
         vk::DeviceSize bufferSize = sizeof(indices[0]) * indexCount;
         uint32_t indexSize = sizeof(indices[0]);
 
-        Buffer stagingBuffer{device, indexSize, indexCount, vk::BufferUsageFlagBits::eTransferSrc,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent};
+        auto stagingBuffer = std::make_unique<Buffer>(device, indexSize, indexCount, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
+        stagingBuffer->map();
+        stagingBuffer->writeToBuffer((void*)indices.data());
 
         indexBuffer = std::make_unique<Buffer>(device, indexSize, indexCount, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
             vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-        device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+        device.uploadQueue().uploadBuffer(std::move(stagingBuffer), indexBuffer->getBuffer(), bufferSize,
+            vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
     }
 
     void Model::draw(vk::CommandBuffer commandBuffer) {
@@ -101,6 +129,16 @@ namespace Engine {
         }
     }
 
+    void Model::bindPositions(vk::CommandBuffer commandBuffer) {
+        vk::Buffer buffers[] = {positionBuffer->getBuffer()};
+        vk::DeviceSize offsets[] = {0};
+        commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
+
+        if (hasIndexBuffer) {
+            commandBuffer.bindIndexBuffer(indexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+        }
+    }
+
     std::vector<vk::VertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
         std::vector<vk::VertexInputBindingDescription> bindingDescriptions{{0, sizeof(Vertex), vk::VertexInputRate::eVertex}};
         return bindingDescriptions;
@@ -117,6 +155,14 @@ namespace Engine {
         return attributeDescriptions;
     }
 
+    std::vector<vk::VertexInputBindingDescription> Model::Vertex::getPositionBindingDescriptions() {
+        return {{0, sizeof(glm::vec3), vk::VertexInputRate::eVertex}};
+    }
+
+    std::vector<vk::VertexInputAttributeDescription> Model::Vertex::getPositionAttributeDescriptions() {
+        return {{0, 0, vk::Format::eR32G32B32Sfloat, 0}};
+    }
+
     void Model::Builder::loadModel(const std::string &filepath) {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
@@ -23,6 +23,9 @@ namespace Engine {
 
             static std::vector<vk::VertexInputBindingDescription> getBindingDescriptions();
             static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions();
+            // tightly packed positions only, see bindPositions
+            static std::vector<vk::VertexInputBindingDescription> getPositionBindingDescriptions();
+            static std::vector<vk::VertexInputAttributeDescription> getPositionAttributeDescriptions();
 
             bool operator==(const Vertex &other) const {
             return position == other.position && color == other.color && normal == other.normal &&
@@ -46,17 +49,25 @@ namespace Engine {
         static std::unique_ptr<Model> createModelFromFile(
             Device &device, const std::string &filepath);
 
+        // unique per model, used to group draws of the same mesh
+        uint32_t getId() const { return id; }
+
         void bind(vk::CommandBuffer commandBuffer);
+        // Binds the position-only stream, depth only passes fetch a third of the vertex data
+        void bindPositions(vk::CommandBuffer commandBuffer);
         void draw(vk::CommandBuffer commandBuffer);
 
         private:
         void createVertexBuffers(const std::vector<Vertex> &vertices);
+        void createPositionBuffer(const std::vector<Vertex> &vertices);
         void createIndexBuffers(const std::vector<uint32_t> &indices);
 
         Device &device;
+        uint32_t id;
 
         std::unique_ptr<Buffer> vertexBuffer;
         uint32_t vertexCount;
+        std::unique_ptr<Buffer> positionBuffer;
 
         bool hasIndexBuffer = false;
         std::unique_ptr<Buffer> indexBuffer;
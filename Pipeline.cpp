@@ -21,8 +21,10 @@ namespace Engine {
 
     Pipeline::~Pipeline() {
         device.device().destroyShaderModule(vertShaderModule, nullptr);
-        device.device().destroyShaderModule(fragShaderModule, nullptr);
-        device.device().destroyPipeline(graphicsPipeline, nullptr);
+        if (fragShaderModule) {
+            device.device().destroyShaderModule(fragShaderModule, nullptr);
+        }
+        device.deferDestroy(graphicsPipeline);
     }
 
     std::vector<char> Pipeline::readFile(const std::string& filepath) {
@@ -52,20 +54,24 @@ namespace Engine {
             "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
         auto vertCode = readFile(vertFilepath);
-        auto fragCode = readFile(fragFilepath);
-
         createShaderModule(vertCode, &vertShaderModule);
-        createShaderModule(fragCode, &fragShaderModule);
+
+        uint32_t stageCount = 1;
+        if (!fragFilepath.empty()) {
+            auto fragCode = readFile(fragFilepath);
+            createShaderModule(fragCode, &fragShaderModule);
+            stageCount = 2;
+        }
 
         vk::PipelineShaderStageCreateInfo shaderStages[2]{{{}, vk::ShaderStageFlagBits::eVertex, vertShaderModule, "main", nullptr},
         {{}, vk::ShaderStageFlagBits::eFragment, fragShaderModule, "main", nullptr}};
 
-        auto bindingDescriptions = Model::Vertex::getBindingDescriptions();
-        auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+        const auto &bindingDescriptions = configInfo.bindingDescriptions;
+        const auto &attributeDescriptions = configInfo.attributeDescriptions;
         vk::PipelineVertexInputStateCreateInfo vertexInputInfo{{}, static_cast<uint32_t>(bindingDescriptions.size()), bindingDescriptions.data(),
         static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data()};
 
-        vk::GraphicsPipelineCreateInfo pipelineInfo{{}, 2, shaderStages, &vertexInputInfo, &configInfo.inputAssemblyInfo, nullptr, &configInfo.viewportInfo, &configInfo.rasterizationInfo,
+        vk::GraphicsPipelineCreateInfo pipelineInfo{{}, stageCount, shaderStages, &vertexInputInfo, &configInfo.inputAssemblyInfo, nullptr, &configInfo.viewportInfo, &configInfo.rasterizationInfo,
         &configInfo.multisampleInfo, &configInfo.depthStencilInfo, &configInfo.colorBlendInfo, &configInfo.dynamicStateInfo, configInfo.pipelineLayout, configInfo.renderPass, configInfo.subpass,
         nullptr, -1};
 
@@ -87,6 +93,9 @@ namespace Engine {
     }
 
     void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
+        configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
+        configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+
         configInfo.inputAssemblyInfo.setTopology(vk::PrimitiveTopology::eTriangleList);
         configInfo.inputAssemblyInfo.setPrimitiveRestartEnable(false);
 
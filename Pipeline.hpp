@@ -12,6 +12,8 @@ namespace Engine {
         PipelineConfigInfo(const PipelineConfigInfo&) = delete;
         PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+        std::vector<vk::VertexInputBindingDescription> bindingDescriptions{};
+        std::vector<vk::VertexInputAttributeDescription> attributeDescriptions{};
         vk::PipelineViewportStateCreateInfo viewportInfo;
         vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
         vk::PipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -28,6 +30,7 @@ namespace Engine {
 
     class Pipeline {
         public:
+        // An empty fragFilepath creates a pipeline without fragment stage, e.g. for depth only passes
         Pipeline(
             Device& device,
             const std::string& vertFilepath,
@@ -41,9 +44,9 @@ namespace Engine {
         void bind(vk::CommandBuffer commandBuffer);
 
         static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+        static std::vector<char> readFile(const std::string& filepath);
 
         private:
-        static std::vector<char> readFile(const std::string& filepath);
 
         void createGraphicsPipeline(
             const std::string& vertFilepath,
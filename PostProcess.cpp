@@ -0,0 +1,281 @@
+#include "PostProcess.hpp"
+
+#include "SamplerCache.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace Engine {
+
+    // keep in sync with PostProcess.glsl
+    struct PostProcessPush {
+        uint32_t flags;
+        uint32_t exposureIndex;
+        float exposureCompensation;
+        float adaptation;
+        float bloomThreshold;
+        float bloomIntensity;
+    };
+
+    static constexpr uint32_t GROUP_SIZE = 8;
+    static constexpr vk::DeviceSize HISTOGRAM_SIZE = sizeof(uint32_t) * PostProcess::HISTOGRAM_BINS;
+
+    static bool isSrgbFormat(vk::Format format) {
+        return format == vk::Format::eB8G8R8A8Srgb || format == vk::Format::eR8G8B8A8Srgb || format == vk::Format::eA8B8G8R8SrgbPack32;
+    }
+
+    PostProcess::PostProcess(Device &device) : device{device} {
+        if (!device.supportsStorageWriteWithoutFormat()) {
+            throw std::runtime_error("failed to create post processing, storage image writes without format are not supported!");
+        }
+
+        // histogram, then the log2 exposure of the two frame parities
+        exposureBuffer = std::make_unique<Buffer>(device, HISTOGRAM_SIZE + 2 * sizeof(float), 1,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::SamplerCreateInfo samplerInfo{};
+        samplerInfo.setMagFilter(vk::Filter::eLinear);
+        samplerInfo.setMinFilter(vk::Filter::eLinear);
+        samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eNearest);
+        samplerInfo.setAddressModeU(vk::SamplerAddressMode::eClampToEdge);
+        samplerInfo.setAddressModeV(vk::SamplerAddressMode::eClampToEdge);
+        samplerInfo.setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+        samplerInfo.setMaxLod(VK_LOD_CLAMP_NONE);
+        samplerInfo.setBorderColor(vk::BorderColor::eIntOpaqueBlack);
+        sampler = device.samplerCache().get(samplerInfo);
+
+        // r11g11b10 halves the bloom chain's bandwidth where it can be written from compute
+        bloomFormat = device.supportsFormat(vk::Format::eB10G11R11UfloatPack32, vk::ImageTiling::eOptimal,
+            vk::FormatFeatureFlagBits::eStorageImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear)
+            ? vk::Format::eB10G11R11UfloatPack32 : vk::Format::eR16G16B16A16Sfloat;
+
+        createPipelines();
+    }
+
+    PostProcess::~PostProcess() {
+        device.deferDestroy(pipelineLayout);
+    }
+
+    void PostProcess::createPipelines() {
+        setLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eCompute)
+            .addBinding(1, vk::DescriptorType::eStorageImage, vk::ShaderStageFlagBits::eCompute)
+            .addBinding(2, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eCompute)
+            .addBinding(3, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eCompute)
+            .build();
+
+        vk::DescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+        vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eCompute, 0, sizeof(PostProcessPush)};
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, 1, &descriptorSetLayout, 1, &pushConstantRange};
+        if (device.device().createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create post process pipeline layout!");
+        }
+
+        prefilterPipeline = std::make_unique<ComputePipeline>(device, "./Shaders/PostPrefilter.comp.spv", pipelineLayout);
+        downsamplePipeline = std::make_unique<ComputePipeline>(device, "./Shaders/PostDownsample.comp.spv", pipelineLayout);
+        upsamplePipeline = std::make_unique<ComputePipeline>(device, "./Shaders/PostUpsample.comp.spv", pipelineLayout);
+        resolvePipeline = std::make_unique<ComputePipeline>(device, "./Shaders/PostResolve.comp.spv", pipelineLayout);
+    }
+
+    vk::Extent2D PostProcess::bloomExtent(uint32_t lod) const {
+        uint32_t width = (extent.width + 1) / 2;
+        uint32_t height = (extent.height + 1) / 2;
+        return {std::max(width >> lod, 1u), std::max(height >> lod, 1u)};
+    }
+
+    void PostProcess::addPasses(RenderGraph &graph, RenderGraphResource sceneColor, RenderGraphResource output, SwapChain &swapChain) {
+        this->sceneColor = sceneColor;
+        this->output = output;
+        extent = swapChain.getSwapChainExtent();
+        // without storage output the intermediate is linear and the blit encodes into an sRGB swapchain
+        encodeSrgb = !isSrgbFormat(swapChain.getSwapChainImageFormat());
+
+        // levels stop before the blur footprint gets larger than the image
+        vk::Extent2D base = bloomExtent(0);
+        bloomLevels = 1;
+        while (bloomLevels < MAX_BLOOM_LEVELS && (std::min(base.width, base.height) >> bloomLevels) >= 8) {
+            bloomLevels++;
+        }
+
+        // the smallest level has nothing added to it, the upsampled chain starts from it
+        downsampled.resize(bloomLevels);
+        upsampled.resize(bloomLevels);
+        for (uint32_t lod = 0; lod < bloomLevels; lod++) {
+            downsampled[lod] = graph.createImage("Bloom " + std::to_string(lod), {bloomFormat, bloomExtent(lod)});
+        }
+        upsampled[bloomLevels - 1] = downsampled[bloomLevels - 1];
+        for (uint32_t lod = 0; lod + 1 < bloomLevels; lod++) {
+            upsampled[lod] = graph.createImage("Bloom upsampled " + std::to_string(lod), {bloomFormat, bloomExtent(lod)});
+        }
+
+        intermediate.reset();
+        if (!swapChain.supportsStorageOutput()) {
+            intermediate = graph.createImage("Tonemapped", {vk::Format::eR16G16B16A16Sfloat, extent});
+        }
+
+        graph.addPass("Histogram and prefilter", [&](RenderGraph::PassBuilder &pass) {
+            pass.sampleImage(sceneColor, vk::PipelineStageFlagBits::eComputeShader);
+            pass.writeStorageImage(downsampled[0]);
+        }, [this](vk::CommandBuffer commandBuffer, const RenderGraph::PassContext &) {
+            recordPrefilter(commandBuffer);
+        });
+
+        // the bloom passes are declared regardless of the settings and skip their dispatch while it's disabled
+        for (uint32_t lod = 1; lod < bloomLevels; lod++) {
+            graph.addPass("Bloom downsample " + std::to_string(lod), [&](RenderGraph::PassBuilder &pass) {
+                pass.sampleImage(downsampled[lod - 1], vk::PipelineStageFlagBits::eComputeShader);
+                pass.writeStorageImage(downsampled[lod]);
+            }, [this, lod](vk::CommandBuffer commandBuffer, const RenderGraph::PassContext &) {
+                if (settings.bloom) {
+                    dispatch(commandBuffer, *downsamplePipeline, downsampleSets[lod], bloomExtent(lod));
+                }
+            });
+        }
+        for (uint32_t lod = bloomLevels - 1; lod-- > 0;) {
+            graph.addPass("Bloom upsample " + std::to_string(lod), [&](RenderGraph::PassBuilder &pass) {
+                pass.sampleImage(upsampled[lod + 1], vk::PipelineStageFlagBits::eComputeShader);
+                pass.sampleImage(downsampled[lod], vk::PipelineStageFlagBits::eComputeShader);
+                pass.writeStorageImage(upsampled[lod]);
+            }, [this, lod](vk::CommandBuffer commandBuffer, const RenderGraph::PassContext &) {
+                if (settings.bloom) {
+                    dispatch(commandBuffer, *upsamplePipeline, upsampleSets[lod], bloomExtent(lod));
+                }
+            });
+        }
+
+        graph.addPass("Tonemap", [&](RenderGraph::PassBuilder &pass) {
+            pass.sampleImage(sceneColor, vk::PipelineStageFlagBits::eComputeShader);
+            pass.sampleImage(upsampled[0], vk::PipelineStageFlagBits::eComputeShader);
+            pass.writeStorageImage(intermediate ? *intermediate : output);
+        }, [this](vk::CommandBuffer commandBuffer, const RenderGraph::PassContext &) {
+            recordResolve(commandBuffer);
+        });
+
+        if (intermediate) {
+            graph.addPass("Blit", [&](RenderGraph::PassBuilder &pass) {
+                pass.copySource(*intermediate);
+                pass.copyDestination(output);
+            }, [this](vk::CommandBuffer commandBuffer, const RenderGraph::PassContext &context) {
+                vk::Offset3D corner{static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+                vk::ImageBlit blit{{vk::ImageAspectFlagBits::eColor, 0, 0, 1}, {vk::Offset3D{0, 0, 0}, corner}, {vk::ImageAspectFlagBits::eColor, 0, 0, 1}, {vk::Offset3D{0, 0, 0}, corner}};
+                commandBuffer.blitImage(context.graph->getImage(*intermediate), vk::ImageLayout::eTransferSrcOptimal,
+                    context.graph->getImage(this->output), vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eNearest);
+            });
+        }
+    }
+
+    vk::DescriptorSet PostProcess::createDescriptorSet(vk::ImageView source, vk::ImageView target, vk::ImageView bloom) {
+        auto exposureInfo = exposureBuffer->descriptorInfo();
+        vk::DescriptorImageInfo sourceInfo{sampler, source, vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::DescriptorImageInfo targetInfo{nullptr, target, vk::ImageLayout::eGeneral};
+        vk::DescriptorImageInfo bloomInfo{sampler, bloom, vk::ImageLayout::eShaderReadOnlyOptimal};
+
+        vk::DescriptorSet descriptorSet;
+        if (!DescriptorWriter(*setLayout, *descriptorPool)
+            .writeImage(0, &sourceInfo)
+            .writeImage(1, &targetInfo)
+            .writeBuffer(2, &exposureInfo)
+            .writeImage(3, &bloomInfo)
+            .build(descriptorSet)) {
+            throw std::runtime_error("failed to allocate post process descriptor set!");
+        }
+        return descriptorSet;
+    }
+
+    void PostProcess::createDescriptorSets(const RenderGraph &graph, SwapChain &swapChain) {
+        uint32_t imageCount = static_cast<uint32_t>(swapChain.imageCount());
+        uint32_t setCount = 1 + 2 * (bloomLevels - 1) + imageCount;
+        // in flight frames may still use the previous graph's sets, the old pool is released with the same delay
+        descriptorPool = DescriptorPool::Builder(device)
+            .setMaxSets(setCount)
+            .addPoolSize(vk::DescriptorType::eCombinedImageSampler, 2 * setCount)
+            .addPoolSize(vk::DescriptorType::eStorageImage, setCount)
+            .addPoolSize(vk::DescriptorType::eStorageBuffer, setCount)
+            .build();
+
+        // bindings a pass doesn't read still get a valid view
+        vk::ImageView sceneView = graph.getImageView(sceneColor);
+        prefilterSet = createDescriptorSet(sceneView, graph.getImageView(downsampled[0]), sceneView);
+
+        downsampleSets.assign(bloomLevels, nullptr);
+        upsampleSets.assign(bloomLevels, nullptr);
+        for (uint32_t lod = 1; lod < bloomLevels; lod++) {
+            vk::ImageView sourceView = graph.getImageView(downsampled[lod - 1]);
+            downsampleSets[lod] = createDescriptorSet(sourceView, graph.getImageView(downsampled[lod]), sourceView);
+        }
+        for (uint32_t lod = 0; lod + 1 < bloomLevels; lod++) {
+            upsampleSets[lod] = createDescriptorSet(
+                graph.getImageView(upsampled[lod + 1]), graph.getImageView(upsampled[lod]), graph.getImageView(downsampled[lod]));
+        }
+
+        resolveSets.resize(imageCount);
+        for (uint32_t i = 0; i < imageCount; i++) {
+            vk::ImageView targetView = intermediate ? graph.getImageView(*intermediate) : swapChain.getImageView(static_cast<int>(i));
+            resolveSets[i] = createDescriptorSet(sceneView, targetView, graph.getImageView(upsampled[0]));
+        }
+    }
+
+    void PostProcess::beginFrame(uint32_t imageIndex) {
+        this->imageIndex = imageIndex;
+        auto now = std::chrono::steady_clock::now();
+        if (lastRecordTime != std::chrono::steady_clock::time_point{}) {
+            float frameTime = std::chrono::duration<float>(now - lastRecordTime).count();
+            adaptation = 1.f - std::exp(-frameTime * settings.adaptationRate);
+        } else {
+            // the first frame starts at the metered exposure
+            adaptation = 1.f;
+        }
+        lastRecordTime = now;
+    }
+
+    void PostProcess::dispatch(vk::CommandBuffer commandBuffer, ComputePipeline &pipeline, vk::DescriptorSet descriptorSet, vk::Extent2D size) {
+        PostProcessPush push{};
+        push.flags = (settings.autoExposure ? AUTO_EXPOSURE : 0) | (settings.bloom ? BLOOM : 0) | (encodeSrgb ? ENCODE_SRGB : 0);
+        push.exposureIndex = exposureIndex;
+        push.exposureCompensation = settings.exposureCompensation;
+        push.bloomThreshold = settings.bloomThreshold;
+        push.bloomIntensity = settings.bloomIntensity;
+        push.adaptation = adaptation;
+
+        pipeline.bind(commandBuffer);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(PostProcessPush), &push);
+        commandBuffer.dispatch(ComputePipeline::groupCount(size.width, GROUP_SIZE), ComputePipeline::groupCount(size.height, GROUP_SIZE), 1);
+    }
+
+    void PostProcess::recordPrefilter(vk::CommandBuffer commandBuffer) {
+        // the previous frame's resolve may still read the exposure and reduce the histogram
+        vk::BufferMemoryBarrier reuseBarrier{
+            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, exposureBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, {},
+            0, nullptr, 1, &reuseBarrier, 0, nullptr);
+
+        // the exposure starts at zero stops, afterwards only the histogram is cleared
+        commandBuffer.fillBuffer(exposureBuffer->getBuffer(), 0, exposureInitialized ? HISTOGRAM_SIZE : VK_WHOLE_SIZE, 0);
+        exposureInitialized = true;
+        vk::BufferMemoryBarrier clearBarrier{
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, exposureBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, 0, nullptr, 1, &clearBarrier, 0, nullptr);
+
+        if (settings.autoExposure || settings.bloom) {
+            dispatch(commandBuffer, *prefilterPipeline, prefilterSet, bloomExtent(0));
+        }
+    }
+
+    void PostProcess::recordResolve(vk::CommandBuffer commandBuffer) {
+        // the graph orders the images between the passes, the histogram the prefilter accumulated is ordered here
+        vk::BufferMemoryBarrier histogramBarrier{
+            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, exposureBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, 0, nullptr, 1, &histogramBarrier, 0, nullptr);
+
+        dispatch(commandBuffer, *resolvePipeline, resolveSets[imageIndex], extent);
+        exposureIndex = 1 - exposureIndex;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "ComputePipeline.hpp"
+#include "Descriptors.hpp"
+#include "Device.hpp"
+#include "RenderGraph.hpp"
+#include "SwapChain.hpp"
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Engine {
+
+    struct PostProcessSettings {
+        // meters the scene with a luminance histogram and adapts to it, otherwise only the compensation applies
+        bool autoExposure = true;
+        // in stops, on top of the metered exposure
+        float exposureCompensation = 0.f;
+        // how quickly auto exposure follows the scene, per second
+        float adaptationRate = 1.5f;
+        bool bloom = true;
+        // exposed luminance above which the scene starts to bloom
+        float bloomThreshold = 1.f;
+        float bloomIntensity = .05f;
+    };
+
+    // Resolves the HDR scene color into the swapchain image with compute passes declared on the render graph, which
+    // orders them and the scene pass with its barriers. The prefilter reads the scene once for both the luminance
+    // histogram and the first bloom level, the bloom chain is blurred on progressively smaller levels, and a single
+    // resolve pass computes the exposure from the histogram, adds the bloom, tonemaps and writes the swapchain image
+    // directly. Swapchains that can't be storage images are written through an intermediate image and a blit.
+    //
+    // The histogram and exposure are shared by every frame, frames on the graphics queue run one after another and
+    // the graph only tracks images, so the passes order the exposure buffer with their own barriers.
+    class PostProcess {
+        public:
+        // keep in sync with PostProcess.glsl
+        static constexpr uint32_t HISTOGRAM_BINS = 256;
+        static constexpr uint32_t AUTO_EXPOSURE = 1;
+        static constexpr uint32_t BLOOM = 2;
+        static constexpr uint32_t ENCODE_SRGB = 4;
+        static constexpr uint32_t MAX_BLOOM_LEVELS = 6;
+
+        PostProcess(Device &device);
+        ~PostProcess();
+
+        PostProcess(const PostProcess &) = delete;
+        PostProcess &operator=(const PostProcess &) = delete;
+
+        void setSettings(const PostProcessSettings &settings) { this->settings = settings; }
+        const PostProcessSettings &getSettings() const { return settings; }
+
+        // Declares the passes reading sceneColor and writing output, the imported swapchain image. The descriptor
+        // sets need the graph's images, create them with createDescriptorSets once it is compiled.
+        void addPasses(RenderGraph &graph, RenderGraphResource sceneColor, RenderGraphResource output, SwapChain &swapChain);
+        void createDescriptorSets(const RenderGraph &graph, SwapChain &swapChain);
+        // Before executing the graph, picks the swapchain image the resolve writes
+        void beginFrame(uint32_t imageIndex);
+
+        private:
+        void createPipelines();
+
+        vk::DescriptorSet createDescriptorSet(vk::ImageView source, vk::ImageView target, vk::ImageView bloom);
+        void recordPrefilter(vk::CommandBuffer commandBuffer);
+        void recordResolve(vk::CommandBuffer commandBuffer);
+        void dispatch(vk::CommandBuffer commandBuffer, ComputePipeline &pipeline, vk::DescriptorSet descriptorSet, vk::Extent2D size);
+        vk::Extent2D bloomExtent(uint32_t lod) const;
+
+        Device &device;
+        PostProcessSettings settings{};
+
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        vk::PipelineLayout pipelineLayout;
+        std::unique_ptr<ComputePipeline> prefilterPipeline;
+        std::unique_ptr<ComputePipeline> downsamplePipeline;
+        std::unique_ptr<ComputePipeline> upsamplePipeline;
+        std::unique_ptr<ComputePipeline> resolvePipeline;
+        vk::Sampler sampler;
+        // of every bloom level
+        vk::Format bloomFormat;
+
+        // luminance histogram followed by the adapted log2 exposure, written on alternating frames
+        std::unique_ptr<Buffer> exposureBuffer;
+        bool exposureInitialized = false;
+        uint32_t exposureIndex = 0;
+        std::chrono::steady_clock::time_point lastRecordTime{};
+        // fraction of the way to the metered exposure covered this frame
+        float adaptation = 1.f;
+        uint32_t imageIndex = 0;
+
+        // everything below is rebuilt with the graph
+        std::unique_ptr<DescriptorPool> descriptorPool;
+        vk::Extent2D extent{};
+        bool encodeSrgb = false;
+        uint32_t bloomLevels = 0;
+        RenderGraphResource sceneColor = 0;
+        RenderGraphResource output = 0;
+        // resolve target when the swapchain images can't be storage images, blitted into them
+        std::optional<RenderGraphResource> intermediate;
+        // the downsampled levels, half resolution and below, and the upsampled ones from the second smallest up
+        std::vector<RenderGraphResource> downsampled;
+        std::vector<RenderGraphResource> upsampled;
+
+        vk::DescriptorSet prefilterSet;
+        // per bloom level, indexed by the level written
+        std::vector<vk::DescriptorSet> downsampleSets;
+        std::vector<vk::DescriptorSet> upsampleSets;
+        // per swapchain image
+        std::vector<vk::DescriptorSet> resolveSets;
+    };
+}
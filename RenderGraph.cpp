@@ -0,0 +1,603 @@
+#include "RenderGraph.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+namespace Engine {
+
+    static constexpr vk::AccessFlags WRITE_ACCESS = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+
+    // *************** Pass Builder *********************
+
+    void RenderGraph::PassBuilder::writeColor(RenderGraphResource resource, std::optional<vk::ClearColorValue> clear) {
+        std::optional<vk::ClearValue> clearValue;
+        if (clear) {
+            clearValue = vk::ClearValue{*clear};
+        }
+        addAccess(resource, AccessType::ColorWrite, vk::PipelineStageFlagBits::eColorAttachmentOutput, clearValue);
+    }
+
+    void RenderGraph::PassBuilder::writeDepth(RenderGraphResource resource, std::optional<float> clearDepth) {
+        std::optional<vk::ClearValue> clearValue;
+        if (clearDepth) {
+            clearValue = vk::ClearValue{vk::ClearDepthStencilValue{*clearDepth, 0}};
+        }
+        addAccess(resource, AccessType::DepthWrite, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, clearValue);
+    }
+
+    void RenderGraph::PassBuilder::readDepth(RenderGraphResource resource) {
+        addAccess(resource, AccessType::DepthRead, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, std::nullopt);
+    }
+
+    void RenderGraph::PassBuilder::sampleImage(RenderGraphResource resource, vk::PipelineStageFlags stages) {
+        addAccess(resource, AccessType::Sampled, stages, std::nullopt);
+    }
+
+    void RenderGraph::PassBuilder::readStorageImage(RenderGraphResource resource, vk::PipelineStageFlags stages) {
+        addAccess(resource, AccessType::StorageRead, stages, std::nullopt);
+    }
+
+    void RenderGraph::PassBuilder::writeStorageImage(RenderGraphResource resource, vk::PipelineStageFlags stages) {
+        addAccess(resource, AccessType::StorageWrite, stages, std::nullopt);
+    }
+
+    void RenderGraph::PassBuilder::copySource(RenderGraphResource resource) {
+        addAccess(resource, AccessType::TransferRead, vk::PipelineStageFlagBits::eTransfer, std::nullopt);
+    }
+
+    void RenderGraph::PassBuilder::copyDestination(RenderGraphResource resource) {
+        addAccess(resource, AccessType::TransferWrite, vk::PipelineStageFlagBits::eTransfer, std::nullopt);
+    }
+
+    void RenderGraph::PassBuilder::useSecondaryCommandBuffers() { graph.passes[passIndex].secondary = true; }
+
+    void RenderGraph::PassBuilder::keepAlive() { graph.passes[passIndex].keepAlive = true; }
+
+    void RenderGraph::PassBuilder::addAccess(RenderGraphResource resource, AccessType type, vk::PipelineStageFlags stages, std::optional<vk::ClearValue> clear) {
+        assert(resource < graph.resources.size() && "Unknown render graph resource");
+        Pass &pass = graph.passes[passIndex];
+        for (const auto &access : pass.accesses) {
+            assert(access.resource != resource && "A pass can only use a render graph resource once");
+        }
+        pass.accesses.push_back({resource, type, stages, clear});
+    }
+
+    // *************** Render Graph *********************
+
+    RenderGraph::RenderGraph(Device &device) : device{device} {}
+
+    RenderGraph::~RenderGraph() { destroy(); }
+
+    RenderGraphResource RenderGraph::createImage(const std::string &name, const RenderGraphImageDesc &desc) {
+        assert(!compiled && "Can't add resources to a compiled render graph");
+        Resource resource{};
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(std::move(resource));
+        return static_cast<RenderGraphResource>(resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::importImage(
+        const std::string &name, vk::Format format, vk::Extent2D extent, vk::ImageLayout initialLayout, vk::ImageLayout finalLayout) {
+        assert(!compiled && "Can't add resources to a compiled render graph");
+        Resource resource{};
+        resource.name = name;
+        resource.desc = {format, extent};
+        resource.imported = true;
+        resource.initialLayout = initialLayout;
+        resource.finalLayout = finalLayout;
+        resource.finalStages = vk::PipelineStageFlagBits::eBottomOfPipe;
+        resources.push_back(std::move(resource));
+        return static_cast<RenderGraphResource>(resources.size() - 1);
+    }
+
+    void RenderGraph::exportImage(RenderGraphResource resource, vk::ImageLayout finalLayout, vk::PipelineStageFlags stages, vk::AccessFlags access) {
+        assert(!compiled && "Can't export resources from a compiled render graph");
+        assert(!resources[resource].imported && "Imported images already leave the graph in their final layout");
+        Resource &exported = resources[resource];
+        exported.exported = true;
+        exported.finalLayout = finalLayout;
+        exported.finalStages = stages;
+        exported.finalAccess = access;
+    }
+
+    void RenderGraph::addPass(const std::string &name, const SetupFunction &setup, ExecuteFunction execute) {
+        assert(!compiled && "Can't add passes to a compiled render graph");
+        Pass pass{};
+        pass.name = name;
+        pass.execute = std::move(execute);
+        passes.push_back(std::move(pass));
+
+        PassBuilder builder{*this, static_cast<uint32_t>(passes.size() - 1)};
+        setup(builder);
+    }
+
+    void RenderGraph::compile() {
+        assert(!compiled && "Render graph already compiled");
+        cullPasses();
+        computeLifetimes();
+        createTransientImages();
+        for (auto &pass : passes) {
+            if (!pass.culled) {
+                createRenderPass(pass);
+            }
+        }
+        compiled = true;
+    }
+
+    void RenderGraph::cullPasses() {
+        std::vector<bool> needed(resources.size(), false);
+        for (size_t i = 0; i < resources.size(); i++) {
+            needed[i] = resources[i].imported || resources[i].exported;
+        }
+
+        // walk backwards, a pass survives if something later needs what it writes
+        for (auto pass = passes.rbegin(); pass != passes.rend(); pass++) {
+            bool live = pass->keepAlive;
+            for (const auto &access : pass->accesses) {
+                bool writes = access.type == AccessType::ColorWrite || access.type == AccessType::DepthWrite ||
+                    access.type == AccessType::StorageWrite || access.type == AccessType::TransferWrite;
+                live = live || (writes && needed[access.resource]);
+            }
+            pass->culled = !live;
+            if (!live) {
+                continue;
+            }
+
+            for (const auto &access : pass->accesses) {
+                // attachments that aren't cleared load what earlier passes wrote
+                bool loads = (access.type == AccessType::ColorWrite || access.type == AccessType::DepthWrite) && !access.clear;
+                bool reads = access.type == AccessType::DepthRead || access.type == AccessType::Sampled ||
+                    access.type == AccessType::StorageRead || access.type == AccessType::StorageWrite ||
+                    access.type == AccessType::TransferRead || access.type == AccessType::TransferWrite;
+                if (loads || reads) {
+                    needed[access.resource] = true;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::computeLifetimes() {
+        for (uint32_t i = 0; i < passes.size(); i++) {
+            if (passes[i].culled) {
+                continue;
+            }
+            for (const auto &access : passes[i].accesses) {
+                Resource &resource = resources[access.resource];
+                resource.firstPass = std::min(resource.firstPass, i);
+                resource.lastPass = std::max(resource.lastPass, i);
+
+                switch (access.type) {
+                    case AccessType::ColorWrite: resource.desc.usage |= vk::ImageUsageFlagBits::eColorAttachment; break;
+                    case AccessType::DepthWrite:
+                    case AccessType::DepthRead: resource.desc.usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment; break;
+                    case AccessType::Sampled: resource.desc.usage |= vk::ImageUsageFlagBits::eSampled; break;
+                    case AccessType::StorageRead:
+                    case AccessType::StorageWrite: resource.desc.usage |= vk::ImageUsageFlagBits::eStorage; break;
+                    case AccessType::TransferRead: resource.desc.usage |= vk::ImageUsageFlagBits::eTransferSrc; break;
+                    case AccessType::TransferWrite: resource.desc.usage |= vk::ImageUsageFlagBits::eTransferDst; break;
+                }
+            }
+        }
+
+        for (auto &resource : resources) {
+            if (resource.exported) {
+                resource.lastPass = static_cast<uint32_t>(passes.size());
+            }
+        }
+    }
+
+    void RenderGraph::createTransientImages() {
+        std::vector<RenderGraphResource> aliased;
+        std::vector<vk::MemoryRequirements> requirements(resources.size());
+
+        for (RenderGraphResource i = 0; i < resources.size(); i++) {
+            Resource &resource = resources[i];
+            if (resource.imported || resource.firstPass == UINT32_MAX) {
+                continue;
+            }
+
+            // attachments that never leave their pass don't need backing memory on tiled gpus
+            const vk::ImageUsageFlags attachmentUsage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment;
+            bool transient = resource.firstPass == resource.lastPass && !resource.exported && !(resource.desc.usage & ~attachmentUsage);
+            vk::ImageUsageFlags usage = resource.desc.usage;
+            if (transient) {
+                usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+            }
+
+            vk::ImageCreateInfo imageInfo{};
+            imageInfo.setImageType(vk::ImageType::e2D);
+            imageInfo.setFormat(resource.desc.format);
+            imageInfo.setExtent({resource.desc.extent.width, resource.desc.extent.height, 1});
+            imageInfo.setMipLevels(1);
+            imageInfo.setArrayLayers(resource.desc.layers);
+            imageInfo.setSamples(vk::SampleCountFlagBits::e1);
+            imageInfo.setTiling(vk::ImageTiling::eOptimal);
+            imageInfo.setUsage(usage);
+            imageInfo.setSharingMode(vk::SharingMode::eExclusive);
+            imageInfo.setInitialLayout(vk::ImageLayout::eUndefined);
+
+            if (device.device().createImage(&imageInfo, nullptr, &resource.image) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to create render graph image!");
+            }
+            device.device().getImageMemoryRequirements(resource.image, &requirements[i]);
+            unaliasedMemorySize += requirements[i].size;
+
+            if (transient && device.hasMemoryType(requirements[i].memoryTypeBits, vk::MemoryPropertyFlagBits::eLazilyAllocated)) {
+                resource.lazyMemory = device.allocateMemory(
+                    requirements[i], vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eLazilyAllocated, MemoryCategory::Attachment);
+                device.device().bindImageMemory(resource.image, resource.lazyMemory, 0);
+            } else {
+                aliased.push_back(i);
+            }
+        }
+
+        // greedy interval assignment, each heap holds one image at a time
+        std::sort(aliased.begin(), aliased.end(), [&](RenderGraphResource a, RenderGraphResource b) {
+            return resources[a].firstPass < resources[b].firstPass;
+        });
+        std::vector<vk::DeviceSize> heapAlignments;
+        for (RenderGraphResource i : aliased) {
+            Resource &resource = resources[i];
+            const vk::MemoryRequirements &required = requirements[i];
+
+            std::optional<uint32_t> chosen;
+            for (uint32_t h = 0; h < heaps.size(); h++) {
+                if (heaps[h].busyUntilPass < resource.firstPass && (heaps[h].memoryTypeBits & required.memoryTypeBits)) {
+                    chosen = h;
+                    break;
+                }
+            }
+            if (!chosen) {
+                heaps.push_back({});
+                heapAlignments.push_back(1);
+                chosen = static_cast<uint32_t>(heaps.size() - 1);
+            }
+
+            Heap &heap = heaps[*chosen];
+            heap.size = std::max(heap.size, required.size);
+            heap.memoryTypeBits &= required.memoryTypeBits;
+            heap.busyUntilPass = resource.lastPass;
+            heapAlignments[*chosen] = std::max(heapAlignments[*chosen], required.alignment);
+            resource.heap = chosen;
+        }
+
+        for (uint32_t h = 0; h < heaps.size(); h++) {
+            vk::MemoryRequirements heapRequirements{heaps[h].size, heapAlignments[h], heaps[h].memoryTypeBits};
+            heaps[h].memory = device.allocateMemory(heapRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Attachment);
+            transientMemorySize += heaps[h].size;
+        }
+
+        for (auto &resource : resources) {
+            if (!resource.image) {
+                continue;
+            }
+            if (resource.heap) {
+                device.device().bindImageMemory(resource.image, heaps[*resource.heap].memory, 0);
+            }
+
+            vk::ImageViewCreateInfo viewInfo{};
+            viewInfo.setImage(resource.image);
+            viewInfo.setViewType(resource.desc.layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D);
+            viewInfo.setFormat(resource.desc.format);
+            viewInfo.setSubresourceRange({aspectFor(resource.desc.format), 0, 1, 0, resource.desc.layers});
+            if (device.device().createImageView(&viewInfo, nullptr, &resource.view) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to create render graph image view!");
+            }
+        }
+    }
+
+    void RenderGraph::createRenderPass(Pass &pass) {
+        std::vector<vk::AttachmentDescription> attachments;
+        std::vector<vk::AttachmentReference> colorRefs;
+        std::optional<vk::AttachmentReference> depthRef;
+
+        uint32_t passIndex = static_cast<uint32_t>(&pass - passes.data());
+        auto describe = [&](const Access &access, vk::ImageLayout layout) {
+            const Resource &resource = resources[access.resource];
+            // earlier passes of this frame, or whatever the owner left in an imported image
+            bool hasContents = resource.firstPass < passIndex || (resource.imported && resource.initialLayout != vk::ImageLayout::eUndefined);
+            bool usedLater = resource.lastPass > passIndex || resource.imported || resource.exported;
+
+            vk::AttachmentDescription attachment{};
+            attachment.setFormat(resource.desc.format);
+            attachment.setSamples(vk::SampleCountFlagBits::e1);
+            attachment.setLoadOp(access.clear ? vk::AttachmentLoadOp::eClear : hasContents ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare);
+            attachment.setStoreOp(usedLater ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare);
+            attachment.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare);
+            attachment.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare);
+            // the graph transitions images with barriers outside the render pass
+            attachment.setInitialLayout(layout);
+            attachment.setFinalLayout(layout);
+
+            if (pass.attachments.empty()) {
+                pass.extent = resource.desc.extent;
+            }
+            assert(pass.extent == resource.desc.extent && "Attachments of a render graph pass need matching extents");
+            pass.attachments.push_back(access.resource);
+            pass.clearValues.push_back(access.clear.value_or(vk::ClearValue{}));
+            attachments.push_back(attachment);
+        };
+
+        for (const auto &access : pass.accesses) {
+            if (access.type == AccessType::ColorWrite) {
+                colorRefs.push_back({static_cast<uint32_t>(attachments.size()), vk::ImageLayout::eColorAttachmentOptimal});
+                describe(access, vk::ImageLayout::eColorAttachmentOptimal);
+            }
+        }
+        for (const auto &access : pass.accesses) {
+            if (access.type == AccessType::DepthWrite || access.type == AccessType::DepthRead) {
+                assert(!depthRef && "A render graph pass can only have one depth attachment");
+                vk::ImageLayout layout = access.type == AccessType::DepthWrite ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+                depthRef = vk::AttachmentReference{static_cast<uint32_t>(attachments.size()), layout};
+                describe(access, layout);
+            }
+        }
+
+        if (attachments.empty()) {
+            return;
+        }
+
+        vk::SubpassDescription subpass{};
+        subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics);
+        subpass.setColorAttachmentCount(static_cast<uint32_t>(colorRefs.size()));
+        subpass.setPColorAttachments(colorRefs.data());
+        if (depthRef) {
+            subpass.setPDepthStencilAttachment(&*depthRef);
+        }
+
+        vk::RenderPassCreateInfo renderPassInfo{{}, static_cast<uint32_t>(attachments.size()), attachments.data(), 1, &subpass};
+        if (device.device().createRenderPass(&renderPassInfo, nullptr, &pass.renderPass) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create render graph render pass!");
+        }
+    }
+
+    vk::Framebuffer RenderGraph::getFramebuffer(Pass &pass) {
+        std::vector<VkImageView> views;
+        for (RenderGraphResource resource : pass.attachments) {
+            assert(resources[resource].view && "Imported render graph image has not been set");
+            views.push_back(static_cast<VkImageView>(resources[resource].view));
+        }
+
+        auto it = pass.framebuffers.find(views);
+        if (it != pass.framebuffers.end()) {
+            return it->second;
+        }
+
+        std::vector<vk::ImageView> attachments(views.begin(), views.end());
+        vk::FramebufferCreateInfo framebufferInfo{
+            {}, pass.renderPass, static_cast<uint32_t>(attachments.size()), attachments.data(), pass.extent.width, pass.extent.height, 1};
+
+        vk::Framebuffer framebuffer;
+        if (device.device().createFramebuffer(&framebufferInfo, nullptr, &framebuffer) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create render graph framebuffer!");
+        }
+        pass.framebuffers.emplace(std::move(views), framebuffer);
+        return framebuffer;
+    }
+
+    void RenderGraph::setImportedImage(RenderGraphResource resource, vk::Image image, vk::ImageView imageView) {
+        assert(resources[resource].imported && "Only imported render graph images can be replaced");
+        resources[resource].image = image;
+        resources[resource].view = imageView;
+    }
+
+    void RenderGraph::execute(vk::CommandBuffer commandBuffer) {
+        assert(compiled && "Render graph has to be compiled before it is executed");
+
+        for (auto &resource : resources) {
+            if (resource.imported) {
+                // whatever the owner did before, e.g. the acquire semaphore wait of a swap chain image
+                resource.state = {resource.initialLayout, vk::PipelineStageFlagBits::eAllCommands, {}};
+            }
+        }
+
+        for (uint32_t i = 0; i < passes.size(); i++) {
+            Pass &pass = passes[i];
+            if (pass.culled) {
+                continue;
+            }
+
+            std::vector<vk::ImageMemoryBarrier> barriers;
+            vk::PipelineStageFlags srcStages{};
+            vk::PipelineStageFlags dstStages{};
+            for (const auto &access : pass.accesses) {
+                Resource &resource = resources[access.resource];
+                ResourceState target = stateFor(access);
+                // the first use of a transient image this frame discards its contents, and an aliased one waits for the
+                // heap's previous occupant instead of its own last use
+                bool discard = !resource.imported && resource.firstPass == i;
+                ResourceState previous = discard && resource.heap ? heaps[*resource.heap].state : resource.state;
+
+                bool hazard = previous.layout != target.layout || discard || (previous.access & WRITE_ACCESS) || (target.access & WRITE_ACCESS);
+                if (hazard) {
+                    vk::ImageMemoryBarrier barrier{
+                        previous.access, target.access, discard ? vk::ImageLayout::eUndefined : previous.layout, target.layout,
+                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image,
+                        {aspectFor(resource.desc.format), 0, 1, 0, resource.desc.layers}};
+                    barriers.push_back(barrier);
+                    srcStages |= previous.stages;
+                    dstStages |= target.stages;
+                }
+
+                resource.state = target;
+                if (resource.heap) {
+                    heaps[*resource.heap].state = target;
+                }
+            }
+            if (!barriers.empty()) {
+                commandBuffer.pipelineBarrier(srcStages, dstStages, {}, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+            }
+
+            PassContext context{pass.renderPass, nullptr, pass.extent, this};
+            // outside the render pass, scopes can't be recorded in a subpass with secondary contents
+            GpuProfiler::Scope scope{device.gpuProfiler(), commandBuffer, pass.name.c_str()};
+            if (pass.renderPass) {
+                context.framebuffer = getFramebuffer(pass);
+                vk::RenderPassBeginInfo renderPassInfo{pass.renderPass, context.framebuffer, {{0, 0}, pass.extent},
+                    static_cast<uint32_t>(pass.clearValues.size()), pass.clearValues.data()};
+                commandBuffer.beginRenderPass(&renderPassInfo, pass.secondary ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+
+                if (!pass.secondary) {
+                    vk::Viewport viewport{0.f, 0.f, static_cast<float>(pass.extent.width), static_cast<float>(pass.extent.height), 0.f, 1.f};
+                    vk::Rect2D scissor{{0, 0}, pass.extent};
+                    commandBuffer.setViewport(0, 1, &viewport);
+                    commandBuffer.setScissor(0, 1, &scissor);
+                }
+            }
+
+            pass.execute(commandBuffer, context);
+
+            if (pass.renderPass) {
+                commandBuffer.endRenderPass();
+            }
+        }
+
+        // hand imported and exported images back in the layout their owners expect
+        std::vector<vk::ImageMemoryBarrier> barriers;
+        vk::PipelineStageFlags srcStages{};
+        vk::PipelineStageFlags dstStages{};
+        for (auto &resource : resources) {
+            if (!(resource.imported || resource.exported) || resource.firstPass == UINT32_MAX) {
+                continue;
+            }
+            vk::ImageMemoryBarrier barrier{
+                resource.state.access, resource.finalAccess, resource.state.layout, resource.finalLayout,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.image,
+                {aspectFor(resource.desc.format), 0, 1, 0, resource.desc.layers}};
+            barriers.push_back(barrier);
+            srcStages |= resource.state.stages;
+            dstStages |= resource.finalStages;
+            resource.state = {resource.finalLayout, resource.finalStages, resource.finalAccess};
+        }
+        if (!barriers.empty()) {
+            commandBuffer.pipelineBarrier(srcStages, dstStages, {}, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+        }
+    }
+
+    vk::ImageView RenderGraph::getImageView(RenderGraphResource resource) const { return resources[resource].view; }
+
+    vk::Image RenderGraph::getImage(RenderGraphResource resource) const { return resources[resource].image; }
+
+    vk::RenderPass RenderGraph::getRenderPass(const std::string &passName) const {
+        for (const auto &pass : passes) {
+            if (pass.name == passName) {
+                return pass.renderPass;
+            }
+        }
+        throw std::runtime_error("unknown render graph pass: " + passName);
+    }
+
+    bool RenderGraph::isPassCulled(const std::string &passName) const {
+        for (const auto &pass : passes) {
+            if (pass.name == passName) {
+                return pass.culled;
+            }
+        }
+        throw std::runtime_error("unknown render graph pass: " + passName);
+    }
+
+    void RenderGraph::destroy() {
+        std::vector<vk::Framebuffer> framebuffers;
+        std::vector<vk::RenderPass> renderPasses;
+        for (auto &pass : passes) {
+            for (auto &entry : pass.framebuffers) {
+                framebuffers.push_back(entry.second);
+            }
+            if (pass.renderPass) {
+                renderPasses.push_back(pass.renderPass);
+            }
+        }
+
+        std::vector<vk::ImageView> views;
+        std::vector<vk::Image> images;
+        std::vector<vk::DeviceMemory> memories;
+        for (auto &resource : resources) {
+            if (resource.imported) {
+                continue;
+            }
+            if (resource.view) {
+                views.push_back(resource.view);
+            }
+            if (resource.image) {
+                images.push_back(resource.image);
+            }
+            if (resource.lazyMemory) {
+                memories.push_back(resource.lazyMemory);
+            }
+        }
+        for (auto &heap : heaps) {
+            memories.push_back(heap.memory);
+        }
+
+        // frames in flight may still render with these
+        device.deletionQueue().push([
+            owner = &device,
+            device = device.device(),
+            framebuffers = std::move(framebuffers),
+            renderPasses = std::move(renderPasses),
+            views = std::move(views),
+            images = std::move(images),
+            memories = std::move(memories)]() {
+            for (auto framebuffer : framebuffers) {
+                device.destroyFramebuffer(framebuffer, nullptr);
+            }
+            for (auto renderPass : renderPasses) {
+                device.destroyRenderPass(renderPass, nullptr);
+            }
+            for (auto view : views) {
+                device.destroyImageView(view, nullptr);
+            }
+            for (auto image : images) {
+                device.destroyImage(image, nullptr);
+            }
+            for (auto memory : memories) {
+                owner->freeMemory(memory);
+            }
+        });
+    }
+
+    vk::ImageAspectFlags RenderGraph::aspectFor(vk::Format format) {
+        switch (format) {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eX8D24UnormPack32:
+            case vk::Format::eD32Sfloat:
+                return vk::ImageAspectFlagBits::eDepth;
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            case vk::Format::eS8Uint:
+                return vk::ImageAspectFlagBits::eStencil;
+            default:
+                return vk::ImageAspectFlagBits::eColor;
+        }
+    }
+
+    RenderGraph::ResourceState RenderGraph::stateFor(const Access &access) {
+        switch (access.type) {
+            case AccessType::ColorWrite:
+                return {vk::ImageLayout::eColorAttachmentOptimal, access.stages, vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite};
+            case AccessType::DepthWrite:
+                return {vk::ImageLayout::eDepthStencilAttachmentOptimal, access.stages,
+                    vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite};
+            case AccessType::DepthRead:
+                return {vk::ImageLayout::eDepthStencilReadOnlyOptimal, access.stages, vk::AccessFlagBits::eDepthStencilAttachmentRead};
+            case AccessType::Sampled:
+                return {vk::ImageLayout::eShaderReadOnlyOptimal, access.stages, vk::AccessFlagBits::eShaderRead};
+            case AccessType::StorageRead:
+                return {vk::ImageLayout::eGeneral, access.stages, vk::AccessFlagBits::eShaderRead};
+            case AccessType::StorageWrite:
+                return {vk::ImageLayout::eGeneral, access.stages, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite};
+            case AccessType::TransferRead:
+                return {vk::ImageLayout::eTransferSrcOptimal, access.stages, vk::AccessFlagBits::eTransferRead};
+            case AccessType::TransferWrite:
+                return {vk::ImageLayout::eTransferDstOptimal, access.stages, vk::AccessFlagBits::eTransferWrite};
+        }
+        return {};
+    }
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "Device.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Engine {
+
+    using RenderGraphResource = uint32_t;
+
+    struct RenderGraphImageDesc {
+        vk::Format format;
+        vk::Extent2D extent;
+        uint32_t layers = 1;
+        // usage implied by the passes is added on compile
+        vk::ImageUsageFlags usage{};
+    };
+
+    // Passes declare the images they read and write, the graph orders nothing itself but derives every barrier and
+    // layout transition from those declarations, culls passes whose results are never used and creates a render pass
+    // for each pass with attachments. Transient images whose lifetimes don't overlap share memory, attachments that
+    // live inside a single pass use lazily allocated memory where the device has it.
+    //
+    // The graph is declared and compiled once, e.g. whenever the swap chain is recreated, and executed every frame.
+    class RenderGraph {
+        enum class AccessType { ColorWrite, DepthWrite, DepthRead, Sampled, StorageRead, StorageWrite, TransferRead, TransferWrite };
+
+        public:
+        // Records how a pass uses its images while it is being declared
+        class PassBuilder {
+            public:
+            // loads the previous contents unless a clear value is given
+            void writeColor(RenderGraphResource resource, std::optional<vk::ClearColorValue> clear = std::nullopt);
+            void writeDepth(RenderGraphResource resource, std::optional<float> clearDepth = std::nullopt);
+            // depth test against an earlier pass's depth without writing it
+            void readDepth(RenderGraphResource resource);
+            void sampleImage(RenderGraphResource resource, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+            void readStorageImage(RenderGraphResource resource, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+            void writeStorageImage(RenderGraphResource resource, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+            // source and destination of copies and blits recorded by the pass
+            void copySource(RenderGraphResource resource);
+            void copyDestination(RenderGraphResource resource);
+            // the pass is recorded into secondary command buffers, see PassContext::getInheritanceInfo
+            void useSecondaryCommandBuffers();
+            // never culled, for passes with side effects outside the graph
+            void keepAlive();
+
+            private:
+            friend class RenderGraph;
+            PassBuilder(RenderGraph &graph, uint32_t passIndex) : graph{graph}, passIndex{passIndex} {}
+
+            void addAccess(RenderGraphResource resource, AccessType type, vk::PipelineStageFlags stages, std::optional<vk::ClearValue> clear);
+
+            RenderGraph &graph;
+            uint32_t passIndex;
+        };
+
+        // What a pass sees while it executes, render pass and framebuffer are null for passes without attachments
+        struct PassContext {
+            vk::RenderPass renderPass;
+            vk::Framebuffer framebuffer;
+            vk::Extent2D extent;
+            const RenderGraph *graph;
+
+            vk::ImageView getImageView(RenderGraphResource resource) const { return graph->getImageView(resource); }
+            vk::CommandBufferInheritanceInfo getInheritanceInfo() const { return {renderPass, 0, framebuffer}; }
+        };
+
+        using SetupFunction = std::function<void(PassBuilder &)>;
+        using ExecuteFunction = std::function<void(vk::CommandBuffer, const PassContext &)>;
+
+        RenderGraph(Device &device);
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph &operator=(const RenderGraph &) = delete;
+
+        RenderGraphResource createImage(const std::string &name, const RenderGraphImageDesc &desc);
+        // Image owned outside the graph, e.g. a swap chain image. It is left in finalLayout after execute and may change
+        // every frame through setImportedImage. Writing an imported image keeps the pass alive.
+        RenderGraphResource importImage(
+            const std::string &name, vk::Format format, vk::Extent2D extent, vk::ImageLayout initialLayout, vk::ImageLayout finalLayout);
+        // Keeps a transient image alive past the last pass and leaves it in finalLayout for use outside the graph
+        void exportImage(RenderGraphResource resource, vk::ImageLayout finalLayout, vk::PipelineStageFlags stages, vk::AccessFlags access);
+
+        void addPass(const std::string &name, const SetupFunction &setup, ExecuteFunction execute);
+
+        // Culls passes, allocates transient images and creates render passes, call once after declaring everything
+        void compile();
+        // Swap chain images change every frame, framebuffers are cached per set of image views
+        void setImportedImage(RenderGraphResource resource, vk::Image image, vk::ImageView imageView);
+        void execute(vk::CommandBuffer commandBuffer);
+
+        vk::ImageView getImageView(RenderGraphResource resource) const;
+        vk::Image getImage(RenderGraphResource resource) const;
+        // Pipelines for a pass are created against this, null for passes without attachments or that were culled
+        vk::RenderPass getRenderPass(const std::string &passName) const;
+        bool isPassCulled(const std::string &passName) const;
+
+        // bytes of transient memory after aliasing, and what the images would take without it
+        vk::DeviceSize getTransientMemorySize() const { return transientMemorySize; }
+        vk::DeviceSize getUnaliasedMemorySize() const { return unaliasedMemorySize; }
+
+        private:
+        struct Access {
+            RenderGraphResource resource;
+            AccessType type;
+            vk::PipelineStageFlags stages;
+            std::optional<vk::ClearValue> clear;
+        };
+
+        struct Pass {
+            std::string name;
+            ExecuteFunction execute;
+            std::vector<Access> accesses;
+            bool secondary = false;
+            bool keepAlive = false;
+
+            bool culled = false;
+            vk::RenderPass renderPass;
+            vk::Extent2D extent{};
+            // attachments in render pass order, colors first
+            std::vector<RenderGraphResource> attachments;
+            std::vector<vk::ClearValue> clearValues;
+            std::map<std::vector<VkImageView>, vk::Framebuffer> framebuffers;
+        };
+
+        struct ResourceState {
+            vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+            vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eTopOfPipe;
+            vk::AccessFlags access{};
+        };
+
+        struct Resource {
+            std::string name;
+            RenderGraphImageDesc desc;
+            bool imported = false;
+            vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+
+            bool exported = false;
+            vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+            vk::PipelineStageFlags finalStages{};
+            vk::AccessFlags finalAccess{};
+
+            vk::Image image;
+            vk::ImageView view;
+            // index into heaps, or the resource's own lazily allocated memory
+            std::optional<uint32_t> heap;
+            vk::DeviceMemory lazyMemory;
+
+            // first and last live pass using the resource
+            uint32_t firstPass = UINT32_MAX;
+            uint32_t lastPass = 0;
+            ResourceState state{};
+        };
+
+        // memory shared by transient images with disjoint lifetimes, barriers for a new occupant wait on the last use
+        struct Heap {
+            vk::DeviceMemory memory;
+            vk::DeviceSize size = 0;
+            uint32_t memoryTypeBits = ~0u;
+            uint32_t busyUntilPass = 0;
+            ResourceState state{};
+        };
+
+        void cullPasses();
+        void computeLifetimes();
+        void createTransientImages();
+        void createRenderPass(Pass &pass);
+        vk::Framebuffer getFramebuffer(Pass &pass);
+        void destroy();
+
+        static vk::ImageAspectFlags aspectFor(vk::Format format);
+        static ResourceState stateFor(const Access &access);
+
+        Device &device;
+        std::vector<Pass> passes;
+        std::vector<Resource> resources;
+        std::vector<Heap> heaps;
+        bool compiled = false;
+
+        vk::DeviceSize transientMemorySize = 0;
+        vk::DeviceSize unaliasedMemorySize = 0;
+    };
+}
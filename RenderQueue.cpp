@@ -0,0 +1,58 @@
+#include "RenderQueue.hpp"
+
+// std
+#include <array>
+#include <cstring>
+
+namespace Engine {
+
+    uint64_t RenderQueue::makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDepth) {
+        return (static_cast<uint64_t>(pipeline & 0xff) << 56) | (static_cast<uint64_t>(material & 0xffff) << 40) |
+            (static_cast<uint64_t>(mesh & 0xffff) << 24) | quantizeDepth(viewDepth);
+    }
+
+    uint32_t RenderQueue::quantizeDepth(float viewDepth) {
+        if (!(viewDepth > 0.f)) {
+            return 0;
+        }
+        // positive floats order like their bit patterns, the top 24 of the 31 non-sign bits keep ~16 bits of mantissa
+        uint32_t bits;
+        std::memcpy(&bits, &viewDepth, sizeof(bits));
+        return bits >> 7;
+    }
+
+    void RenderQueue::sort() {
+        if (items.size() < 2) {
+            return;
+        }
+
+        // one pass over the items builds the histograms for all eight bytes
+        std::array<std::array<uint32_t, 256>, 8> histograms{};
+        for (const auto &item : items) {
+            for (uint32_t byte = 0; byte < 8; byte++) {
+                histograms[byte][(item.key >> (8 * byte)) & 0xff]++;
+            }
+        }
+
+        scratch.resize(items.size());
+        uint32_t count = static_cast<uint32_t>(items.size());
+        for (uint32_t byte = 0; byte < 8; byte++) {
+            auto &histogram = histograms[byte];
+            // all keys share this byte, e.g. a single pipeline, nothing to reorder
+            if (histogram[(items[0].key >> (8 * byte)) & 0xff] == count) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (auto &bucket : histogram) {
+                uint32_t bucketSize = bucket;
+                bucket = offset;
+                offset += bucketSize;
+            }
+            for (const auto &item : items) {
+                scratch[histogram[(item.key >> (8 * byte)) & 0xff]++] = item;
+            }
+            items.swap(scratch);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+
+    // Per-frame list of draws ordered by a 64 bit key. From the most significant bits down the key holds
+    //   pipeline (8) | material (16) | mesh (16) | view depth (24)
+    // so draws sharing state end up next to each other, and within a mesh they are sorted front to back for early-z.
+    class RenderQueue {
+        public:
+        struct Item {
+            uint64_t key;
+            // caller defined, e.g. an index into the visible objects
+            uint32_t index;
+        };
+
+        static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDepth);
+        // Order preserving 24 bit quantization, distances behind the camera clamp to zero
+        static uint32_t quantizeDepth(float viewDepth);
+
+        void clear() { items.clear(); }
+        void reserve(size_t count) { items.reserve(count); }
+        void push(uint64_t key, uint32_t index) { items.push_back({key, index}); }
+
+        // Stable LSD radix sort over the key bytes, bytes that are equal for every item are skipped
+        void sort();
+
+        const std::vector<Item> &getItems() const { return items; }
+        size_t size() const { return items.size(); }
+
+        private:
+        std::vector<Item> items;
+        std::vector<Item> scratch;
+    };
+}
@@ -1,5 +1,8 @@
 #include "RenderSystem.hpp"
 
+#include "CpuProfiler.hpp"
+#include "SwapChain.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -7,6 +10,7 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
@@ -18,20 +22,53 @@ namespace Engine {
         glm::mat4 normalMatrix{1.f};
     };
 
-    RenderSystem::RenderSystem(Device& device, vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout)
-        : device{device} {
+    // per object entry of the bindless object buffer, same layout as PushConstantData
+    using ObjectData = PushConstantData;
+
+    struct BindlessPushConstantData {
+        uint32_t objectBuffer;
+        uint32_t objectIndex;
+    };
+
+    DrawStats &DrawStats::operator+=(const DrawStats &other) {
+        draws += other.draws;
+        pipelineBinds += other.pipelineBinds;
+        descriptorBinds += other.descriptorBinds;
+        materialBinds += other.materialBinds;
+        meshBinds += other.meshBinds;
+        meshBindsSkipped += other.meshBindsSkipped;
+        return *this;
+    }
+
+    RenderSystem::RenderSystem(
+        Device& device,
+        vk::DescriptorSetLayout globalSetLayout,
+        MaterialSystem& materials,
+        BindlessDescriptors *bindless)
+        : device{device}, materials{materials}, bindless{bindless} {
+        if (bindless) {
+            objectBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+            objectBufferHandles.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        }
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
     }
 
     RenderSystem::~RenderSystem() {
-        device.device().destroyPipelineLayout(pipelineLayout, nullptr);
+        destroyThreadCommandPools();
+        for (auto handle : objectBufferHandles) {
+            bindless->freeStorageBuffer(handle);
+        }
+        device.deferDestroy(pipelineLayout);
     }
 
     void RenderSystem::createPipelineLayout(vk::DescriptorSetLayout globalSetLayout) {
-        vk::PushConstantRange pushConstantRange{{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment}, 0, sizeof(PushConstantData)};
+        uint32_t pushConstantSize = bindless ? sizeof(BindlessPushConstantData) : sizeof(PushConstantData);
+        vk::PushConstantRange pushConstantRange{{vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment}, 0, pushConstantSize};
 
-        std::vector<vk::DescriptorSetLayout> descriptorSetLayout{globalSetLayout};
+        std::vector<vk::DescriptorSetLayout> descriptorSetLayout{globalSetLayout, materials.getDescriptorSetLayout()};
+        if (bindless) {
+            descriptorSetLayout.push_back(bindless->getDescriptorSetLayout());
+        }
 
         vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, static_cast<uint32_t>(descriptorSetLayout.size()), descriptorSetLayout.data(), 1, &pushConstantRange};
         if (device.device().createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess) {
@@ -39,41 +76,292 @@ namespace Engine {
         }
     }
 
-    void RenderSystem::createPipeline(vk::RenderPass renderPass) {
+    void RenderSystem::createPipelines(vk::RenderPass renderPass, vk::RenderPass depthRenderPass) {
         assert(pipelineLayout && "Cannot create pipeline before pipeline layout");
 
-        PipelineConfigInfo pipelineConfig{};
-        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        pipeline = std::make_unique<Pipeline>(
-            device,
-            "./Shaders/Shader.vert.spv",
-            "./Shaders/Shader.frag.spv",
-            pipelineConfig);
+        const char *vertFilepath = bindless ? "./Shaders/Bindless.vert.spv" : "./Shaders/Shader.vert.spv";
+        const char *depthVertFilepath = bindless ? "./Shaders/BindlessDepth.vert.spv" : "./Shaders/Depth.vert.spv";
+        // the bindless variant also samples material textures from the bindless set
+        const char *fragFilepath = bindless ? "./Shaders/BindlessShader.frag.spv" : "./Shaders/Shader.frag.spv";
+
+        pipelines.resize(static_cast<size_t>(MaterialPipeline::Count));
+        for (size_t variant = 0; variant < pipelines.size(); variant++) {
+            vk::CullModeFlags cullMode = static_cast<MaterialPipeline>(variant) == MaterialPipeline::OpaqueCulled
+                ? vk::CullModeFlags{vk::CullModeFlagBits::eBack}
+                : vk::CullModeFlags{vk::CullModeFlagBits::eNone};
+
+            if (!pipelines[variant].pipeline) {
+                PipelineConfigInfo pipelineConfig{};
+                Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+                pipelineConfig.renderPass = renderPass;
+                pipelineConfig.pipelineLayout = pipelineLayout;
+                pipelineConfig.rasterizationInfo.setCullMode(cullMode);
+                pipelines[variant].pipeline = std::make_unique<Pipeline>(device, vertFilepath, fragFilepath, pipelineConfig);
+
+                pipelineConfig.depthStencilInfo.setDepthWriteEnable(false);
+                pipelineConfig.depthStencilInfo.setDepthCompareOp(vk::CompareOp::eEqual);
+                pipelines[variant].equalDepthPipeline = std::make_unique<Pipeline>(device, vertFilepath, fragFilepath, pipelineConfig);
+            }
+
+            if (!pipelines[variant].depthPipeline && depthRenderPass) {
+                // no fragment shader and no color attachment
+                PipelineConfigInfo depthConfig{};
+                Pipeline::defaultPipelineConfigInfo(depthConfig);
+                depthConfig.renderPass = depthRenderPass;
+                depthConfig.pipelineLayout = pipelineLayout;
+                depthConfig.rasterizationInfo.setCullMode(cullMode);
+                depthConfig.bindingDescriptions = Model::Vertex::getPositionBindingDescriptions();
+                depthConfig.attributeDescriptions = Model::Vertex::getPositionAttributeDescriptions();
+                depthConfig.colorBlendInfo.setAttachmentCount(0);
+                pipelines[variant].depthPipeline = std::make_unique<Pipeline>(device, depthVertFilepath, "", depthConfig);
+            }
+        }
+    }
+
+    void RenderSystem::renderDepthPrepass(FrameInfo& frameInfo) {
+        CpuProfiler::Zone zone{"Record depth draws"};
+        bindFrameState(frameInfo.commandBuffer, frameInfo, drawStats);
+        recordDraws(frameInfo.commandBuffer, frameInfo, 0, static_cast<uint32_t>(visibleObjects.size()), true, drawStats);
     }
 
     void RenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-        pipeline->bind(frameInfo.commandBuffer);
-
-        frameInfo.commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
-
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if(obj.model == nullptr) continue;
-            PushConstantData push{};
-            push.modelMatrix = obj.transform.mat4();
-            push.normalMatrix = obj.transform.normalMatrix();
-
-            vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(PushConstantData),
-                &push);
-            obj.model->bind(frameInfo.commandBuffer);
-            obj.model->draw(frameInfo.commandBuffer);
+        CpuProfiler::Zone zone{"Record draws"};
+        bindFrameState(frameInfo.commandBuffer, frameInfo, drawStats);
+        recordDraws(frameInfo.commandBuffer, frameInfo, 0, static_cast<uint32_t>(visibleObjects.size()), false, drawStats);
+    }
+
+    void RenderSystem::renderDepthPrepassParallel(
+        FrameInfo& frameInfo,
+        ThreadPool& threadPool,
+        uint32_t threadCount,
+        const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+        vk::Extent2D extent) {
+        recordParallel(frameInfo, threadPool, threadCount, inheritanceInfo, extent, true);
+    }
+
+    void RenderSystem::renderGameObjectsParallel(
+        FrameInfo& frameInfo,
+        ThreadPool& threadPool,
+        uint32_t threadCount,
+        const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+        vk::Extent2D extent) {
+        recordParallel(frameInfo, threadPool, threadCount, inheritanceInfo, extent, false);
+    }
+
+    void RenderSystem::recordParallel(
+        FrameInfo& frameInfo,
+        ThreadPool& threadPool,
+        uint32_t threadCount,
+        const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+        vk::Extent2D extent,
+        bool depthOnly) {
+        assert(threadCount > 0 && threadCount <= threadPool.size() && "Invalid recording thread count");
+        createThreadCommandPools(threadPool.size());
+
+        auto& commandPools = threadCommandPools[frameInfo.frameIndex];
+        auto& commandBuffers = threadCommandBuffers[frameInfo.frameIndex];
+        uint32_t poolCount = static_cast<uint32_t>(commandPools.size());
+        // the depth prepass buffers come first, the lit pass buffers after them
+        uint32_t firstBuffer = depthOnly ? 0 : poolCount;
+        uint32_t objectCount = static_cast<uint32_t>(visibleObjects.size());
+        uint32_t objectsPerThread = (objectCount + threadCount - 1) / threadCount;
+        threadDrawStats.assign(threadCount, {});
+
+        threadPool.run(threadCount, [&](uint32_t threadIndex) {
+            CpuProfiler::Zone zone{"Record secondary"};
+            // the pool is only touched by this thread, and the last frame using it has completed. With a prepass it
+            // was reset before recording the depth buffer, which the lit buffer is recorded after.
+            if (depthOnly || !depthPrepass) {
+                device.device().resetCommandPool(commandPools[threadIndex], {});
+            }
+
+            vk::CommandBuffer commandBuffer = commandBuffers[firstBuffer + threadIndex];
+            vk::CommandBufferBeginInfo beginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritanceInfo};
+            if (commandBuffer.begin(&beginInfo) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to begin recording secondary command buffer!");
+            }
+            vk::Viewport viewport{0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f};
+            vk::Rect2D scissor{{0, 0}, extent};
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+
+            uint32_t first = std::min(objectCount, threadIndex * objectsPerThread);
+            uint32_t last = std::min(objectCount, first + objectsPerThread);
+            DrawStats &stats = threadDrawStats[threadIndex];
+            bindFrameState(commandBuffer, frameInfo, stats);
+            recordDraws(commandBuffer, frameInfo, first, last, depthOnly, stats);
+            commandBuffer.end();
+        });
+        for (const auto& stats : threadDrawStats) {
+            drawStats += stats;
+        }
+
+        frameInfo.commandBuffer.executeCommands(threadCount, commandBuffers.data() + firstBuffer);
+    }
+
+    void RenderSystem::prepareFrame(FrameInfo& frameInfo) {
+        drawStats = {};
+        queuedObjects.clear();
+        renderQueue.clear();
+        renderQueue.reserve(frameInfo.gameObjects.size());
+
+        {
+            CpuProfiler::Zone zone{"Sort draws"};
+            // draws group by pipeline variant, then material, then mesh, and go front to back within a mesh
+            const glm::mat4& view = frameInfo.camera.getView();
+            for (auto& kv : frameInfo.gameObjects) {
+                GameObject& obj = kv.second;
+                if (obj.model == nullptr) {
+                    continue;
+                }
+                const Material& material = obj.material ? *obj.material : materials.getDefaultMaterial();
+                float viewDepth = view[0][2] * obj.transform.translation.x + view[1][2] * obj.transform.translation.y +
+                    view[2][2] * obj.transform.translation.z + view[3][2];
+                uint64_t key = RenderQueue::makeKey(static_cast<uint32_t>(material.getPipeline()), material.getId(), obj.model->getId(), viewDepth);
+                renderQueue.push(key, static_cast<uint32_t>(queuedObjects.size()));
+                queuedObjects.push_back(&obj);
+            }
+            renderQueue.sort();
+
+            visibleObjects.clear();
+            for (const auto& item : renderQueue.getItems()) {
+                visibleObjects.push_back(queuedObjects[item.index]);
+            }
+        }
+
+        if (bindless) {
+            reserveObjectBuffer(frameInfo.frameIndex, static_cast<uint32_t>(visibleObjects.size()));
+        }
+    }
+
+    void RenderSystem::bindFrameState(vk::CommandBuffer commandBuffer, FrameInfo& frameInfo, DrawStats& stats) {
+        // pipelines and materials are bound per draw as they change, they share this layout
+        stats.descriptorBinds++;
+
+        // global ubo, lights, clusters and virtual texture feedback
+        std::array<uint32_t, 4> dynamicOffsets{
+            frameInfo.globalUboOffset, frameInfo.lightingOffsets[0], frameInfo.lightingOffsets[1], frameInfo.virtualTextureFeedbackOffset};
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet,
+            static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+        if (bindless) {
+            vk::DescriptorSet bindlessSet = bindless->getDescriptorSet();
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 2, 1, &bindlessSet, 0, nullptr);
+            stats.descriptorBinds++;
+        }
+    }
+
+    void RenderSystem::recordDraws(vk::CommandBuffer commandBuffer, FrameInfo& frameInfo, uint32_t first, uint32_t last, bool depthOnly, DrawStats& stats) {
+        auto objects = bindless ? static_cast<ObjectData*>(objectBuffers[frameInfo.frameIndex]->getMappedMemory()) : nullptr;
+        // object data is written by whichever pass is recorded first
+        bool writeObjects = depthOnly || !depthPrepass;
+        const Model* boundModel = nullptr;
+        const Pipeline* boundPipeline = nullptr;
+        const Material* boundMaterial = nullptr;
+        vk::DescriptorSet materialSet = materials.getDescriptorSet();
+
+        for (uint32_t i = first; i < last; i++) {
+            auto& obj = *visibleObjects[i];
+            const Material& material = obj.material ? *obj.material : materials.getDefaultMaterial();
+            PipelineVariant& variant = pipelines[static_cast<size_t>(material.getPipeline())];
+            Pipeline* pipeline = depthOnly ? variant.depthPipeline.get()
+                : depthPrepass ? variant.equalDepthPipeline.get()
+                : variant.pipeline.get();
+            if (pipeline != boundPipeline) {
+                pipeline->bind(commandBuffer);
+                boundPipeline = pipeline;
+                stats.pipelineBinds++;
+            }
+            // depth only draws have no fragment shader to read the material
+            if (!depthOnly && &material != boundMaterial) {
+                uint32_t materialOffset = materials.getDynamicOffset(material);
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, 1, &materialSet, 1, &materialOffset);
+                boundMaterial = &material;
+                stats.materialBinds++;
+            }
+            if (bindless) {
+                if (writeObjects) {
+                    objects[i].modelMatrix = obj.transform.mat4();
+                    objects[i].normalMatrix = obj.transform.normalMatrix();
+                }
+
+                BindlessPushConstantData push{objectBufferHandles[frameInfo.frameIndex].index, i};
+                commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(BindlessPushConstantData), &push);
+            } else {
+                PushConstantData push{};
+                push.modelMatrix = obj.transform.mat4();
+                push.normalMatrix = obj.transform.normalMatrix();
+                commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(PushConstantData), &push);
+            }
+            if (obj.model.get() == boundModel) {
+                stats.meshBindsSkipped++;
+            } else if (depthOnly) {
+                obj.model->bindPositions(commandBuffer);
+                stats.meshBinds++;
+            } else {
+                obj.model->bind(commandBuffer);
+                stats.meshBinds++;
+            }
+            boundModel = obj.model.get();
+            obj.model->draw(commandBuffer);
+            stats.draws++;
+        }
+    }
+
+    void RenderSystem::createThreadCommandPools(uint32_t threadCount) {
+        if (!threadCommandPools.empty() && threadCommandPools[0].size() >= threadCount) {
+            return;
+        }
+        destroyThreadCommandPools();
+
+        threadCommandPools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        threadCommandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        for (int frame = 0; frame < SwapChain::MAX_FRAMES_IN_FLIGHT; frame++) {
+            threadCommandPools[frame].resize(threadCount);
+            threadCommandBuffers[frame].resize(2 * threadCount);
+            for (uint32_t thread = 0; thread < threadCount; thread++) {
+                threadCommandPools[frame][thread] = device.createCommandPool();
+
+                // one for the depth prepass and one for the lit pass
+                std::array<vk::CommandBuffer, 2> commandBuffers;
+                vk::CommandBufferAllocateInfo allocInfo{threadCommandPools[frame][thread], vk::CommandBufferLevel::eSecondary, 2};
+                if (device.device().allocateCommandBuffers(&allocInfo, commandBuffers.data()) != vk::Result::eSuccess) {
+                    throw std::runtime_error("failed to allocate secondary command buffers!");
+                }
+                threadCommandBuffers[frame][thread] = commandBuffers[0];
+                threadCommandBuffers[frame][threadCount + thread] = commandBuffers[1];
+            }
+        }
+    }
+
+    void RenderSystem::destroyThreadCommandPools() {
+        // command buffers are freed together with their pool
+        for (auto& framePools : threadCommandPools) {
+            for (auto commandPool : framePools) {
+                device.device().destroyCommandPool(commandPool, nullptr);
+            }
+        }
+        threadCommandPools.clear();
+        threadCommandBuffers.clear();
+    }
+
+    void RenderSystem::reserveObjectBuffer(int frameIndex, uint32_t objectCount) {
+        auto &objectBuffer = objectBuffers[frameIndex];
+        if (objectBuffer && objectBuffer->getInstanceCount() >= objectCount) {
+            return;
+        }
+
+        // the previous buffer of this frame is no longer in use once the slot's last frame has completed
+        uint32_t capacity = std::max({objectCount, 1024u, objectBuffer ? objectBuffer->getInstanceCount() * 2 : 0u});
+        objectBuffer = std::make_unique<Buffer>(device, sizeof(ObjectData), capacity, vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        objectBuffer->map();
+
+        auto bufferInfo = objectBuffer->descriptorInfo();
+        if (objectBufferHandles[frameIndex].isValid()) {
+            bindless->updateStorageBuffer(objectBufferHandles[frameIndex], bufferInfo);
+        } else {
+            objectBufferHandles[frameIndex] = bindless->addStorageBuffer(bufferInfo);
         }
     }
 
@@ -1,33 +1,125 @@
 #pragma once
 
+#include "BindlessDescriptors.hpp"
+#include "Buffer.hpp"
 #include "Camera.hpp"
 #include "Device.hpp"
 #include "GameObject.hpp"
+#include "Material.hpp"
 #include "Pipeline.hpp"
 #include "FrameInfo.hpp"
+#include "RenderQueue.hpp"
+#include "ThreadPool.hpp"
 
 // std
 #include <memory>
 #include <vector>
 
 namespace Engine {
+    // Bind counters of the last render call
+    struct DrawStats {
+        uint32_t draws = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t descriptorBinds = 0;
+        // draws sorted by material bind each one once per pass and recording thread
+        uint32_t materialBinds = 0;
+        uint32_t meshBinds = 0;
+        // consecutive draws of the same mesh reuse the bound vertex and index buffers
+        uint32_t meshBindsSkipped = 0;
+
+        DrawStats &operator+=(const DrawStats &other);
+    };
+
     class RenderSystem {
         public:
-        RenderSystem(Device &device, vk::RenderPass renderPass, vk::DescriptorSetLayout globalSetLayout);
+        // Passing a bindless descriptor set switches to per-object data in a storage buffer indexed via push constants.
+        // Sets are global (0), material (1) and bindless (2).
+        RenderSystem(
+            Device &device,
+            vk::DescriptorSetLayout globalSetLayout,
+            MaterialSystem &materials,
+            BindlessDescriptors *bindless = nullptr);
         ~RenderSystem();
 
         RenderSystem(const RenderSystem &) = delete;
         RenderSystem &operator=(const RenderSystem &) = delete;
 
+        // Creates the lit pipelines against renderPass and the depth only ones against depthRenderPass, unless they
+        // exist already. Render passes of a recompiled graph stay compatible with them as long as the formats match.
+        void createPipelines(vk::RenderPass renderPass, vk::RenderPass depthRenderPass = nullptr);
+
+        // Sorts the draws and reserves the object data, once per frame before any pass is recorded
+        void prepareFrame(FrameInfo& frameInfo);
+        // Each into its own render pass, the depth prepass ahead of the lit pass
+        void renderDepthPrepass(FrameInfo& frameInfo);
         void renderGameObjects(FrameInfo& frameInfo);
 
+        // Lays down depth with a position-only pass first, the lit pass then tests with equal so every pixel is shaded
+        // once. Pays off when fragments are expensive and the scene overdraws, costs a second vertex pass otherwise.
+        void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+        bool isDepthPrepassEnabled() const { return depthPrepass; }
+
+        // Draw calls recorded by the last render call
+        uint32_t getDrawCount() const { return static_cast<uint32_t>(visibleObjects.size()); }
+        const DrawStats &getDrawStats() const { return drawStats; }
+
+        // Splits the draws across threadCount workers, each recording a secondary command buffer from its
+        // own per-frame pool. The render pass has to be begun with eSecondaryCommandBuffers contents.
+        void renderDepthPrepassParallel(
+            FrameInfo& frameInfo,
+            ThreadPool& threadPool,
+            uint32_t threadCount,
+            const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+            vk::Extent2D extent);
+        void renderGameObjectsParallel(
+            FrameInfo& frameInfo,
+            ThreadPool& threadPool,
+            uint32_t threadCount,
+            const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+            vk::Extent2D extent);
+
         private:
         void createPipelineLayout(vk::DescriptorSetLayout globalSetLayout);
-        void createPipeline(vk::RenderPass renderPass);
+        void recordParallel(
+            FrameInfo& frameInfo,
+            ThreadPool& threadPool,
+            uint32_t threadCount,
+            const vk::CommandBufferInheritanceInfo& inheritanceInfo,
+            vk::Extent2D extent,
+            bool depthOnly);
+        void bindFrameState(vk::CommandBuffer commandBuffer, FrameInfo& frameInfo, DrawStats& stats);
+        void recordDraws(vk::CommandBuffer commandBuffer, FrameInfo& frameInfo, uint32_t first, uint32_t last, bool depthOnly, DrawStats& stats);
+        void reserveObjectBuffer(int frameIndex, uint32_t objectCount);
+        void createThreadCommandPools(uint32_t threadCount);
+        void destroyThreadCommandPools();
+
+        struct PipelineVariant {
+            std::unique_ptr<Pipeline> pipeline;
+            // same shading as pipeline, but tests against the prepass depth with equal and doesn't write it
+            std::unique_ptr<Pipeline> equalDepthPipeline;
+            std::unique_ptr<Pipeline> depthPipeline;
+        };
 
         Device &device;
+        MaterialSystem &materials;
+        BindlessDescriptors *bindless;
+
+        // in render queue order
+        std::vector<GameObject*> visibleObjects;
+        std::vector<GameObject*> queuedObjects;
+        RenderQueue renderQueue;
+        DrawStats drawStats;
+        std::vector<DrawStats> threadDrawStats;
+        std::vector<std::vector<vk::CommandPool>> threadCommandPools;
+        // per frame, the depth prepass buffers of all threads followed by their lit pass buffers
+        std::vector<std::vector<vk::CommandBuffer>> threadCommandBuffers;
+
+        std::vector<std::unique_ptr<Buffer>> objectBuffers;
+        std::vector<BindlessHandle> objectBufferHandles;
 
-        std::unique_ptr<Pipeline> pipeline;
+        // indexed by MaterialPipeline
+        std::vector<PipelineVariant> pipelines;
         vk::PipelineLayout pipelineLayout;
+        bool depthPrepass = false;
     };
 }  // namespace lve
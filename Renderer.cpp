@@ -1,59 +1,142 @@
 #include "Renderer.hpp"
 
+#include "CpuProfiler.hpp"
+#include "UploadQueue.hpp"
+
 // std
-#include <array>
 #include <cassert>
 #include <stdexcept>
 
 namespace Engine {
 
     Renderer::Renderer(Window& window, Device& device)
-        : window{window}, device{device} {
+        : window{&window}, device{device}, framePacer{device.frameScheduler()} {
+        recreateSwapChain();
+        createCommandBuffers();
+        createFrameDescriptorAllocators();
+    }
+
+    Renderer::Renderer(Device& device, vk::Extent2D extent)
+        : window{nullptr}, device{device}, offscreenExtent{extent}, framePacer{device.frameScheduler()} {
+        assert(device.isHeadless() && "Offscreen renderer requires a headless device");
         recreateSwapChain();
         createCommandBuffers();
+        createFrameDescriptorAllocators();
     }
 
     Renderer::~Renderer() { freeCommandBuffers(); }
 
     void Renderer::recreateSwapChain() {
-        auto extent = window.getExtent();
+        auto extent = window ? window->getExtent() : offscreenExtent;
         SDL_Event event;
         while (extent.width == 0 || extent.height == 0) {
-            extent = window.getExtent();
+            extent = window->getExtent();
             SDL_WaitEvent(&event);
         }
-        device.device().waitIdle();
 
+        vk::PresentModeKHR presentMode = framePacer.getSettings().presentMode;
         if (swapChain == nullptr) {
-            swapChain = std::make_unique<SwapChain>(device, extent);
+            swapChain = std::make_unique<SwapChain>(device, extent, presentMode);
         } else {
+            // frames still in flight keep rendering into the retired swapchain, its resources are released
+            // through the deletion queue once those frames complete
             std::shared_ptr<SwapChain> oldSwapChain = std::move(swapChain);
-            swapChain = std::make_unique<SwapChain>(device, extent, oldSwapChain);
+            swapChain = std::make_unique<SwapChain>(device, extent, oldSwapChain, presentMode);
+        }
+        // everything sized or formatted after the swapchain is rebuilt when this changes
+        swapChainGeneration++;
+    }
 
-            if (!oldSwapChain->compareSwapFormats(*swapChain.get())) {
-                throw std::runtime_error("Swap chain image(or depth) format has changed!");
-            }
+    void Renderer::setFramePacingSettings(const FramePacingSettings &settings) {
+        assert(!isFrameStarted && "Can't change frame pacing while frame is in progress");
+        bool presentModeChanged = settings.presentMode != framePacer.getSettings().presentMode;
+        framePacer.setSettings(settings);
+        if (presentModeChanged) {
+            recreateSwapChain();
         }
     }
 
     void Renderer::createCommandBuffers() {
+        commandPools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
         commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
 
-        vk::CommandBufferAllocateInfo allocInfo{device.getCommandPool(), vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(commandBuffers.size())};
+        // one pool per frame in flight, reset as a whole instead of resetting individual buffers
+        for (size_t i = 0; i < commandPools.size(); i++) {
+            commandPools[i] = device.createCommandPool(vk::CommandPoolCreateFlagBits::eTransient);
 
-        if(device.device().allocateCommandBuffers(&allocInfo, commandBuffers.data()) != vk::Result::eSuccess) {
-            throw std::runtime_error("failed to allocate command buffers!");
+            vk::CommandBufferAllocateInfo allocInfo{commandPools[i], vk::CommandBufferLevel::ePrimary, 1};
+
+            if(device.device().allocateCommandBuffers(&allocInfo, &commandBuffers[i]) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to allocate command buffers!");
+            }
+        }
+
+        if (!device.hasAsyncCompute()) {
+            return;
+        }
+
+        computeCommandPools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        computeCommandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < computeCommandPools.size(); i++) {
+            computeCommandPools[i] = device.createComputeCommandPool(vk::CommandPoolCreateFlagBits::eTransient);
+
+            vk::CommandBufferAllocateInfo allocInfo{computeCommandPools[i], vk::CommandBufferLevel::ePrimary, 1};
+
+            if(device.device().allocateCommandBuffers(&allocInfo, &computeCommandBuffers[i]) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to allocate compute command buffers!");
+            }
+        }
+
+        vk::SemaphoreTypeCreateInfo typeInfo{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.setPNext(&typeInfo);
+        if (device.device().createSemaphore(&semaphoreInfo, nullptr, &computeTimeline) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create compute timeline semaphore!");
         }
     }
 
     void Renderer::freeCommandBuffers() {
-        device.device().freeCommandBuffers(device.getCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+        for (auto commandPool : commandPools) {
+            device.device().destroyCommandPool(commandPool, nullptr);
+        }
+        commandPools.clear();
         commandBuffers.clear();
+
+        for (auto commandPool : computeCommandPools) {
+            device.device().destroyCommandPool(commandPool, nullptr);
+        }
+        computeCommandPools.clear();
+        computeCommandBuffers.clear();
+
+        if (computeTimeline) {
+            // in-flight frames may still wait on it
+            device.deletionQueue().push([device = device.device(), semaphore = computeTimeline]() { device.destroySemaphore(semaphore, nullptr); });
+            computeTimeline = nullptr;
+        }
+    }
+
+    void Renderer::createFrameDescriptorAllocators() {
+        frameDescriptorAllocators.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        for (auto &allocator : frameDescriptorAllocators) {
+            allocator = DescriptorAllocator::Builder(device)
+                .setSetsPerPool(1000)
+                .addPoolRatio(vk::DescriptorType::eUniformBuffer, 2.f)
+                .addPoolRatio(vk::DescriptorType::eUniformBufferDynamic, 1.f)
+                .addPoolRatio(vk::DescriptorType::eStorageBuffer, 2.f)
+                .addPoolRatio(vk::DescriptorType::eCombinedImageSampler, 4.f)
+                .build();
+        }
     }
 
     vk::CommandBuffer Renderer::beginFrame() {
         assert(!isFrameStarted && "Can't call beginFrame while already in progress");
 
+        CpuProfiler::Zone zone{"Begin frame"};
+        FrameScheduler &scheduler = device.frameScheduler();
+        scheduler.beginFrame();
+        currentFrameIndex = scheduler.currentFrameIndex();
+        device.deletionQueue().collect();
+
         auto result = swapChain->acquireNextImage(&currentImageIndex);
         if (result == vk::Result::eErrorOutOfDateKHR) {
             recreateSwapChain();
@@ -66,60 +149,116 @@ namespace Engine {
 
         isFrameStarted = true;
 
+        // the scheduler has waited for the last frame that used this slot, so its commands and transient sets are no longer in use
+        frameDescriptorAllocators[currentFrameIndex]->resetPools();
+        device.device().resetCommandPool(commandPools[currentFrameIndex], {});
+
         auto commandBuffer = getCurrentCommandBuffer();
-        vk::CommandBufferBeginInfo beginInfo{};
+        vk::CommandBufferBeginInfo beginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
 
         if (commandBuffer.begin(&beginInfo) != vk::Result::eSuccess) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
+        device.gpuProfiler().beginFrame(commandBuffer);
+        // outside of any render pass, before the first draw that may use the uploads
+        device.uploadQueue().recordPendingUploads(commandBuffer);
         return commandBuffer;
     }
 
     void Renderer::endFrame() {
         assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
+        CpuProfiler::Zone zone{"End frame"};
+        assert(!isComputeStarted && "Can't call endFrame while compute recording is in progress");
         auto commandBuffer = getCurrentCommandBuffer();
+        device.gpuProfiler().endFrame(commandBuffer);
         commandBuffer.end();
 
-        auto result = swapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
-        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || window.wasWindowResized()) {
-            window.resetWindowResizedFlag();
+        std::vector<SemaphoreWait> timelineWaits;
+        // uploads acquired by this frame have to finish on the transfer queue first
+        vk::PipelineStageFlags uploadStages;
+        uint64_t uploadValue = device.uploadQueue().takeFrameWaitValue(uploadStages);
+        if (uploadValue > 0) {
+            timelineWaits.push_back({device.uploadQueue().timeline(), uploadValue, uploadStages});
+        }
+        if (computeConsumerStages) {
+            timelineWaits.push_back({computeTimeline, getFrameNumber(), computeConsumerStages});
+            computeConsumerStages = {};
+        }
+
+        auto result = swapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex, timelineWaits);
+        framePacer.frameSubmitted();
+        lastSubmittedImageIndex = currentImageIndex;
+        bool windowResized = window && window->wasWindowResized();
+        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || windowResized) {
+            if (window) {
+                window->resetWindowResizedFlag();
+            }
             recreateSwapChain();
         } else if (result != vk::Result::eSuccess) {
             throw std::runtime_error("failed to present swap chain image!");
         }
 
         isFrameStarted = false;
-        currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void Renderer::beginSwapChainRenderPass(vk::CommandBuffer commandBuffer) {
-        assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
-        assert(
-            commandBuffer == getCurrentCommandBuffer() &&
-            "Can't begin render pass on command buffer from a different frame");
+    vk::CommandBuffer Renderer::beginCompute() {
+        assert(isFrameStarted && "Can't call beginCompute if frame is not in progress");
+        assert(!isComputeStarted && "Can't call beginCompute while already in progress");
+        assert(!computeConsumerStages && "Only one compute batch can be submitted per frame");
+        isComputeStarted = true;
 
-        vk::RenderPassBeginInfo renderPassInfo{swapChain->getRenderPass(), swapChain->getFrameBuffer(currentImageIndex), {{0, 0}, swapChain->getSwapChainExtent()}};
+        if (!device.hasAsyncCompute()) {
+            return getCurrentCommandBuffer();
+        }
 
-        std::array<vk::ClearValue, 2> clearValues{};
-        clearValues[0].setColor(std::array<float, 4>{0.01f, 0.01f, 0.01f, 1.f});
-        clearValues[1].setDepthStencil({1.0f, 0});
-        renderPassInfo.setClearValueCount(static_cast<uint32_t>(clearValues.size()));
-        renderPassInfo.setPClearValues(clearValues.data());
+        // the last frame in this slot has completed, and with it the compute work it waited for
+        device.device().resetCommandPool(computeCommandPools[currentFrameIndex], {});
+        vk::CommandBuffer commandBuffer = computeCommandBuffers[currentFrameIndex];
+        vk::CommandBufferBeginInfo beginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+        if (commandBuffer.begin(&beginInfo) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to begin recording compute command buffer!");
+        }
+        device.gpuProfiler().beginComputeFrame(commandBuffer);
+        return commandBuffer;
+    }
 
-        commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+    void Renderer::endCompute(vk::PipelineStageFlags consumerStages) {
+        assert(isComputeStarted && "Can't call endCompute if compute is not in progress");
+        isComputeStarted = false;
 
-        vk::Viewport viewport{0.f, 0.f, static_cast<float>(swapChain->getSwapChainExtent().width), static_cast<float>(swapChain->getSwapChainExtent().height), 0.f, 1.f};
-        vk::Rect2D scissor{{0, 0}, swapChain->getSwapChainExtent()};
-        commandBuffer.setViewport(0, 1, &viewport);
-        commandBuffer.setScissor(0, 1, &scissor);
+        if (!device.hasAsyncCompute()) {
+            vk::MemoryBarrier barrier{
+                vk::AccessFlagBits::eShaderWrite,
+                vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eIndirectCommandRead |
+                    vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead};
+            getCurrentCommandBuffer().pipelineBarrier(
+                vk::PipelineStageFlagBits::eComputeShader, consumerStages, {}, 1, &barrier, 0, nullptr, 0, nullptr);
+            return;
+        }
+
+        vk::CommandBuffer commandBuffer = computeCommandBuffers[currentFrameIndex];
+        device.gpuProfiler().endComputeFrame();
+        commandBuffer.end();
+
+        uint64_t frame = getFrameNumber();
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{0, nullptr, 1, &frame};
+        vk::SubmitInfo submitInfo{0, nullptr, nullptr, 1, &commandBuffer, 1, &computeTimeline};
+        submitInfo.setPNext(&timelineInfo);
+        if (device.computeQueue().submit(1, &submitInfo, nullptr) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to submit compute command buffer!");
+        }
+        computeConsumerStages |= consumerStages;
     }
 
-    void Renderer::endSwapChainRenderPass(vk::CommandBuffer commandBuffer) {
-        assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-        assert(
-            commandBuffer == getCurrentCommandBuffer() &&
-            "Can't end render pass on command buffer from a different frame");
-        commandBuffer.endRenderPass();
+    CapturedImage Renderer::captureLastFrame() {
+        assert(!isFrameStarted && "Can't capture while frame is in progress");
+        assert(device.frameScheduler().lastSubmittedFrame() > 0 && "No frame has been submitted yet");
+
+        CapturedImage image{};
+        image.width = swapChain->width();
+        image.height = swapChain->height();
+        image.pixels = swapChain->readImage(lastSubmittedImageIndex);
+        return image;
     }
 
 }
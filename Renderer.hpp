@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Descriptors.hpp"
 #include "Device.hpp"
+#include "FramePacer.hpp"
+#include "ImageWriter.hpp"
 #include "SwapChain.hpp"
 #include "Window.hpp"
 
@@ -13,12 +16,17 @@ namespace Engine {
     class Renderer {
         public:
         Renderer(Window &window, Device &device);
+        // Headless renderer drawing into offscreen images of a fixed size
+        Renderer(Device &device, vk::Extent2D extent);
         ~Renderer();
 
         Renderer(const Renderer &) = delete;
         Renderer &operator=(const Renderer &) = delete;
 
-        vk::RenderPass getSwapChainRenderPass() const { return swapChain->getRenderPass(); }
+        SwapChain &getSwapChain() const { return *swapChain; }
+        // incremented whenever the swap chain is recreated
+        uint64_t getSwapChainGeneration() const { return swapChainGeneration; }
+        vk::Extent2D getSwapChainExtent() const { return swapChain->getSwapChainExtent(); }
         float getAspectRatio() const { return swapChain->extentAspectRatio(); }
         bool isFrameInProgress() const { return isFrameStarted; }
 
@@ -32,23 +40,64 @@ namespace Engine {
             return currentFrameIndex;
         }
 
+        // monotonically increasing number of the frame being recorded, signaled on the device frame timeline
+        uint64_t getFrameNumber() const {
+            assert(isFrameStarted && "Cannot get frame number when frame not in progress");
+            return device.frameScheduler().currentFrame();
+        }
+
+        void setFramesInFlight(uint32_t count) { device.frameScheduler().setFramesInFlight(count); }
+        void setFramePacingSettings(const FramePacingSettings &settings);
+        FramePacer &getFramePacer() { return framePacer; }
+        uint32_t getFramesInFlight() const { return device.frameScheduler().getFramesInFlight(); }
+
+        DescriptorAllocator &getFrameDescriptorAllocator() const {
+            assert(isFrameStarted && "Cannot get frame descriptor allocator when frame not in progress");
+            return *frameDescriptorAllocators[currentFrameIndex];
+        }
+
+        // Swap chain image the frame renders into
+        uint32_t getImageIndex() const {
+            assert(isFrameStarted && "Cannot get image index when frame not in progress");
+            return currentImageIndex;
+        }
+
         vk::CommandBuffer beginFrame();
         void endFrame();
-        void beginSwapChainRenderPass(vk::CommandBuffer commandBuffer);
-        void endSwapChainRenderPass(vk::CommandBuffer commandBuffer);
+        // Command buffer for the frame's async compute work, submitted ahead of the graphics work so it overlaps the
+        // previous frame's raster work. Without a compute queue this is the frame's command buffer, so call it
+        // outside of render passes. Resources it writes need storage usage to be shared with the compute family.
+        vk::CommandBuffer beginCompute();
+        // Submits the compute work, the frame's graphics submission waits for it before consumerStages
+        void endCompute(vk::PipelineStageFlags consumerStages);
+        // Reads back the image of the last submitted frame, only available on headless devices
+        CapturedImage captureLastFrame();
 
         private:
         void createCommandBuffers();
         void freeCommandBuffers();
+        void createFrameDescriptorAllocators();
         void recreateSwapChain();
 
-        Window &window;
+        Window *window;
         Device &device;
+        vk::Extent2D offscreenExtent{};
         std::unique_ptr<SwapChain> swapChain;
+        FramePacer framePacer;
+        std::vector<vk::CommandPool> commandPools;
         std::vector<vk::CommandBuffer> commandBuffers;
+        std::vector<vk::CommandPool> computeCommandPools;
+        std::vector<vk::CommandBuffer> computeCommandBuffers;
+        // signaled with the frame number by async compute submissions
+        vk::Semaphore computeTimeline;
+        vk::PipelineStageFlags computeConsumerStages{};
+        std::vector<std::unique_ptr<DescriptorAllocator>> frameDescriptorAllocators;
 
         uint32_t currentImageIndex;
+        uint64_t swapChainGeneration{0};
+        uint32_t lastSubmittedImageIndex{0};
         int currentFrameIndex{0};
         bool isFrameStarted{false};
+        bool isComputeStarted{false};
     };
 } 
@@ -0,0 +1,68 @@
+#include "SamplerCache.hpp"
+
+#include "Utils.hpp"
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace Engine {
+
+    static uint32_t floatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    SamplerCache::~SamplerCache() {
+        for (auto &kv : samplers) {
+            device.destroySampler(kv.second, nullptr);
+        }
+    }
+
+    size_t SamplerCache::CreateInfoHash::operator()(const vk::SamplerCreateInfo &createInfo) const {
+        size_t seed = 0;
+        hashCombine(seed,
+            static_cast<uint32_t>(createInfo.flags),
+            static_cast<uint32_t>(createInfo.magFilter),
+            static_cast<uint32_t>(createInfo.minFilter),
+            static_cast<uint32_t>(createInfo.mipmapMode),
+            static_cast<uint32_t>(createInfo.addressModeU),
+            static_cast<uint32_t>(createInfo.addressModeV),
+            static_cast<uint32_t>(createInfo.addressModeW),
+            floatBits(createInfo.mipLodBias),
+            createInfo.anisotropyEnable,
+            floatBits(createInfo.maxAnisotropy),
+            createInfo.compareEnable,
+            static_cast<uint32_t>(createInfo.compareOp),
+            floatBits(createInfo.minLod),
+            floatBits(createInfo.maxLod),
+            static_cast<uint32_t>(createInfo.borderColor),
+            createInfo.unnormalizedCoordinates);
+        return seed;
+    }
+
+    vk::Sampler SamplerCache::get(const vk::SamplerCreateInfo &createInfo) {
+        assert(createInfo.pNext == nullptr && "Sampler cache does not hash chained create infos");
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = samplers.find(createInfo);
+        if (it != samplers.end()) {
+            return it->second;
+        }
+
+        vk::Sampler sampler;
+        if (device.createSampler(&createInfo, nullptr, &sampler) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create sampler!");
+        }
+        samplers.emplace(createInfo, sampler);
+        return sampler;
+    }
+
+    size_t SamplerCache::size() {
+        std::lock_guard<std::mutex> lock{mutex};
+        return samplers.size();
+    }
+}
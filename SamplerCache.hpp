@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+namespace Engine {
+
+    // Samplers are few and immutable, every distinct create info gets one sampler that lives as long as the device.
+    // Lookups are thread safe so textures can be created from loader threads.
+    class SamplerCache {
+        public:
+        SamplerCache(vk::Device device) : device{device} {}
+        ~SamplerCache();
+
+        SamplerCache(const SamplerCache &) = delete;
+        SamplerCache &operator=(const SamplerCache &) = delete;
+
+        // Chained create infos are not supported, pNext has to be null
+        vk::Sampler get(const vk::SamplerCreateInfo &createInfo);
+
+        size_t size();
+
+        private:
+        struct CreateInfoHash {
+            size_t operator()(const vk::SamplerCreateInfo &createInfo) const;
+        };
+
+        vk::Device device;
+        std::mutex mutex;
+        std::unordered_map<vk::SamplerCreateInfo, vk::Sampler, CreateInfoHash> samplers;
+    };
+}
@@ -0,0 +1,203 @@
+#include "SceneRenderer.hpp"
+
+#include "CpuProfiler.hpp"
+
+// std
+#include <array>
+#include <stdexcept>
+
+namespace Engine {
+
+    SceneRenderer::SceneRenderer(Device &device, Renderer &renderer, uint32_t maxLights)
+        : device{device}, renderer{renderer} {
+        globalAllocator = DescriptorAllocator::Builder(device)
+            .setSetsPerPool(16)
+            .addPoolRatio(vk::DescriptorType::eUniformBuffer, 1.f)
+            .addPoolRatio(vk::DescriptorType::eUniformBufferDynamic, 2.f)
+            .addPoolRatio(vk::DescriptorType::eStorageBuffer, 1.f)
+            .addPoolRatio(vk::DescriptorType::eStorageBufferDynamic, 3.f)
+            .addPoolRatio(vk::DescriptorType::eCombinedImageSampler, 2.f)
+            .build();
+        if (device.supportsBindless()) {
+            bindless = std::make_unique<BindlessDescriptors>(device);
+        }
+        materials = std::make_unique<MaterialSystem>(device, *globalAllocator, bindless.get());
+
+        uniformRing = std::make_unique<UniformRingBuffer>(device, 64 * 1024, SwapChain::MAX_FRAMES_IN_FLIGHT);
+        lighting = std::make_unique<ClusteredLighting>(device, *globalAllocator, maxLights);
+        shadows = std::make_unique<ShadowSystem>(device);
+        virtualTextures = std::make_unique<VirtualTextureSystem>(device);
+        createGlobalDescriptorSet();
+
+        renderSystem = std::make_unique<RenderSystem>(
+            device,
+            globalSetLayout->getDescriptorSetLayout(),
+            *materials,
+            bindless.get());
+        postProcess = std::make_unique<PostProcess>(device);
+    }
+
+    SceneRenderer::~SceneRenderer() {}
+
+    void SceneRenderer::createGlobalDescriptorSet() {
+        globalSetLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eAllGraphics)
+            .addBinding(1, vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eFragment)
+            .addBinding(2, vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eFragment)
+            .addBinding(3, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
+            .addBinding(4, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
+            .addBinding(5, vk::DescriptorType::eStorageBuffer, vk::ShaderStageFlagBits::eFragment)
+            .addBinding(6, vk::DescriptorType::eStorageBufferDynamic, vk::ShaderStageFlagBits::eFragment)
+            .build();
+
+        auto bufferInfo = uniformRing->descriptorInfo(sizeof(GlobalUbo));
+        auto lightInfo = lighting->lightBufferInfo();
+        auto clusterInfo = lighting->clusterBufferInfo();
+        auto shadowInfo = shadows->descriptorInfo();
+        auto virtualCacheInfo = virtualTextures->cacheDescriptorInfo();
+        auto pageTableInfo = virtualTextures->pageTableInfo();
+        auto feedbackInfo = virtualTextures->feedbackInfo();
+        if (!DescriptorWriter(*globalSetLayout, *globalAllocator)
+            .writeBuffer(0, &bufferInfo)
+            .writeBuffer(1, &lightInfo)
+            .writeBuffer(2, &clusterInfo)
+            .writeImage(3, &shadowInfo)
+            .writeImage(4, &virtualCacheInfo)
+            .writeBuffer(5, &pageTableInfo)
+            .writeBuffer(6, &feedbackInfo)
+            .build(globalDescriptorSet)) {
+            throw std::runtime_error("failed to allocate global descriptor set!");
+        }
+    }
+
+    void SceneRenderer::createGraph(bool secondary) {
+        SwapChain &swapChain = renderer.getSwapChain();
+        vk::Extent2D extent = swapChain.getSwapChainExtent();
+        bool depthPrepass = renderSystem->isDepthPrepassEnabled();
+
+        // the previous graph's images and render passes are released once the frames using them complete
+        graph = std::make_unique<RenderGraph>(device);
+        RenderGraphResource sceneColor = graph->createImage("Scene color", {SCENE_COLOR_FORMAT, extent});
+        RenderGraphResource depth = graph->createImage("Depth", {swapChain.findDepthFormat(), extent});
+        // offscreen images are read back with a copy once the frame completes
+        swapChainImage = graph->importImage("Swap chain image", swapChain.getSwapChainImageFormat(), extent, vk::ImageLayout::eUndefined,
+            swapChain.isOffscreen() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR);
+
+        if (depthPrepass) {
+            graph->addPass("Depth prepass", [&](RenderGraph::PassBuilder &pass) {
+                pass.writeDepth(depth, 1.f);
+                if (secondary) {
+                    pass.useSecondaryCommandBuffers();
+                }
+            }, [this](vk::CommandBuffer, const RenderGraph::PassContext &context) {
+                if (graphSecondary) {
+                    renderSystem->renderDepthPrepassParallel(*currentFrame, *recordingPool, recordingThreads, context.getInheritanceInfo(), context.extent);
+                } else {
+                    renderSystem->renderDepthPrepass(*currentFrame);
+                }
+            });
+        }
+
+        graph->addPass("Scene", [&](RenderGraph::PassBuilder &pass) {
+            pass.writeColor(sceneColor, vk::ClearColorValue{std::array<float, 4>{0.01f, 0.01f, 0.01f, 1.f}});
+            if (depthPrepass) {
+                pass.readDepth(depth);
+            } else {
+                pass.writeDepth(depth, 1.f);
+            }
+            if (secondary) {
+                pass.useSecondaryCommandBuffers();
+            }
+        }, [this](vk::CommandBuffer, const RenderGraph::PassContext &context) {
+            if (graphSecondary) {
+                renderSystem->renderGameObjectsParallel(*currentFrame, *recordingPool, recordingThreads, context.getInheritanceInfo(), context.extent);
+            } else {
+                renderSystem->renderGameObjects(*currentFrame);
+            }
+        });
+
+        postProcess->addPasses(*graph, sceneColor, swapChainImage, swapChain);
+        graph->compile();
+        postProcess->createDescriptorSets(*graph, swapChain);
+        // later graphs only create the depth pipelines if they are missing, the formats never change
+        renderSystem->createPipelines(graph->getRenderPass("Scene"), depthPrepass ? graph->getRenderPass("Depth prepass") : nullptr);
+
+        graphSwapChainGeneration = renderer.getSwapChainGeneration();
+        graphDepthPrepass = depthPrepass;
+        graphSecondary = secondary;
+    }
+
+    FrameInfo SceneRenderer::beginFrame(vk::CommandBuffer commandBuffer, Camera &camera, float frameTime, GameObject::Map &gameObjects, const std::vector<PointLight> &lights) {
+        int frameIndex = renderer.getFrameIndex();
+        if (bindless) {
+            bindless->beginFrame();
+        }
+
+        {
+            // the feedback read here was written MAX_FRAMES_IN_FLIGHT frames ago
+            CpuProfiler::Zone zone{"Virtual texture feedback"};
+            virtualTextures->beginFrame(frameIndex, renderer.getFrameNumber(), renderer.getSwapChainExtent());
+        }
+
+        {
+            CpuProfiler::Zone zone{"Fit shadow cascades"};
+            shadows->update(camera, sunDirection, gameObjects);
+        }
+
+        uint32_t globalUboOffset;
+        {
+            // the ring is host coherent, writing it is all the flushing there is
+            CpuProfiler::Zone zone{"Update uniforms"};
+            uniformRing->beginFrame(frameIndex);
+
+            GlobalUbo ubo{};
+            ubo.projectionView = camera.getProjection() * camera.getView();
+            shadows->writeUniforms(ubo);
+            globalUboOffset = uniformRing->push(ubo);
+        }
+
+        {
+            // binning overlaps the previous frame on an async compute queue, shading waits for it
+            CpuProfiler::Zone zone{"Cluster lights"};
+            lighting->update(frameIndex, camera, renderer.getSwapChainExtent(), lights);
+            lighting->bin(renderer.beginCompute(), frameIndex);
+            renderer.endCompute(vk::PipelineStageFlagBits::eFragmentShader);
+        }
+
+        FrameInfo frameInfo{frameIndex, frameTime, commandBuffer, camera, globalDescriptorSet, globalUboOffset, gameObjects, renderer.getFrameDescriptorAllocator(), *uniformRing};
+        frameInfo.lightingOffsets = lighting->getDynamicOffsets(frameIndex);
+        frameInfo.virtualTextureFeedbackOffset = virtualTextures->getFeedbackOffset(frameIndex);
+        return frameInfo;
+    }
+
+    void SceneRenderer::render(FrameInfo &frameInfo, ThreadPool &threadPool, uint32_t threadCount) {
+        CpuProfiler::Zone zone{"Record commands"};
+        vk::CommandBuffer commandBuffer = frameInfo.commandBuffer;
+        virtualTextures->recordUpdates(commandBuffer, frameInfo.frameIndex);
+        materials->recordUploads(commandBuffer, frameInfo.frameIndex);
+        shadows->render(commandBuffer, frameInfo.gameObjects);
+
+        bool secondary = threadCount > 1;
+        if (!graph || graphSwapChainGeneration != renderer.getSwapChainGeneration() ||
+            graphDepthPrepass != renderSystem->isDepthPrepassEnabled() || graphSecondary != secondary) {
+            CpuProfiler::Zone graphZone{"Build render graph"};
+            createGraph(secondary);
+        }
+
+        renderSystem->prepareFrame(frameInfo);
+        currentFrame = &frameInfo;
+        recordingPool = &threadPool;
+        recordingThreads = threadCount;
+
+        SwapChain &swapChain = renderer.getSwapChain();
+        int imageIndex = static_cast<int>(renderer.getImageIndex());
+        graph->setImportedImage(swapChainImage, swapChain.getImage(imageIndex), swapChain.getImageView(imageIndex));
+        postProcess->beginFrame(renderer.getImageIndex());
+        graph->execute(commandBuffer);
+        virtualTextures->recordFeedbackBarrier(commandBuffer, frameInfo.frameIndex);
+
+        currentFrame = nullptr;
+        recordingPool = nullptr;
+    }
+
+}
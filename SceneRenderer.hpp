@@ -0,0 +1,100 @@
+#pragma once
+
+#include "BindlessDescriptors.hpp"
+#include "Camera.hpp"
+#include "ClusteredLighting.hpp"
+#include "Descriptors.hpp"
+#include "Device.hpp"
+#include "FrameInfo.hpp"
+#include "GameObject.hpp"
+#include "Material.hpp"
+#include "PostProcess.hpp"
+#include "Renderer.hpp"
+#include "RenderGraph.hpp"
+#include "RenderSystem.hpp"
+#include "ShadowSystem.hpp"
+#include "ThreadPool.hpp"
+#include "UniformRingBuffer.hpp"
+#include "VirtualTextureSystem.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Engine {
+    // The systems a scene is drawn with and the per-frame work tying them together, driven by both the viewer and
+    // the benchmark so they render the same frame. Owns the global descriptor set, the materials, lighting, shadows,
+    // virtual textures and the render system.
+    //
+    // The depth prepass, the scene and the post processing are passes of a render graph that produces their barriers
+    // and transient images. It is rebuilt when the swap chain is recreated, the prepass is toggled or recording
+    // switches between one thread and several.
+    class SceneRenderer {
+        public:
+        // HDR, PostProcess resolves it into the swapchain image
+        static constexpr vk::Format SCENE_COLOR_FORMAT = vk::Format::eR16G16B16A16Sfloat;
+
+        SceneRenderer(Device &device, Renderer &renderer, uint32_t maxLights = 4096);
+        ~SceneRenderer();
+
+        SceneRenderer(const SceneRenderer &) = delete;
+        SceneRenderer &operator=(const SceneRenderer &) = delete;
+
+        // Updates the per-frame state right after Renderer::beginFrame: virtual texture feedback, shadow cascades,
+        // the global uniforms and the light binning on the compute queue.
+        FrameInfo beginFrame(vk::CommandBuffer commandBuffer, Camera &camera, float frameTime, GameObject::Map &gameObjects, const std::vector<PointLight> &lights);
+        // Records the uploads, shadow maps, scene and post processing. Above one thread the draws are recorded in
+        // secondary command buffers on threadPool.
+        void render(FrameInfo &frameInfo, ThreadPool &threadPool, uint32_t threadCount);
+
+        void setDepthPrepass(bool enabled) { renderSystem->setDepthPrepass(enabled); }
+        bool isDepthPrepassEnabled() const { return renderSystem->isDepthPrepassEnabled(); }
+        void setPostProcessSettings(const PostProcessSettings &settings) { postProcess->setSettings(settings); }
+        const PostProcessSettings &getPostProcessSettings() const { return postProcess->getSettings(); }
+
+        MaterialSystem &getMaterials() { return *materials; }
+        VirtualTextureSystem &getVirtualTextures() { return *virtualTextures; }
+        const RenderSystem &getRenderSystem() const { return *renderSystem; }
+        const ShadowSystem &getShadows() const { return *shadows; }
+
+        private:
+        void createGlobalDescriptorSet();
+        void createGraph(bool secondary);
+
+        Device &device;
+        Renderer &renderer;
+        glm::vec3 sunDirection = glm::normalize(glm::vec3{1.f, 3.f, 1.f});
+
+        std::unique_ptr<DescriptorAllocator> globalAllocator;
+        std::unique_ptr<BindlessDescriptors> bindless;
+        std::unique_ptr<MaterialSystem> materials;
+        std::unique_ptr<UniformRingBuffer> uniformRing;
+        std::unique_ptr<ClusteredLighting> lighting;
+        std::unique_ptr<ShadowSystem> shadows;
+        std::unique_ptr<VirtualTextureSystem> virtualTextures;
+
+        std::unique_ptr<DescriptorSetLayout> globalSetLayout;
+        // a single set covers every frame, the per-frame ubo and light data are selected with dynamic offsets
+        vk::DescriptorSet globalDescriptorSet;
+        std::unique_ptr<RenderSystem> renderSystem;
+        std::unique_ptr<PostProcess> postProcess;
+
+        std::unique_ptr<RenderGraph> graph;
+        RenderGraphResource swapChainImage = 0;
+        // what the graph was built for
+        uint64_t graphSwapChainGeneration = 0;
+        bool graphDepthPrepass = false;
+        bool graphSecondary = false;
+
+        // set while the graph executes, its passes record from them
+        FrameInfo *currentFrame = nullptr;
+        ThreadPool *recordingPool = nullptr;
+        uint32_t recordingThreads = 1;
+    };
+}
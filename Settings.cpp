@@ -0,0 +1,88 @@
+#include "Settings.hpp"
+
+// std
+#include <stdexcept>
+#include <string>
+
+namespace Engine {
+
+    static vk::PresentModeKHR parsePresentMode(const std::string &name) {
+        if (name == "immediate") return vk::PresentModeKHR::eImmediate;
+        if (name == "mailbox") return vk::PresentModeKHR::eMailbox;
+        if (name == "fifo") return vk::PresentModeKHR::eFifo;
+        if (name == "fifo-relaxed") return vk::PresentModeKHR::eFifoRelaxed;
+        throw std::runtime_error("unknown present mode: " + name);
+    }
+
+    EngineSettings EngineSettings::fromCommandLine(int argc, char **argv) {
+        EngineSettings settings{};
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto nextValue = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error("missing value for " + arg);
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--low-latency") {
+                settings.framePacing.lowLatency = true;
+            } else if (arg == "--queue-ahead") {
+                settings.framePacing.queueAhead = true;
+            } else if (arg == "--present-mode") {
+                settings.framePacing.presentMode = parsePresentMode(nextValue());
+            } else if (arg == "--fps-cap") {
+                settings.framePacing.maxFrameRate = std::stof(nextValue());
+            } else if (arg == "--report-latency") {
+                settings.framePacing.reportLatency = true;
+            } else if (arg == "--headless") {
+                settings.headless = true;
+            } else if (arg == "--size") {
+                std::string size = nextValue();
+                size_t separator = size.find('x');
+                if (separator == std::string::npos) {
+                    throw std::runtime_error("expected WIDTHxHEIGHT for --size");
+                }
+                settings.width = static_cast<uint32_t>(std::stoul(size.substr(0, separator)));
+                settings.height = static_cast<uint32_t>(std::stoul(size.substr(separator + 1)));
+            } else if (arg == "--frames") {
+                settings.frameCount = static_cast<uint32_t>(std::stoul(nextValue()));
+            } else if (arg == "--capture") {
+                settings.capturePath = nextValue();
+            } else if (arg == "--cpu-trace") {
+                settings.cpuTracePath = nextValue();
+            } else if (arg == "--gpu-timings") {
+                settings.gpuTimingInterval = static_cast<uint32_t>(std::stoul(nextValue()));
+            } else if (arg == "--memory-report") {
+                settings.memoryReport = true;
+            } else if (arg == "--depth-prepass") {
+                settings.depthPrepass = true;
+            } else if (arg == "--exposure") {
+                settings.postProcess.exposureCompensation = std::stof(nextValue());
+            } else if (arg == "--no-auto-exposure") {
+                settings.postProcess.autoExposure = false;
+            } else if (arg == "--no-bloom") {
+                settings.postProcess.bloom = false;
+            } else if (arg == "--bloom-intensity") {
+                settings.postProcess.bloomIntensity = std::stof(nextValue());
+            } else {
+                throw std::runtime_error("unknown option: " + arg);
+            }
+        }
+
+        if (settings.headless) {
+            if (settings.width == 0 || settings.height == 0) {
+                settings.width = 1280;
+                settings.height = 720;
+            }
+            if (settings.frameCount == 0) {
+                settings.frameCount = 1;
+            }
+        } else if (!settings.capturePath.empty()) {
+            throw std::runtime_error("--capture requires --headless");
+        }
+
+        return settings;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FramePacer.hpp"
+#include "PostProcess.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace Engine {
+
+    struct EngineSettings {
+        FramePacingSettings framePacing{};
+        // F9 toggles bloom at runtime
+        PostProcessSettings postProcess{};
+
+        // render offscreen without a window or surface, e.g. on CI machines with a software ICD
+        bool headless = false;
+        // zero opens a fullscreen window, headless rendering falls back to 1280x720
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // number of frames to render before exiting, zero runs until the window is closed (one frame when headless)
+        uint32_t frameCount = 0;
+        // headless only, the last frame is written here as .png or .ppm
+        std::string capturePath{};
+        // print the resolved gpu scope timings every this many frames, zero disables
+        uint32_t gpuTimingInterval = 0;
+        // enables cpu zone recording, the trace is written here on exit and whenever F12 is pressed
+        std::string cpuTracePath{};
+        // print the gpu memory report on exit, F11 prints it at any time
+        bool memoryReport = false;
+        // start with the depth prepass enabled, F10 toggles it at runtime
+        bool depthPrepass = false;
+
+        // Parses the command line, throws on unknown or malformed options
+        static EngineSettings fromCommandLine(int argc, char **argv);
+    };
+}
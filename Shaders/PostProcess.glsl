@@ -0,0 +1,53 @@
+// Shared by the post processing passes, every pass uses the same set layout and push constants
+
+// keep in sync with PostProcess.hpp
+const uint HISTOGRAM_BINS = 256;
+const uint POST_AUTO_EXPOSURE = 1;
+const uint POST_BLOOM = 2;
+const uint POST_ENCODE_SRGB = 4;
+
+// the histogram spans 2^-10 to 2^6 cd/m2, bin 0 collects everything darker
+const float MIN_LOG_LUMINANCE = -10.0;
+const float LOG_LUMINANCE_RANGE = 16.0;
+// auto exposure maps the average luminance to this
+const float MIDDLE_GREY = 0.18;
+
+// the scene color for the prefilter and resolve, the neighbouring bloom level for the bloom passes
+layout(set = 0, binding = 0) uniform sampler2D sourceImage;
+layout(set = 0, binding = 1) uniform writeonly image2D targetImage;
+
+layout(set = 0, binding = 2) buffer ExposureData {
+    uint histogram[HISTOGRAM_BINS];
+    // adapted log2 exposure, read from exposureIndex and written to the other one
+    float logExposure[2];
+} exposureData;
+
+// the finished bloom for the resolve, the downsampled level of the same size for the upsample
+layout(set = 0, binding = 3) uniform sampler2D bloomImage;
+
+layout(push_constant) uniform Push {
+    uint flags;
+    uint exposureIndex;
+    float exposureCompensation;
+    float adaptation;
+    float bloomThreshold;
+    float bloomIntensity;
+} push;
+
+float luminance(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+uint luminanceBin(float value) {
+    if (value < exp2(MIN_LOG_LUMINANCE)) {
+        return 0;
+    }
+    float scaled = clamp((log2(value) - MIN_LOG_LUMINANCE) / LOG_LUMINANCE_RANGE, 0.0, 1.0);
+    return uint(scaled * float(HISTOGRAM_BINS - 2) + 1.0);
+}
+
+// exposure of the previous frame, used before this frame's histogram is complete
+float previousLogExposure() {
+    float metered = (push.flags & POST_AUTO_EXPOSURE) != 0 ? exposureData.logExposure[push.exposureIndex] : 0.0;
+    return metered + push.exposureCompensation;
+}
@@ -0,0 +1,144 @@
+// Lit forward shading shared by Shader.frag and BindlessShader.frag, the latter defines BINDLESS and can sample
+// material textures from the bindless set
+
+// keep in sync with ClusteredLighting.hpp
+const uint CLUSTERS_X = 16;
+const uint CLUSTERS_Y = 9;
+const uint CLUSTERS_Z = 24;
+const uint MAX_LIGHTS_PER_CLUSTER = 127;
+// keep in sync with FrameInfo.hpp
+const uint SHADOW_CASCADE_COUNT = 4;
+// keep in sync with Material.hpp
+const uint MATERIAL_VERTEX_COLOR = 1;
+// keep in sync with BindlessDescriptors.hpp
+const uint BINDLESS_INVALID_INDEX = 0xffffffff;
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragPosWorld;
+layout (location = 2) in vec3 fragNormalWorld;
+layout (location = 3) in vec2 fragUv;
+
+layout (location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionViewMatrix;
+    vec4 ambientLightColor;
+    vec4 directionalLightDirection;
+    vec4 directionalLightColor;
+    vec4 cascadeSplits;
+    mat4 cascadeViewProjections[SHADOW_CASCADE_COUNT];
+} ubo;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout(set = 0, binding = 1) readonly buffer LightBuffer {
+    mat4 view;
+    vec4 projection;
+    vec4 viewport;
+    uint lightCount;
+    PointLight lights[];
+} lightBuffer;
+
+struct Cluster {
+    uint lightCount;
+    uint lightIndices[MAX_LIGHTS_PER_CLUSTER];
+};
+
+layout(set = 0, binding = 2) readonly buffer ClusterBuffer {
+    Cluster clusters[];
+} clusterBuffer;
+
+layout(set = 0, binding = 3) uniform sampler2DArrayShadow shadowMap;
+
+#include "VirtualTexture.glsl"
+
+layout(set = 1, binding = 0) readonly buffer MaterialBuffer {
+    vec4 baseColor;
+    vec4 emissive;
+    uint baseColorTexture;
+    uint emissiveTexture;
+    uint flags;
+    uint baseColorImage;
+} material;
+
+#ifdef BINDLESS
+layout(set = 2, binding = 1) uniform sampler2D bindlessTextures[];
+#endif
+
+float directionalShadow(float viewDepth) {
+    if (viewDepth > ubo.cascadeSplits[SHADOW_CASCADE_COUNT - 1]) {
+        return 1.0;
+    }
+    uint cascade = 0;
+    for (uint i = 0; i < SHADOW_CASCADE_COUNT - 1; i++) {
+        if (viewDepth > ubo.cascadeSplits[i]) {
+            cascade = i + 1;
+        }
+    }
+
+    vec4 lightClip = ubo.cascadeViewProjections[cascade] * vec4(fragPosWorld, 1.0);
+    vec3 coords = lightClip.xyz / lightClip.w;
+    vec2 uv = coords.xy * 0.5 + 0.5;
+
+    // 3x3 pcf, each tap is a bilinear 2x2 comparison already
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * texelSize, float(cascade), coords.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+void main() {
+    float viewDepth = (lightBuffer.view * vec4(fragPosWorld, 1.0)).z;
+    uint slice = uint(clamp(log(viewDepth) * lightBuffer.viewport.z + lightBuffer.viewport.w, 0.0, float(CLUSTERS_Z - 1)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * lightBuffer.viewport.xy * vec2(CLUSTERS_X, CLUSTERS_Y)), uvec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+    uint clusterIndex = (slice * CLUSTERS_Y + tile.y) * CLUSTERS_X + tile.x;
+
+    vec3 normal = normalize(fragNormalWorld);
+    vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+
+    float directionalDiffuse = max(dot(normal, -ubo.directionalLightDirection.xyz), 0);
+    if (directionalDiffuse > 0) {
+        directionalDiffuse *= directionalShadow(viewDepth);
+    }
+    diffuseLight += ubo.directionalLightColor.xyz * ubo.directionalLightColor.w * directionalDiffuse;
+
+    uint lightCount = clusterBuffer.clusters[clusterIndex].lightCount;
+    for (uint i = 0; i < lightCount; i++) {
+        PointLight light = lightBuffer.lights[clusterBuffer.clusters[clusterIndex].lightIndices[i]];
+        vec3 directionToLight = light.positionRadius.xyz - fragPosWorld;
+        float distanceSquared = dot(directionToLight, directionToLight);
+        // inverse square falloff windowed to reach zero at the light's radius
+        float window = clamp(1.0 - pow(distanceSquared / (light.positionRadius.w * light.positionRadius.w), 2.0), 0.0, 1.0);
+        float attenuation = window * window / max(distanceSquared, 0.0001);
+
+        vec3 lightColor = light.color.xyz * light.color.w * attenuation;
+        diffuseLight += lightColor * max(dot(normal, normalize(directionToLight)), 0);
+    }
+
+    // the material is uniform across the draw, so are these branches and the derivatives sampling needs
+    vec3 albedo = material.baseColor.rgb;
+    if ((material.flags & MATERIAL_VERTEX_COLOR) != 0) {
+        albedo *= fragColor;
+    }
+    if (material.baseColorTexture != VT_INVALID_TEXTURE) {
+        albedo *= sampleVirtualTexture(material.baseColorTexture, fragUv).rgb;
+    }
+#ifdef BINDLESS
+    if (material.baseColorImage != BINDLESS_INVALID_INDEX) {
+        albedo *= texture(bindlessTextures[material.baseColorImage], fragUv).rgb;
+    }
+#endif
+    vec3 emissive = material.emissive.rgb * material.emissive.w;
+    if (material.emissiveTexture != VT_INVALID_TEXTURE) {
+        emissive *= sampleVirtualTexture(material.emissiveTexture, fragUv).rgb;
+    }
+
+    outColor = vec4(diffuseLight * albedo + emissive, material.baseColor.a);
+}
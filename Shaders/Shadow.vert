@@ -0,0 +1,11 @@
+#version 460
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+    mat4 lightModelViewProjection;
+} push;
+
+void main() {
+    gl_Position = push.lightModelViewProjection * vec4(position, 1.0);
+}
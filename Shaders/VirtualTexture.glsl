@@ -0,0 +1,83 @@
+// Virtual texture sampling, included by shaders that read VirtualTextureSystem textures
+
+// keep in sync with VirtualTextureSystem.hpp
+const uint VT_PAGE_SIZE = 128;
+const uint VT_PAGE_BORDER = 4;
+const uint VT_PAGE_PAYLOAD = VT_PAGE_SIZE - 2 * VT_PAGE_BORDER;
+const uint VT_MAX_TEXTURES = 256;
+const uint VT_FEEDBACK_SCALE = 8;
+const uint VT_INVALID_TEXTURE = 0xffffffffu;
+const uint VT_ENTRY_VALID = 0x80000000u;
+
+layout(set = 0, binding = 4) uniform sampler2D virtualTextureCache;
+
+layout(set = 0, binding = 5) readonly buffer VirtualPageTable {
+    // table offset, width, height, mip count
+    uvec4 infos[VT_MAX_TEXTURES];
+    // valid (1) | unused (11) | mip (4) | slot y (8) | slot x (8)
+    uint entries[];
+} virtualPageTable;
+
+layout(set = 0, binding = 6) buffer VirtualTextureFeedback {
+    uint width;
+    uint height;
+    uint jitter;
+    uint padding;
+    // texture (10) | mip (4) | page x (9) | page y (9)
+    uint requests[];
+} virtualTextureFeedback;
+
+uvec2 virtualLevelSize(uvec4 info, uint mip) {
+    return max(info.yz >> mip, uvec2(1));
+}
+
+uvec2 virtualPageCount(uvec4 info, uint mip) {
+    return (virtualLevelSize(info, mip) + VT_PAGE_PAYLOAD - 1) / VT_PAGE_PAYLOAD;
+}
+
+vec4 sampleVirtualTexture(uint textureId, vec2 uv) {
+    uvec4 info = virtualPageTable.infos[textureId];
+    if (info.w == 0) {
+        return vec4(0.5, 0.5, 0.5, 1.0);
+    }
+
+    // derivatives before wrapping, fract would spike them on the seams
+    vec2 texelCoords = uv * vec2(info.yz);
+    vec2 dx = dFdx(texelCoords);
+    vec2 dy = dFdy(texelCoords);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0));
+    uint mip = min(uint(lod), info.w - 1);
+    vec2 wrapped = fract(uv);
+
+    uvec2 pages = virtualPageCount(info, mip);
+    uvec2 page = min(uvec2(wrapped * vec2(virtualLevelSize(info, mip))) / VT_PAGE_PAYLOAD, pages - 1);
+
+    // one pixel per feedback cell writes each frame, a different one every frame
+    uvec2 pixel = uvec2(gl_FragCoord.xy);
+    uvec2 cell = pixel / VT_FEEDBACK_SCALE;
+    uvec2 inCell = pixel % VT_FEEDBACK_SCALE;
+    if (inCell.y * VT_FEEDBACK_SCALE + inCell.x == virtualTextureFeedback.jitter &&
+        cell.x < virtualTextureFeedback.width && cell.y < virtualTextureFeedback.height) {
+        virtualTextureFeedback.requests[cell.y * virtualTextureFeedback.width + cell.x] =
+            (textureId << 22) | (mip << 18) | (page.x << 9) | page.y;
+    }
+
+    uint mipOffset = 0;
+    for (uint m = 0; m < mip; m++) {
+        uvec2 levelPages = virtualPageCount(info, m);
+        mipOffset += levelPages.x * levelPages.y;
+    }
+    uint entry = virtualPageTable.entries[info.x + mipOffset + page.y * pages.x + page.x];
+    if ((entry & VT_ENTRY_VALID) == 0) {
+        return vec4(0.5, 0.5, 0.5, 1.0);
+    }
+
+    // the entry may point at a coarser page covering this one
+    uint residentMip = (entry >> 16) & 0xf;
+    uvec2 slot = uvec2(entry & 0xff, (entry >> 8) & 0xff);
+    uvec2 residentPage = page >> (residentMip - mip);
+    vec2 local = wrapped * vec2(virtualLevelSize(info, residentMip)) - vec2(residentPage * VT_PAGE_PAYLOAD);
+    local = clamp(local, vec2(0.5 - float(VT_PAGE_BORDER)), vec2(float(VT_PAGE_PAYLOAD + VT_PAGE_BORDER) - 0.5));
+    vec2 cacheCoords = vec2(slot * VT_PAGE_SIZE + VT_PAGE_BORDER) + local;
+    return textureLod(virtualTextureCache, cacheCoords / vec2(textureSize(virtualTextureCache, 0)), 0.0);
+}
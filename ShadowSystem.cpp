@@ -0,0 +1,289 @@
+#include "ShadowSystem.hpp"
+
+#include "GpuProfiler.hpp"
+#include "SamplerCache.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace Engine {
+
+    // blend between logarithmic (1) and uniform (0) split distances
+    constexpr float SPLIT_LAMBDA = .75f;
+    // cached cascades cover this much more than their slice so the camera can move before they are refitted
+    constexpr float CACHED_CASCADE_SLACK = 1.3f;
+    // cosine of the angle the light has to turn by before cached cascades are rendered again
+    constexpr float LIGHT_CHANGE_COS = .99999f;
+
+    ShadowSystem::ShadowSystem(Device &device, uint32_t resolution, float shadowDistance)
+        : device{device}, resolution{resolution}, shadowDistance{shadowDistance} {
+        createShadowMap();
+        createRenderPass();
+        createFramebuffers();
+        createSampler();
+        createPipeline();
+    }
+
+    ShadowSystem::~ShadowSystem() {
+        device.deferDestroy(pipelineLayout);
+
+        // frames in flight may still sample the shadow map
+        device.deletionQueue().push([
+            owner = &device,
+            device = device.device(),
+            framebuffers = framebuffers,
+            layerViews = layerViews,
+            renderPass = renderPass,
+            arrayView = arrayView,
+            image = image,
+            imageMemory = imageMemory]() {
+            for (auto framebuffer : framebuffers) {
+                device.destroyFramebuffer(framebuffer, nullptr);
+            }
+            for (auto view : layerViews) {
+                device.destroyImageView(view, nullptr);
+            }
+            device.destroyRenderPass(renderPass, nullptr);
+            device.destroyImageView(arrayView, nullptr);
+            device.destroyImage(image, nullptr);
+            owner->freeMemory(imageMemory);
+        });
+    }
+
+    void ShadowSystem::createShadowMap() {
+        depthFormat = device.findSupportedFormat(
+            {vk::Format::eD32Sfloat, vk::Format::eD16Unorm},
+            vk::ImageTiling::eOptimal,
+            vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage);
+
+        // one layer per cascade, shared by all frames in flight so cached layers survive
+        vk::ImageCreateInfo imageInfo{{}, vk::ImageType::e2D, depthFormat, {resolution, resolution, 1}, 1, SHADOW_CASCADE_COUNT, vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined};
+        device.createImageWithInfo(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, image, imageMemory);
+
+        vk::ImageViewCreateInfo viewInfo{{}, image, vk::ImageViewType::e2DArray, depthFormat, {}, {{vk::ImageAspectFlagBits::eDepth}, 0, 1, 0, SHADOW_CASCADE_COUNT}};
+        if (device.device().createImageView(&viewInfo, nullptr, &arrayView) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create shadow map image view!");
+        }
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            vk::ImageViewCreateInfo layerInfo{{}, image, vk::ImageViewType::e2D, depthFormat, {}, {{vk::ImageAspectFlagBits::eDepth}, 0, 1, i, 1}};
+            if (device.device().createImageView(&layerInfo, nullptr, &layerViews[i]) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to create shadow cascade image view!");
+            }
+        }
+    }
+
+    void ShadowSystem::createRenderPass() {
+        // every rendered cascade is cleared, its previous contents never matter
+        vk::AttachmentDescription depthAttachment{{}, depthFormat, vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+        vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::AttachmentReference depthAttachmentRef{0, vk::ImageLayout::eDepthStencilAttachmentOptimal};
+        vk::SubpassDescription subpass{{}, vk::PipelineBindPoint::eGraphics, 0, nullptr, 0, nullptr, nullptr, &depthAttachmentRef};
+
+        std::array<vk::SubpassDependency, 2> dependencies{
+            // earlier frames' shading reads the layer this pass overwrites
+            vk::SubpassDependency{VK_SUBPASS_EXTERNAL, 0,
+            vk::PipelineStageFlagBits::eFragmentShader,
+            vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+            {}, vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite},
+            // this frame's shading samples it
+            vk::SubpassDependency{0, VK_SUBPASS_EXTERNAL,
+            vk::PipelineStageFlagBits::eLateFragmentTests,
+            vk::PipelineStageFlagBits::eFragmentShader,
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead}};
+
+        vk::RenderPassCreateInfo renderPassInfo{{}, 1, &depthAttachment, 1, &subpass, static_cast<uint32_t>(dependencies.size()), dependencies.data()};
+        if (device.device().createRenderPass(&renderPassInfo, nullptr, &renderPass) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create shadow render pass!");
+        }
+    }
+
+    void ShadowSystem::createFramebuffers() {
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            vk::FramebufferCreateInfo framebufferInfo{{}, renderPass, 1, &layerViews[i], resolution, resolution, 1};
+            if (device.device().createFramebuffer(&framebufferInfo, nullptr, &framebuffers[i]) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to create shadow framebuffer!");
+            }
+        }
+    }
+
+    void ShadowSystem::createSampler() {
+        // hardware depth comparison with bilinear filtering, outside the map counts as lit
+        vk::SamplerCreateInfo samplerInfo{};
+        samplerInfo.setMagFilter(vk::Filter::eLinear);
+        samplerInfo.setMinFilter(vk::Filter::eLinear);
+        samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eNearest);
+        samplerInfo.setAddressModeU(vk::SamplerAddressMode::eClampToBorder);
+        samplerInfo.setAddressModeV(vk::SamplerAddressMode::eClampToBorder);
+        samplerInfo.setAddressModeW(vk::SamplerAddressMode::eClampToBorder);
+        samplerInfo.setBorderColor(vk::BorderColor::eFloatOpaqueWhite);
+        samplerInfo.setCompareEnable(true);
+        samplerInfo.setCompareOp(vk::CompareOp::eLessOrEqual);
+        samplerInfo.setMaxLod(1.f);
+        sampler = device.samplerCache().get(samplerInfo);
+    }
+
+    void ShadowSystem::createPipeline() {
+        vk::PushConstantRange pushConstantRange{vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4)};
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, 0, nullptr, 1, &pushConstantRange};
+        if (device.device().createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create shadow pipeline layout!");
+        }
+
+        PipelineConfigInfo pipelineConfig{};
+        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.renderPass = renderPass;
+        pipelineConfig.pipelineLayout = pipelineLayout;
+        pipelineConfig.bindingDescriptions = Model::Vertex::getPositionBindingDescriptions();
+        pipelineConfig.attributeDescriptions = Model::Vertex::getPositionAttributeDescriptions();
+        pipelineConfig.colorBlendInfo.setAttachmentCount(0);
+        // pushes depth away from the light along steep slopes to avoid acne
+        pipelineConfig.rasterizationInfo.setDepthBiasEnable(true);
+        pipelineConfig.rasterizationInfo.setDepthBiasConstantFactor(1.25f);
+        pipelineConfig.rasterizationInfo.setDepthBiasSlopeFactor(1.75f);
+        pipeline = std::make_unique<Pipeline>(device, "./Shaders/Shadow.vert.spv", "", pipelineConfig);
+    }
+
+    void ShadowSystem::update(const Camera &camera, glm::vec3 direction, GameObject::Map &gameObjects) {
+        const glm::mat4 &projection = camera.getProjection();
+        assert(projection[2][3] == 1.f && "Shadow cascades are fitted to a perspective projection");
+        lightDirection = glm::normalize(direction);
+
+        float near = camera.getNear();
+        float far = std::min(camera.getFar(), shadowDistance);
+        glm::mat4 inverseView = glm::inverse(camera.getView());
+
+        float sliceNear = near;
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            float p = static_cast<float>(i + 1) / SHADOW_CASCADE_COUNT;
+            float split = SPLIT_LAMBDA * near * std::pow(far / near, p) + (1.f - SPLIT_LAMBDA) * (near + (far - near) * p);
+
+            // bounding sphere of the slice's corners, a sphere keeps the projection size fixed as the camera turns
+            std::array<glm::vec3, 8> corners;
+            glm::vec3 center{0.f};
+            for (uint32_t k = 0; k < corners.size(); k++) {
+                float depth = k < 4 ? sliceNear : split;
+                float x = (k & 1 ? depth : -depth) / projection[0][0];
+                float y = (k & 2 ? depth : -depth) / projection[1][1];
+                corners[k] = glm::vec3{inverseView * glm::vec4{x, y, depth, 1.f}};
+                center += corners[k];
+            }
+            center /= static_cast<float>(corners.size());
+            float radius = 0.f;
+            for (const auto &corner : corners) {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.f) / 16.f;
+
+            Cascade &cascade = cascades[i];
+            cascade.splitDepth = split;
+            if (i < FIRST_CACHED_CASCADE) {
+                fitCascade(cascade, center, radius);
+                cascade.render = true;
+            } else {
+                bool reusable = cascade.rendered && staticCascadesValid &&
+                    glm::dot(cascade.lightDirection, lightDirection) >= LIGHT_CHANGE_COS &&
+                    glm::length(center - cascade.center) + radius <= cascade.radius;
+                if (!reusable) {
+                    fitCascade(cascade, center, radius * CACHED_CASCADE_SLACK);
+                }
+                bool containsDynamic = containsDynamicObject(cascade, gameObjects);
+                cascade.render = !reusable || containsDynamic || cascade.containedDynamic;
+                cascade.containedDynamic = containsDynamic;
+            }
+            sliceNear = split;
+        }
+        staticCascadesValid = true;
+    }
+
+    void ShadowSystem::fitCascade(Cascade &cascade, glm::vec3 center, float radius) {
+        glm::vec3 up = std::abs(lightDirection.y) > .99f ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{0.f, -1.f, 0.f};
+        Camera lightCamera{};
+        lightCamera.setViewDirection(glm::vec3{0.f}, lightDirection, up);
+
+        // moving the projection in whole texels keeps shadow edges from crawling while the camera moves
+        float texelSize = 2.f * radius / static_cast<float>(resolution);
+        glm::vec3 lightCenter{lightCamera.getView() * glm::vec4{center, 1.f}};
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+        // casters between the light and the slice still have to land in the map
+        lightCamera.setOrthographicProjection(
+            lightCenter.x - radius, lightCenter.x + radius,
+            lightCenter.y - radius, lightCenter.y + radius,
+            lightCenter.z - radius - shadowDistance, lightCenter.z + radius);
+
+        cascade.viewProjection = lightCamera.getProjection() * lightCamera.getView();
+        cascade.center = center;
+        cascade.radius = radius;
+        cascade.lightDirection = lightDirection;
+    }
+
+    bool ShadowSystem::overlaps(const Cascade &cascade, const GameObject &obj) {
+        // models are roughly unit sized, the largest scale bounds the object
+        const glm::vec3 &scale = obj.transform.scale;
+        float margin = std::max({std::abs(scale.x), std::abs(scale.y), std::abs(scale.z)}) / cascade.radius;
+        glm::vec4 position = cascade.viewProjection * glm::vec4{obj.transform.translation, 1.f};
+        return std::abs(position.x) <= 1.f + margin && std::abs(position.y) <= 1.f + margin;
+    }
+
+    bool ShadowSystem::containsDynamicObject(const Cascade &cascade, GameObject::Map &gameObjects) const {
+        for (auto &kv : gameObjects) {
+            const GameObject &obj = kv.second;
+            if (!obj.isStatic && obj.model != nullptr && overlaps(cascade, obj)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ShadowSystem::writeUniforms(GlobalUbo &ubo) const {
+        ubo.directionalLightDirection = glm::vec4{lightDirection, 0.f};
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            ubo.cascadeSplits[i] = cascades[i].splitDepth;
+            ubo.cascadeViewProjections[i] = cascades[i].viewProjection;
+        }
+    }
+
+    void ShadowSystem::render(vk::CommandBuffer commandBuffer, GameObject::Map &gameObjects) {
+        GpuProfiler::Scope profileScope{device.gpuProfiler(), commandBuffer, "ShadowCascades"};
+        renderedCascadeCount = 0;
+
+        vk::Viewport viewport{0.f, 0.f, static_cast<float>(resolution), static_cast<float>(resolution), 0.f, 1.f};
+        vk::Rect2D scissor{{0, 0}, {resolution, resolution}};
+        vk::ClearValue clearValue{vk::ClearDepthStencilValue{1.f, 0}};
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            Cascade &cascade = cascades[i];
+            if (!cascade.render) {
+                continue;
+            }
+
+            vk::RenderPassBeginInfo renderPassInfo{renderPass, framebuffers[i], scissor, 1, &clearValue};
+            commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+            commandBuffer.setViewport(0, 1, &viewport);
+            commandBuffer.setScissor(0, 1, &scissor);
+            pipeline->bind(commandBuffer);
+
+            Model *boundModel = nullptr;
+            for (auto &kv : gameObjects) {
+                GameObject &obj = kv.second;
+                if (obj.model == nullptr || !overlaps(cascade, obj)) {
+                    continue;
+                }
+                glm::mat4 lightModelViewProjection = cascade.viewProjection * obj.transform.mat4();
+                commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4), &lightModelViewProjection);
+                if (obj.model.get() != boundModel) {
+                    obj.model->bindPositions(commandBuffer);
+                    boundModel = obj.model.get();
+                }
+                obj.model->draw(commandBuffer);
+            }
+
+            commandBuffer.endRenderPass();
+            cascade.rendered = true;
+            renderedCascadeCount++;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "Device.hpp"
+#include "FrameInfo.hpp"
+#include "GameObject.hpp"
+#include "Pipeline.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <memory>
+
+namespace Engine {
+
+    // Cascaded shadow maps for one directional light. The camera frustum up to shadowDistance is split into
+    // SHADOW_CASCADE_COUNT slices, each rendered into one layer of a depth array with an orthographic light projection
+    // fitted around the slice's bounding sphere.
+    //
+    // Cascades from FIRST_CACHED_CASCADE on are cached. They are fitted with some slack and keep their projection while
+    // the camera's slice stays inside it, and they are only re-rendered when the light turns, static objects change or a
+    // dynamic object is (or was) inside them. The near cascades cover little space and are rendered every frame.
+    class ShadowSystem {
+        public:
+        static constexpr uint32_t FIRST_CACHED_CASCADE = 2;
+
+        ShadowSystem(Device &device, uint32_t resolution = 2048, float shadowDistance = 60.f);
+        ~ShadowSystem();
+
+        ShadowSystem(const ShadowSystem &) = delete;
+        ShadowSystem &operator=(const ShadowSystem &) = delete;
+
+        // Fits the cascades to the camera frustum and decides which of them are rendered this frame.
+        // lightDirection is the direction the light travels in.
+        void update(const Camera &camera, glm::vec3 lightDirection, GameObject::Map &gameObjects);
+        // Static objects were added, moved or removed, the cached cascades are rendered again on the next update
+        void invalidateStaticCascades() { staticCascadesValid = false; }
+        // Cascade splits and matrices for the shading pass
+        void writeUniforms(GlobalUbo &ubo) const;
+
+        // Records the cascades picked by update, outside of any render pass and before the shading pass samples them
+        void render(vk::CommandBuffer commandBuffer, GameObject::Map &gameObjects);
+
+        // For a combined image sampler binding, the array view is always in shader read only layout between frames
+        vk::DescriptorImageInfo descriptorInfo() const { return {sampler, arrayView, vk::ImageLayout::eShaderReadOnlyOptimal}; }
+
+        // cascades recorded by the last render, cached ones included only when they were refreshed
+        uint32_t getRenderedCascadeCount() const { return renderedCascadeCount; }
+
+        private:
+        struct Cascade {
+            glm::mat4 viewProjection{1.f};
+            // view depth the cascade ends at
+            float splitDepth = 0.f;
+            // bounding sphere the projection was fitted to
+            glm::vec3 center{};
+            float radius = 0.f;
+            glm::vec3 lightDirection{};
+            bool rendered = false;
+            bool render = true;
+            // a dynamic object was drawn into it, its shadow has to be cleared once the object leaves
+            bool containedDynamic = false;
+        };
+
+        void createShadowMap();
+        void createRenderPass();
+        void createFramebuffers();
+        void createSampler();
+        void createPipeline();
+
+        void fitCascade(Cascade &cascade, glm::vec3 center, float radius);
+        // conservative, objects are culled against the cascade's sides but not its depth range
+        static bool overlaps(const Cascade &cascade, const GameObject &obj);
+        bool containsDynamicObject(const Cascade &cascade, GameObject::Map &gameObjects) const;
+
+        Device &device;
+        uint32_t resolution;
+        float shadowDistance;
+
+        vk::Format depthFormat;
+        vk::Image image;
+        vk::DeviceMemory imageMemory;
+        vk::ImageView arrayView;
+        std::array<vk::ImageView, SHADOW_CASCADE_COUNT> layerViews{};
+        std::array<vk::Framebuffer, SHADOW_CASCADE_COUNT> framebuffers{};
+        vk::RenderPass renderPass;
+        vk::Sampler sampler;
+
+        vk::PipelineLayout pipelineLayout;
+        std::unique_ptr<Pipeline> pipeline;
+
+        std::array<Cascade, SHADOW_CASCADE_COUNT> cascades{};
+        glm::vec3 lightDirection{0.f, 1.f, 0.f};
+        bool staticCascadesValid = false;
+        uint32_t renderedCascadeCount = 0;
+    };
+}
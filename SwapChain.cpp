@@ -1,5 +1,7 @@
 #include "SwapChain.hpp"
 
+#include "CpuProfiler.hpp"
+
 // std
 #include <array>
 #include <cstdlib>
@@ -11,91 +13,138 @@
 
 namespace Engine {
 
-    SwapChain::SwapChain(Device &deviceRef, vk::Extent2D extent)
-        : device{deviceRef}, windowExtent{extent} {
+    SwapChain::SwapChain(Device &deviceRef, vk::Extent2D extent, vk::PresentModeKHR preferredPresentMode)
+        : device{deviceRef}, windowExtent{extent}, preferredPresentMode{preferredPresentMode} {
         init();
     }
 
     SwapChain::SwapChain(
-        Device &deviceRef, vk::Extent2D extent, std::shared_ptr<SwapChain> previous)
-        : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+        Device &deviceRef, vk::Extent2D extent, std::shared_ptr<SwapChain> previous, vk::PresentModeKHR preferredPresentMode)
+        : device{deviceRef}, windowExtent{extent}, preferredPresentMode{preferredPresentMode}, oldSwapChain{previous} {
         init();
         oldSwapChain = nullptr;
     }
 
     void SwapChain::init() {
-        createSwapChain();
+        if (isOffscreen()) {
+            createOffscreenImages();
+        } else {
+            createSwapChain();
+        }
         createImageViews();
-        createRenderPass();
-        createDepthResources();
-        createFramebuffers();
         createSyncObjects();
     }
 
     SwapChain::~SwapChain() {
-        for (auto imageView : swapChainImageViews) {
-            device.device().destroyImageView(imageView, nullptr);
-        }
-        swapChainImageViews.clear();
-
-        if (swapChain) {
-            device.device().destroySwapchainKHR(swapChain, nullptr);
-            swapChain = nullptr;
-        }
-
-        for (int i = 0; i < depthImages.size(); i++) {
-            device.device().destroyImageView(depthImageViews[i], nullptr);
-            device.device().destroyImage(depthImages[i], nullptr);
-            device.device().freeMemory(depthImageMemorys[i], nullptr);
-        }
+        // frames submitted up to now may still render into or present from these, so the handles are
+        // released once they complete instead of idling the device
+        device.deletionQueue().push([
+            owner = &device,
+            device = device.device(),
+            swapChain = swapChain,
+            swapChainImages = std::move(swapChainImages),
+            swapChainImageMemorys = std::move(swapChainImageMemorys),
+            swapChainImageViews = std::move(swapChainImageViews),
+            imageAvailableSemaphores = std::move(imageAvailableSemaphores),
+            renderFinishedSemaphores = std::move(renderFinishedSemaphores)]() {
+            for (auto imageView : swapChainImageViews) {
+                device.destroyImageView(imageView, nullptr);
+            }
 
-        for (auto framebuffer : swapChainFramebuffers) {
-            device.device().destroyFramebuffer(framebuffer, nullptr);
-        }
+            if (swapChain) {
+                device.destroySwapchainKHR(swapChain, nullptr);
+            }
 
-        device.device().destroyRenderPass(renderPass, nullptr);
+            // offscreen images are owned by us rather than by a swapchain
+            for (size_t i = 0; i < swapChainImageMemorys.size(); i++) {
+                device.destroyImage(swapChainImages[i], nullptr);
+                owner->freeMemory(swapChainImageMemorys[i]);
+            }
 
-        // cleanup synchronization objects
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            device.device().destroySemaphore(renderFinishedSemaphores[i], nullptr);
-            device.device().destroySemaphore(imageAvailableSemaphores[i], nullptr);
-            device.device().destroyFence(inFlightFences[i], nullptr);
-        }
+            // cleanup synchronization objects
+            for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
+                device.destroySemaphore(renderFinishedSemaphores[i], nullptr);
+                device.destroySemaphore(imageAvailableSemaphores[i], nullptr);
+            }
+        });
     }
 
     vk::Result SwapChain::acquireNextImage(uint32_t *imageIndex) {
-        device.device().waitForFences(1, &inFlightFences[currentFrame], true, std::numeric_limits<uint64_t>::max());
+        CpuProfiler::Zone zone{"Acquire image"};
+        // the frame scheduler has already waited until this frame's slot is free
+        uint32_t frameIndex = device.frameScheduler().currentFrameIndex();
+
+        if (isOffscreen()) {
+            // nothing to acquire, submitCommandBuffers waits if the image is still being rendered to
+            *imageIndex = nextOffscreenImage;
+            nextOffscreenImage = (nextOffscreenImage + 1) % imageCount();
+            return vk::Result::eSuccess;
+        }
 
-        vk::Result result = device.device().acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], nullptr, imageIndex);
+        vk::Result result = device.device().acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[frameIndex], nullptr, imageIndex);
 
         return result;
     }
 
-    vk::Result SwapChain::submitCommandBuffers(const vk::CommandBuffer *buffers, uint32_t *imageIndex) {
-        if (imagesInFlight[*imageIndex]) {
-            device.device().waitForFences(1, &imagesInFlight[*imageIndex], true, UINT64_MAX);
+    vk::Result SwapChain::submitCommandBuffers(const vk::CommandBuffer *buffers, uint32_t *imageIndex, const std::vector<SemaphoreWait> &timelineWaits) {
+        CpuProfiler::Zone zone{"Submit"};
+        FrameScheduler &scheduler = device.frameScheduler();
+        uint32_t frameIndex = scheduler.currentFrameIndex();
+        uint64_t frame = scheduler.currentFrame();
+
+        // only blocks if an older frame still renders into the acquired image
+        scheduler.waitForFrame(imageFrames[*imageIndex]);
+        imageFrames[*imageIndex] = frame;
+
+        std::vector<vk::Semaphore> waitSemaphores;
+        std::vector<vk::PipelineStageFlags> waitStages;
+        std::vector<uint64_t> waitValues;
+        if (!isOffscreen()) {
+            waitSemaphores.push_back(imageAvailableSemaphores[frameIndex]);
+            // the image is first written by post processing, with a dispatch or a blit
+            waitStages.push_back(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer);
+            waitValues.push_back(0);
+        }
+        for (const auto &wait : timelineWaits) {
+            waitSemaphores.push_back(wait.semaphore);
+            waitStages.push_back(wait.stages);
+            waitValues.push_back(wait.value);
         }
-        imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
         vk::SubmitInfo submitInfo{};
-
-        vk::Semaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-        submitInfo.setWaitSemaphoreCount(1);
-        submitInfo.setPWaitSemaphores(waitSemaphores);
-        submitInfo.setPWaitDstStageMask(waitStages);
+        submitInfo.setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size()));
+        submitInfo.setPWaitSemaphores(waitSemaphores.data());
+        submitInfo.setPWaitDstStageMask(waitStages.data());
 
         submitInfo.setCommandBufferCount(1);
         submitInfo.setPCommandBuffers(buffers);
 
-        vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.setSignalSemaphoreCount(1);
+        if (isOffscreen()) {
+            vk::Semaphore timeline = scheduler.timeline();
+            vk::TimelineSemaphoreSubmitInfo timelineInfo{static_cast<uint32_t>(waitValues.size()), waitValues.data(), 1, &frame};
+            submitInfo.setSignalSemaphoreCount(1);
+            submitInfo.setPSignalSemaphores(&timeline);
+            submitInfo.setPNext(&timelineInfo);
+
+            if (device.graphicsQueue().submit(1, &submitInfo, nullptr) != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+            scheduler.frameSubmitted();
+            return vk::Result::eSuccess;
+        }
+
+        vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[frameIndex], scheduler.timeline()};
+        uint64_t signalValues[] = {0, frame};
+        submitInfo.setSignalSemaphoreCount(2);
         submitInfo.setPSignalSemaphores(signalSemaphores);
 
-        device.device().resetFences(1, &inFlightFences[currentFrame]);
-        if (device.graphicsQueue().submit(1, &submitInfo, inFlightFences[currentFrame]) != vk::Result::eSuccess) {
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{static_cast<uint32_t>(waitValues.size()), waitValues.data(), 2, signalValues};
+        submitInfo.setPNext(&timelineInfo);
+
+        if (device.graphicsQueue().submit(1, &submitInfo, nullptr) != vk::Result::eSuccess) {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
+        scheduler.frameSubmitted();
 
         vk::PresentInfoKHR presentInfo{};
 
@@ -108,10 +157,9 @@ namespace Engine {
 
         presentInfo.setPImageIndices(imageIndex);
 
+        CpuProfiler::Zone presentZone{"Present"};
         auto result = device.presentQueue().presentKHR(&presentInfo);
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
         return result;
     }
 
@@ -128,7 +176,19 @@ namespace Engine {
             imageCount = swapChainSupport.capabilities.maxImageCount;
         }
 
-        vk::SwapchainCreateInfoKHR createInfo{{}, device.surface(), imageCount, surfaceFormat.format, surfaceFormat.colorSpace, extent, 1, vk::ImageUsageFlagBits::eColorAttachment};
+        // post processing writes the image directly when it can be a storage image, otherwise it blits into it
+        vk::ImageUsageFlags supportedUsage = swapChainSupport.capabilities.supportedUsageFlags;
+        storageOutput = (supportedUsage & vk::ImageUsageFlagBits::eStorage) &&
+            device.supportsFormat(surfaceFormat.format, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eStorageImage);
+        vk::ImageUsageFlags usage = storageOutput ? vk::ImageUsageFlagBits::eStorage : vk::ImageUsageFlags{};
+        if (supportedUsage & vk::ImageUsageFlagBits::eTransferDst) {
+            usage |= vk::ImageUsageFlagBits::eTransferDst;
+        }
+        if (!usage) {
+            throw std::runtime_error("failed to create swap chain, images support neither storage nor transfer writes!");
+        }
+
+        vk::SwapchainCreateInfoKHR createInfo{{}, device.surface(), imageCount, surfaceFormat.format, surfaceFormat.colorSpace, extent, 1, usage};
 
         QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
         uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
@@ -167,77 +227,69 @@ namespace Engine {
         swapChainExtent = extent;
     }
 
-    void SwapChain::createImageViews() {
-        swapChainImageViews.resize(swapChainImages.size());
-        for (size_t i = 0; i < swapChainImages.size(); i++) {
-            vk::ImageViewCreateInfo viewInfo{{}, swapChainImages[i], vk::ImageViewType::e2D, swapChainImageFormat, {}, {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
-
-            if (device.device().createImageView(&viewInfo, nullptr, &swapChainImageViews[i]) != vk::Result::eSuccess) {
-                throw std::runtime_error("failed to create texture image view!");
-            }
-        }
-    }
-
-    void SwapChain::createRenderPass() {
-        vk::AttachmentDescription depthAttachment{{}, findDepthFormat(), vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare,
-        vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-
-        vk::AttachmentReference depthAttachmentRef{1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-
-        vk::AttachmentDescription colorAttachment{{}, getSwapChainImageFormat(), vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
-        vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR};
-
-        vk::AttachmentReference colorAttachmentRef{0, vk::ImageLayout::eColorAttachmentOptimal};
-
-        vk::SubpassDescription subpass{{}, vk::PipelineBindPoint::eGraphics, 0, nullptr, 1, &colorAttachmentRef, nullptr, &depthAttachmentRef};
+    void SwapChain::createOffscreenImages() {
+        // unorm so compute can write it, post processing encodes sRGB itself
+        swapChainImageFormat = vk::Format::eR8G8B8A8Unorm;
+        swapChainExtent = windowExtent;
+        storageOutput = true;
 
-        vk::SubpassDependency dependency{VK_SUBPASS_EXTERNAL, 0, {vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests},
-        {vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests}, {}, {vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite}};
+        // one image per frame slot is enough since nothing waits on a presentation engine
+        swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+        swapChainImageMemorys.resize(MAX_FRAMES_IN_FLIGHT);
 
-        std::array<vk::AttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
-        vk::RenderPassCreateInfo renderPassInfo{{}, static_cast<uint32_t>(attachments.size()), attachments.data(), 1, &subpass, 1, &dependency};
+        for (size_t i = 0; i < swapChainImages.size(); i++) {
+            vk::ImageCreateInfo imageInfo{{}, vk::ImageType::e2D, swapChainImageFormat, {swapChainExtent.width, swapChainExtent.height, 1}, 1, 1, vk::SampleCountFlagBits::e1,
+            vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined};
 
-        if (device.device().createRenderPass(&renderPassInfo, nullptr, &renderPass) != vk::Result::eSuccess) {
-            throw std::runtime_error("failed to create render pass!");
+            device.createImageWithInfo(
+                imageInfo,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                swapChainImages[i],
+                swapChainImageMemorys[i]);
         }
     }
 
-    void SwapChain::createFramebuffers() {
-        swapChainFramebuffers.resize(imageCount());
-        for (size_t i = 0; i < imageCount(); i++) {
-            std::array<vk::ImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
-
-            vk::Extent2D swapChainExtent = getSwapChainExtent();
-            vk::FramebufferCreateInfo framebufferInfo{{}, renderPass, static_cast<uint32_t>(attachments.size()), attachments.data(), swapChainExtent.width, swapChainExtent.height, 1};
-
-            if (device.device().createFramebuffer(&framebufferInfo, nullptr, &swapChainFramebuffers[i]) != vk::Result::eSuccess) {
-                throw std::runtime_error("failed to create framebuffer!");
-            }
+    std::vector<uint8_t> SwapChain::readImage(uint32_t imageIndex) {
+        if (!isOffscreen()) {
+            throw std::runtime_error("failed to read image, only offscreen images can be read back!");
         }
-    }
-
-    void SwapChain::createDepthResources() {
-        vk::Format depthFormat = findDepthFormat();
-        swapChainDepthFormat = depthFormat;
-        vk::Extent2D swapChainExtent = getSwapChainExtent();
-
-        depthImages.resize(imageCount());
-        depthImageMemorys.resize(imageCount());
-        depthImageViews.resize(imageCount());
-
-        for (int i = 0; i < depthImages.size(); i++) {
-            vk::ImageCreateInfo imageInfo{{}, vk::ImageType::e2D, depthFormat, {swapChainExtent.width, swapChainExtent.height, 1}, 1, 1, vk::SampleCountFlagBits::e1,
-            vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined};
+        device.frameScheduler().waitForFrame(imageFrames[imageIndex]);
+
+        vk::DeviceSize size = static_cast<vk::DeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+        vk::Buffer stagingBuffer;
+        vk::DeviceMemory stagingMemory;
+        device.createBuffer(
+            size,
+            vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            stagingBuffer,
+            stagingMemory);
+
+        // post processing leaves offscreen images in transfer source layout
+        vk::CommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        vk::BufferImageCopy region{0, 0, 0, {vk::ImageAspectFlagBits::eColor, 0, 0, 1}, {0, 0, 0}, {swapChainExtent.width, swapChainExtent.height, 1}};
+        commandBuffer.copyImageToBuffer(swapChainImages[imageIndex], vk::ImageLayout::eTransferSrcOptimal, stagingBuffer, 1, &region);
+        device.endSingleTimeCommands(commandBuffer);
+
+        std::vector<uint8_t> pixels(size);
+        void *data = nullptr;
+        if (device.device().mapMemory(stagingMemory, 0, size, {}, &data) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to map readback buffer!");
+        }
+        std::memcpy(pixels.data(), data, static_cast<size_t>(size));
+        device.device().unmapMemory(stagingMemory);
 
-            device.createImageWithInfo(
-                imageInfo,
-                vk::MemoryPropertyFlagBits::eDeviceLocal,
-                depthImages[i],
-                depthImageMemorys[i]);
+        device.device().destroyBuffer(stagingBuffer, nullptr);
+        device.freeMemory(stagingMemory);
+        return pixels;
+    }
 
-            vk::ImageViewCreateInfo viewInfo{{}, depthImages[i], vk::ImageViewType::e2D, depthFormat, {}, {{vk::ImageAspectFlagBits::eDepth}, 0, 1, 0, 1}};
+    void SwapChain::createImageViews() {
+        swapChainImageViews.resize(swapChainImages.size());
+        for (size_t i = 0; i < swapChainImages.size(); i++) {
+            vk::ImageViewCreateInfo viewInfo{{}, swapChainImages[i], vk::ImageViewType::e2D, swapChainImageFormat, {}, {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
 
-            if (device.device().createImageView(&viewInfo, nullptr, &depthImageViews[i]) != vk::Result::eSuccess) {
+            if (device.device().createImageView(&viewInfo, nullptr, &swapChainImageViews[i]) != vk::Result::eSuccess) {
                 throw std::runtime_error("failed to create texture image view!");
             }
         }
@@ -246,17 +298,13 @@ namespace Engine {
     void SwapChain::createSyncObjects() {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.resize(imageCount(), nullptr);
+        imageFrames.resize(imageCount(), 0);
 
         vk::SemaphoreCreateInfo semaphoreInfo{};
 
-        vk::FenceCreateInfo fenceInfo{{vk::FenceCreateFlagBits::eSignaled}};
-
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             if (device.device().createSemaphore(&semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != vk::Result::eSuccess ||
-                device.device().createSemaphore(&semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != vk::Result::eSuccess ||
-                device.device().createFence(&fenceInfo, nullptr, &inFlightFences[i])  != vk::Result::eSuccess) {
+                device.device().createSemaphore(&semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != vk::Result::eSuccess) {
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
         }
@@ -264,6 +312,14 @@ namespace Engine {
 
     vk::SurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(
         const std::vector<vk::SurfaceFormatKHR> &availableFormats) {
+        // unorm formats can usually be storage images, post processing encodes sRGB when writing them
+        for (const auto &availableFormat : availableFormats) {
+            if ((availableFormat.format == vk::Format::eB8G8R8A8Unorm || availableFormat.format == vk::Format::eR8G8B8A8Unorm) &&
+                availableFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+                return availableFormat;
+            }
+        }
+
         for (const auto &availableFormat : availableFormats) {
             if (availableFormat.format == vk::Format::eB8G8R8A8Srgb && availableFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
                 return availableFormat;
@@ -275,6 +331,13 @@ namespace Engine {
 
     vk::PresentModeKHR SwapChain::chooseSwapPresentMode(
         const std::vector<vk::PresentModeKHR> &availablePresentModes) {
+        for (const auto &availablePresentMode : availablePresentModes) {
+            if (availablePresentMode == preferredPresentMode) {
+                std::cout << "Present mode: " << vk::to_string(availablePresentMode) << std::endl;
+                return availablePresentMode;
+            }
+        }
+
         for (const auto &availablePresentMode : availablePresentModes) {
             if (availablePresentMode == vk::PresentModeKHR::eMailbox) {
                 std::cout << "Present mode: Mailbox" << std::endl;
@@ -12,25 +12,34 @@
 
 namespace Engine {
 
+    // Timeline semaphore value the frame's submission waits for before the given stages
+    struct SemaphoreWait {
+        vk::Semaphore semaphore;
+        uint64_t value;
+        vk::PipelineStageFlags stages;
+    };
+
     class SwapChain {
         public:
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+        static constexpr int MAX_FRAMES_IN_FLIGHT = FrameScheduler::MAX_FRAMES_IN_FLIGHT;
 
-        SwapChain(Device &deviceRef, vk::Extent2D windowExtent);
+        SwapChain(Device &deviceRef, vk::Extent2D windowExtent, vk::PresentModeKHR preferredPresentMode = vk::PresentModeKHR::eMailbox);
         SwapChain(
-            Device &deviceRef, vk::Extent2D windowExtent, std::shared_ptr<SwapChain> previous);
+            Device &deviceRef, vk::Extent2D windowExtent, std::shared_ptr<SwapChain> previous,
+            vk::PresentModeKHR preferredPresentMode = vk::PresentModeKHR::eMailbox);
 
         ~SwapChain();
 
         SwapChain(const SwapChain &) = delete;
         SwapChain &operator=(const SwapChain &) = delete;
 
-        vk::Framebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-        vk::RenderPass getRenderPass() { return renderPass; }
         vk::ImageView getImageView(int index) { return swapChainImageViews[index]; }
+        vk::Image getImage(int index) { return swapChainImages[index]; }
         size_t imageCount() { return swapChainImages.size(); }
         vk::Format getSwapChainImageFormat() { return swapChainImageFormat; }
         vk::Extent2D getSwapChainExtent() { return swapChainExtent; }
+        // the images can be written by compute, otherwise they only take transfers
+        bool supportsStorageOutput() const { return storageOutput; }
         uint32_t width() { return swapChainExtent.width; }
         uint32_t height() { return swapChainExtent.height; }
 
@@ -40,20 +49,18 @@ namespace Engine {
         vk::Format findDepthFormat();
 
         vk::Result acquireNextImage(uint32_t *imageIndex);
-        vk::Result submitCommandBuffers(const vk::CommandBuffer *buffers, uint32_t *imageIndex);
+        vk::Result submitCommandBuffers(const vk::CommandBuffer *buffers, uint32_t *imageIndex, const std::vector<SemaphoreWait> &timelineWaits = {});
 
-        bool compareSwapFormats(const SwapChain &swapChain) const {
-            return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
-                swapChain.swapChainImageFormat == swapChainImageFormat;
-        }
+        // Headless devices render into plain images that are never presented and can be read back
+        bool isOffscreen() const { return device.isHeadless(); }
+        // Waits for the last frame that rendered into the image and copies it out as tightly packed RGBA8
+        std::vector<uint8_t> readImage(uint32_t imageIndex);
 
         private:
         void init();
         void createSwapChain();
+        void createOffscreenImages();
         void createImageViews();
-        void createDepthResources();
-        void createRenderPass();
-        void createFramebuffers();
         void createSyncObjects();
 
         // Helper functions
@@ -64,29 +71,25 @@ namespace Engine {
         vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilities);
 
         vk::Format swapChainImageFormat;
-        vk::Format swapChainDepthFormat;
         vk::Extent2D swapChainExtent;
 
-        std::vector<vk::Framebuffer> swapChainFramebuffers;
-        vk::RenderPass renderPass;
-
-        std::vector<vk::Image> depthImages;
-        std::vector<vk::DeviceMemory> depthImageMemorys;
-        std::vector<vk::ImageView> depthImageViews;
         std::vector<vk::Image> swapChainImages;
+        std::vector<vk::DeviceMemory> swapChainImageMemorys;
         std::vector<vk::ImageView> swapChainImageViews;
+        uint32_t nextOffscreenImage = 0;
+        bool storageOutput = false;
 
         Device &device;
         vk::Extent2D windowExtent;
+        vk::PresentModeKHR preferredPresentMode;
 
         vk::SwapchainKHR swapChain;
         std::shared_ptr<SwapChain> oldSwapChain;
 
+        // binary semaphores are still needed for acquire and present, frame completion is on the timeline
         std::vector<vk::Semaphore> imageAvailableSemaphores;
         std::vector<vk::Semaphore> renderFinishedSemaphores;
-        std::vector<vk::Fence> inFlightFences;
-        std::vector<vk::Fence> imagesInFlight;
-        size_t currentFrame = 0;
+        std::vector<uint64_t> imageFrames;
     };
 
 }
@@ -0,0 +1,366 @@
+#include "Texture.hpp"
+
+#include "Buffer.hpp"
+#include "Ktx2.hpp"
+#include "SamplerCache.hpp"
+#include "UploadQueue.hpp"
+
+// libs
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Engine {
+
+    struct DdsPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t rBitMask;
+        uint32_t gBitMask;
+        uint32_t bBitMask;
+        uint32_t aBitMask;
+    };
+
+    struct DdsHeader {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DdsPixelFormat pixelFormat;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(DdsHeader) == 124, "DDS header has to match the file layout");
+
+    struct DdsHeaderDx10 {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    static constexpr uint32_t DDS_MAGIC = 0x20534444;
+    static constexpr uint32_t DDPF_FOURCC = 0x4;
+    static constexpr uint32_t DDPF_RGB = 0x40;
+
+    static constexpr uint32_t makeFourCC(char a, char b, char c, char d) {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+    }
+
+    static std::vector<uint8_t> readFile(const std::string &filepath) {
+        std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        std::vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+        return buffer;
+    }
+
+    static bool hasExtension(const std::string &filepath, const std::string &extension) {
+        if (filepath.size() < extension.size()) {
+            return false;
+        }
+        return std::equal(extension.rbegin(), extension.rend(), filepath.rbegin(), [](char a, char b) {
+            return a == std::tolower(static_cast<unsigned char>(b));
+        });
+    }
+
+    static uint32_t fullMipLevels(uint32_t width, uint32_t height) {
+        return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+
+    // bytes per 4x4 block of the block compressed formats, zero for the rest
+    static uint32_t blockBytes(vk::Format format) {
+        switch (format) {
+            case vk::Format::eBc1RgbaUnormBlock:
+            case vk::Format::eBc1RgbaSrgbBlock:
+            case vk::Format::eBc4UnormBlock:
+            case vk::Format::eBc4SnormBlock:
+                return 8;
+            case vk::Format::eBc2UnormBlock:
+            case vk::Format::eBc2SrgbBlock:
+            case vk::Format::eBc3UnormBlock:
+            case vk::Format::eBc3SrgbBlock:
+            case vk::Format::eBc5UnormBlock:
+            case vk::Format::eBc5SnormBlock:
+            case vk::Format::eBc6HUfloatBlock:
+            case vk::Format::eBc6HSfloatBlock:
+            case vk::Format::eBc7UnormBlock:
+            case vk::Format::eBc7SrgbBlock:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    static vk::Format formatFromDxgi(uint32_t dxgiFormat) {
+        switch (dxgiFormat) {
+            case 28: return vk::Format::eR8G8B8A8Unorm;
+            case 29: return vk::Format::eR8G8B8A8Srgb;
+            case 71: return vk::Format::eBc1RgbaUnormBlock;
+            case 72: return vk::Format::eBc1RgbaSrgbBlock;
+            case 74: return vk::Format::eBc2UnormBlock;
+            case 75: return vk::Format::eBc2SrgbBlock;
+            case 77: return vk::Format::eBc3UnormBlock;
+            case 78: return vk::Format::eBc3SrgbBlock;
+            case 80: return vk::Format::eBc4UnormBlock;
+            case 81: return vk::Format::eBc4SnormBlock;
+            case 83: return vk::Format::eBc5UnormBlock;
+            case 84: return vk::Format::eBc5SnormBlock;
+            case 87: return vk::Format::eB8G8R8A8Unorm;
+            case 91: return vk::Format::eB8G8R8A8Srgb;
+            case 95: return vk::Format::eBc6HUfloatBlock;
+            case 96: return vk::Format::eBc6HSfloatBlock;
+            case 98: return vk::Format::eBc7UnormBlock;
+            case 99: return vk::Format::eBc7SrgbBlock;
+            default: return vk::Format::eUndefined;
+        }
+    }
+
+    void Texture::Builder::loadTexture(const std::string &filepath, bool srgb) {
+        format = vk::Format::eUndefined;
+        data.clear();
+        levelOffsets.clear();
+
+        if (hasExtension(filepath, ".ktx2")) {
+            loadKtx2(filepath);
+        } else if (hasExtension(filepath, ".dds")) {
+            loadDds(readFile(filepath), srgb);
+        } else {
+            loadImage(filepath, srgb);
+        }
+    }
+
+    void Texture::Builder::loadKtx2(const std::string &filepath) {
+        std::ifstream file{filepath, std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        Ktx2Index index = readKtx2Index(file, filepath);
+
+        format = index.format;
+        width = index.width;
+        height = index.height;
+        mipLevels = index.levelCount == 0 ? fullMipLevels(width, height) : index.levelCount;
+
+        std::vector<uint8_t> level;
+        for (const Ktx2Level &range : index.levels) {
+            level.resize(static_cast<size_t>(range.byteLength));
+            file.seekg(static_cast<std::streamoff>(range.byteOffset));
+            if (!file.read(reinterpret_cast<char *>(level.data()), level.size())) {
+                throw std::runtime_error("truncated KTX2 level data: " + filepath);
+            }
+            addLevel(level.data(), level.size());
+        }
+    }
+
+    void Texture::Builder::loadDds(const std::vector<uint8_t> &file, bool srgb) {
+        uint32_t magic = 0;
+        DdsHeader header;
+        if (file.size() < sizeof(magic) + sizeof(header)) {
+            throw std::runtime_error("invalid DDS file!");
+        }
+        std::memcpy(&magic, file.data(), sizeof(magic));
+        std::memcpy(&header, file.data() + sizeof(magic), sizeof(header));
+        if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader)) {
+            throw std::runtime_error("invalid DDS file!");
+        }
+
+        size_t offset = sizeof(magic) + sizeof(header);
+        const DdsPixelFormat &pixelFormat = header.pixelFormat;
+        if (pixelFormat.flags & DDPF_FOURCC) {
+            switch (pixelFormat.fourCC) {
+                case makeFourCC('D', 'X', 'T', '1'):
+                    format = srgb ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+                    break;
+                case makeFourCC('D', 'X', 'T', '3'):
+                    format = srgb ? vk::Format::eBc2SrgbBlock : vk::Format::eBc2UnormBlock;
+                    break;
+                case makeFourCC('D', 'X', 'T', '5'):
+                    format = srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+                    break;
+                case makeFourCC('A', 'T', 'I', '1'):
+                case makeFourCC('B', 'C', '4', 'U'):
+                    format = vk::Format::eBc4UnormBlock;
+                    break;
+                case makeFourCC('A', 'T', 'I', '2'):
+                case makeFourCC('B', 'C', '5', 'U'):
+                    format = vk::Format::eBc5UnormBlock;
+                    break;
+                case makeFourCC('D', 'X', '1', '0'): {
+                    DdsHeaderDx10 dx10;
+                    if (file.size() < offset + sizeof(dx10)) {
+                        throw std::runtime_error("truncated DDS header!");
+                    }
+                    std::memcpy(&dx10, file.data() + offset, sizeof(dx10));
+                    offset += sizeof(dx10);
+                    if (dx10.arraySize > 1) {
+                        throw std::runtime_error("DDS texture arrays are not supported!");
+                    }
+                    format = formatFromDxgi(dx10.dxgiFormat);
+                    break;
+                }
+                default:
+                    break;
+            }
+        } else if ((pixelFormat.flags & DDPF_RGB) && pixelFormat.rgbBitCount == 32) {
+            if (pixelFormat.rBitMask == 0x000000ff) {
+                format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+            } else if (pixelFormat.rBitMask == 0x00ff0000) {
+                format = srgb ? vk::Format::eB8G8R8A8Srgb : vk::Format::eB8G8R8A8Unorm;
+            }
+        }
+        if (format == vk::Format::eUndefined) {
+            throw std::runtime_error("unsupported DDS pixel format!");
+        }
+
+        width = header.width;
+        height = header.height;
+        if (width == 0 || height == 0) {
+            throw std::runtime_error("invalid DDS file!");
+        }
+        // the count comes from the file, levels past 1x1 would shift by 32 or more
+        mipLevels = std::clamp(header.mipMapCount, 1u, fullMipLevels(width, height));
+        uint32_t bytesPerBlock = blockBytes(format);
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            uint32_t levelWidth = std::max(width >> level, 1u);
+            uint32_t levelHeight = std::max(height >> level, 1u);
+            size_t size = bytesPerBlock > 0
+                ? static_cast<size_t>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * bytesPerBlock
+                : static_cast<size_t>(levelWidth) * levelHeight * 4;
+            if (offset + size > file.size()) {
+                throw std::runtime_error("truncated DDS level data!");
+            }
+            addLevel(file.data() + offset, size);
+            offset += size;
+        }
+    }
+
+    void Texture::Builder::loadImage(const std::string &filepath, bool srgb) {
+        int texWidth, texHeight, channels;
+        stbi_uc *pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("failed to load texture image: " + filepath);
+        }
+
+        format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+        width = static_cast<uint32_t>(texWidth);
+        height = static_cast<uint32_t>(texHeight);
+        mipLevels = fullMipLevels(width, height);
+        addLevel(pixels, static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+    }
+
+    void Texture::Builder::addLevel(const uint8_t *levelData, size_t size) {
+        // buffer offsets of copies have to be multiples of the texel block size and of 4
+        size_t offset = (data.size() + 15) & ~static_cast<size_t>(15);
+        data.resize(offset + size);
+        std::memcpy(data.data() + offset, levelData, size);
+        levelOffsets.push_back(offset);
+    }
+
+    Texture::Texture(Device &device, const Texture::Builder &builder)
+        : device{device}, format{builder.format}, width{builder.width}, height{builder.height}, mipLevels{builder.mipLevels} {
+        assert(!builder.levelOffsets.empty() && "Texture needs at least its base level");
+        createImage(builder);
+        setSampler(defaultSamplerInfo(device, mipLevels));
+    }
+
+    Texture::~Texture() {
+        // the sampler belongs to the cache
+        device.deferDestroy(image, imageView, imageMemory);
+    }
+
+    std::unique_ptr<Texture> Texture::createTextureFromFile(Device &device, const std::string &filepath, bool srgb) {
+        Builder builder{};
+        builder.loadTexture(filepath, srgb);
+        return std::make_unique<Texture>(device, builder);
+    }
+
+    void Texture::createImage(const Texture::Builder &builder) {
+        if (!device.supportsFormat(format, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eSampledImage)) {
+            throw std::runtime_error("texture format not supported by the device!");
+        }
+
+        uint32_t loadedLevels = static_cast<uint32_t>(builder.levelOffsets.size());
+        bool generateMips = loadedLevels < mipLevels;
+        if (generateMips && !device.supportsFormat(format, vk::ImageTiling::eOptimal,
+            vk::FormatFeatureFlagBits::eSampledImageFilterLinear | vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst)) {
+            // no filtered blits for this format, sample what the file had
+            mipLevels = loadedLevels;
+            generateMips = false;
+        }
+
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+        if (generateMips) {
+            usage |= vk::ImageUsageFlagBits::eTransferSrc;
+        }
+        vk::ImageCreateInfo imageInfo{{}, vk::ImageType::e2D, format, {width, height, 1}, mipLevels, 1, vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal, usage, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined};
+        device.createImageWithInfo(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, image, imageMemory);
+
+        vk::ImageViewCreateInfo viewInfo{{}, image, vk::ImageViewType::e2D, format, {}, {{vk::ImageAspectFlagBits::eColor}, 0, mipLevels, 0, 1}};
+        if (device.device().createImageView(&viewInfo, nullptr, &imageView) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+
+        auto stagingBuffer = std::make_unique<Buffer>(device, builder.data.size(), 1, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        stagingBuffer->map();
+        stagingBuffer->writeToBuffer((void *)builder.data.data());
+
+        if (generateMips) {
+            device.uploadQueue().uploadImageGenerateMips(std::move(stagingBuffer), image, width, height, mipLevels, 1,
+                vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+            return;
+        }
+
+        std::vector<vk::BufferImageCopy> regions;
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            regions.push_back({builder.levelOffsets[level], 0, 0, {vk::ImageAspectFlagBits::eColor, level, 0, 1}, {0, 0, 0},
+                {std::max(width >> level, 1u), std::max(height >> level, 1u), 1}});
+        }
+        device.uploadQueue().uploadImageMips(std::move(stagingBuffer), image, std::move(regions), mipLevels, 1,
+            vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+    }
+
+    vk::SamplerCreateInfo Texture::defaultSamplerInfo(Device &device, uint32_t mipLevels) {
+        vk::SamplerCreateInfo samplerInfo{};
+        samplerInfo.setMagFilter(vk::Filter::eLinear);
+        samplerInfo.setMinFilter(vk::Filter::eLinear);
+        samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eLinear);
+        samplerInfo.setAddressModeU(vk::SamplerAddressMode::eRepeat);
+        samplerInfo.setAddressModeV(vk::SamplerAddressMode::eRepeat);
+        samplerInfo.setAddressModeW(vk::SamplerAddressMode::eRepeat);
+        samplerInfo.setAnisotropyEnable(true);
+        samplerInfo.setMaxAnisotropy(std::min(16.f, device.properties.limits.maxSamplerAnisotropy));
+        samplerInfo.setCompareOp(vk::CompareOp::eAlways);
+        samplerInfo.setMaxLod(static_cast<float>(mipLevels));
+        samplerInfo.setBorderColor(vk::BorderColor::eIntOpaqueBlack);
+        return samplerInfo;
+    }
+
+    void Texture::setSampler(const vk::SamplerCreateInfo &samplerInfo) {
+        sampler = device.samplerCache().get(samplerInfo);
+    }
+}
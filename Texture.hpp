@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Device.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Engine {
+
+    // Sampled 2D texture in device local memory. KTX2 and DDS files bring their own mip chain, other images are
+    // decoded to RGBA8 and their mips are blitted on the gpu. Pixels go through the upload queue, the first frame
+    // sampling the texture waits for them.
+    class Texture {
+        public:
+        struct Builder {
+            vk::Format format = vk::Format::eUndefined;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t mipLevels = 1;
+            // the levels in data, largest first. Levels past the last one are generated.
+            std::vector<uint8_t> data{};
+            std::vector<vk::DeviceSize> levelOffsets{};
+
+            // srgb picks the color space of formats that do not carry one, e.g. png or DXT1
+            void loadTexture(const std::string &filepath, bool srgb);
+
+            private:
+            void loadKtx2(const std::string &filepath);
+            void loadDds(const std::vector<uint8_t> &file, bool srgb);
+            void loadImage(const std::string &filepath, bool srgb);
+            void addLevel(const uint8_t *levelData, size_t size);
+        };
+
+        Texture(Device &device, const Texture::Builder &builder);
+        ~Texture();
+
+        Texture(const Texture &) = delete;
+        Texture &operator=(const Texture &) = delete;
+
+        static std::unique_ptr<Texture> createTextureFromFile(Device &device, const std::string &filepath, bool srgb = true);
+
+        // Trilinear, repeating and anisotropic over every mip level
+        static vk::SamplerCreateInfo defaultSamplerInfo(Device &device, uint32_t mipLevels);
+        // Samplers come from the device's SamplerCache, textures sharing a create info share the sampler
+        void setSampler(const vk::SamplerCreateInfo &samplerInfo);
+
+        // For combined image sampler bindings and BindlessDescriptors::addSampledImage
+        vk::DescriptorImageInfo descriptorInfo() const { return {sampler, imageView, vk::ImageLayout::eShaderReadOnlyOptimal}; }
+
+        vk::Format getFormat() const { return format; }
+        uint32_t getWidth() const { return width; }
+        uint32_t getHeight() const { return height; }
+        uint32_t getMipLevels() const { return mipLevels; }
+
+        private:
+        void createImage(const Texture::Builder &builder);
+
+        Device &device;
+        vk::Format format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+
+        vk::Image image;
+        vk::DeviceMemory imageMemory;
+        vk::ImageView imageView;
+        vk::Sampler sampler;
+    };
+}
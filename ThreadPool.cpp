@@ -0,0 +1,93 @@
+#include "ThreadPool.hpp"
+
+#include "CpuProfiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <string>
+
+namespace Engine {
+
+    ThreadPool::ThreadPool(uint32_t threadCount) {
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        startCondition.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t ThreadPool::defaultThreadCount() {
+        return std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    }
+
+    void ThreadPool::run(uint32_t threadCount, const std::function<void(uint32_t)> &task) {
+        assert(threadCount <= size() && "Not enough worker threads");
+        if (threadCount == 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock{mutex};
+        currentTask = &task;
+        activeCount = threadCount;
+        pending = threadCount;
+        generation++;
+        startCondition.notify_all();
+
+        doneCondition.wait(lock, [this] { return pending == 0; });
+        currentTask = nullptr;
+
+        if (firstException) {
+            std::exception_ptr exception = firstException;
+            firstException = nullptr;
+            std::rethrow_exception(exception);
+        }
+    }
+
+    void ThreadPool::workerLoop(uint32_t threadIndex) {
+        CpuProfiler::setThreadName("Worker " + std::to_string(threadIndex));
+        uint64_t seenGeneration = 0;
+        while (true) {
+            const std::function<void(uint32_t)> *task;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                startCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                if (threadIndex >= activeCount) {
+                    continue;
+                }
+                task = currentTask;
+            }
+
+            // an exception escaping the thread would terminate, it is handed to run() instead
+            std::exception_ptr exception;
+            try {
+                (*task)(threadIndex);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            if (exception && !firstException) {
+                firstException = exception;
+            }
+            if (--pending == 0) {
+                doneCondition.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine {
+
+    // Fixed set of worker threads. Each worker keeps its index for its whole lifetime, so callers
+    // can keep per-thread state (e.g. command pools) indexed by it.
+    class ThreadPool {
+        public:
+        explicit ThreadPool(uint32_t threadCount = defaultThreadCount());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+
+        // Runs task(threadIndex) on the first threadCount workers and blocks until all of them returned.
+        // If tasks throw, the first exception is rethrown here once every worker is done.
+        void run(uint32_t threadCount, const std::function<void(uint32_t)> &task);
+
+        static uint32_t defaultThreadCount();
+
+        private:
+        void workerLoop(uint32_t threadIndex);
+
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable startCondition;
+        std::condition_variable doneCondition;
+        const std::function<void(uint32_t)> *currentTask = nullptr;
+        uint64_t generation = 0;
+        uint32_t activeCount = 0;
+        uint32_t pending = 0;
+        std::exception_ptr firstException;
+        bool stopping = false;
+    };
+}
@@ -0,0 +1,39 @@
+#include "UniformRingBuffer.hpp"
+
+// std
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+namespace Engine {
+
+    UniformRingBuffer::UniformRingBuffer(Device &device, vk::DeviceSize frameSize, uint32_t frameCount)
+        : alignment{device.properties.limits.minUniformBufferOffsetAlignment} {
+        buffer = std::make_unique<Buffer>(
+            device,
+            frameSize,
+            frameCount,
+            vk::BufferUsageFlagBits::eUniformBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            alignment);
+        assert(buffer->getBufferSize() <= std::numeric_limits<uint32_t>::max() && "Dynamic offsets are limited to 32 bits");
+        buffer->map();
+    }
+
+    UniformRingBuffer::~UniformRingBuffer() {}
+
+    void UniformRingBuffer::beginFrame(int frameIndex) {
+        assert(static_cast<uint32_t>(frameIndex) < buffer->getInstanceCount() && "Frame index out of range");
+        frameBegin = frameIndex * buffer->getAlignmentSize();
+        head = frameBegin;
+    }
+
+    UniformRingBuffer::Allocation UniformRingBuffer::allocate(vk::DeviceSize size) {
+        vk::DeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+        if (offset + size > frameBegin + buffer->getAlignmentSize()) {
+            throw std::runtime_error("uniform ring buffer frame segment exhausted!");
+        }
+        head = offset + size;
+        return {static_cast<char *>(buffer->getMappedMemory()) + offset, static_cast<uint32_t>(offset)};
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+
+// std
+#include <cstring>
+#include <memory>
+
+namespace Engine {
+
+    // Persistently mapped linear allocator for per-frame uniform data. Every frame in flight owns one
+    // segment of the buffer, allocations bump a head pointer and are bound with dynamic offsets.
+    class UniformRingBuffer {
+        public:
+        struct Allocation {
+            void *data;
+            uint32_t offset;
+        };
+
+        UniformRingBuffer(Device &device, vk::DeviceSize frameSize, uint32_t frameCount);
+        ~UniformRingBuffer();
+
+        UniformRingBuffer(const UniformRingBuffer &) = delete;
+        UniformRingBuffer &operator=(const UniformRingBuffer &) = delete;
+
+        // Rewinds the frame's segment, only call once the slot's last frame has completed
+        void beginFrame(int frameIndex);
+        Allocation allocate(vk::DeviceSize size);
+
+        template <typename T>
+        uint32_t push(const T &data) {
+            Allocation allocation = allocate(sizeof(T));
+            memcpy(allocation.data, &data, sizeof(T));
+            return allocation.offset;
+        }
+
+        vk::DescriptorBufferInfo descriptorInfo(vk::DeviceSize range) { return buffer->descriptorInfo(range, 0); }
+        vk::DeviceSize getFrameSize() const { return buffer->getAlignmentSize(); }
+
+        private:
+        std::unique_ptr<Buffer> buffer;
+        vk::DeviceSize alignment;
+
+        vk::DeviceSize frameBegin = 0;
+        vk::DeviceSize head = 0;
+    };
+}
@@ -0,0 +1,306 @@
+#include "UploadQueue.hpp"
+
+#include "Device.hpp"
+
+// std
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace Engine {
+
+    UploadQueue::UploadQueue(Device &device) : device{device} {
+        QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
+        dedicated = indices.transferFamilyHasValue;
+        graphicsFamily = indices.graphicsFamily;
+        transferFamily = dedicated ? indices.transferFamily : indices.graphicsFamily;
+        if (!dedicated) {
+            return;
+        }
+
+        vk::CommandPoolCreateInfo poolInfo{vk::CommandPoolCreateFlagBits::eTransient, transferFamily};
+        if (device.device().createCommandPool(&poolInfo, nullptr, &commandPool) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create upload command pool!");
+        }
+
+        vk::SemaphoreTypeCreateInfo typeInfo{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.setPNext(&typeInfo);
+        if (device.device().createSemaphore(&semaphoreInfo, nullptr, &timeline_) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create upload timeline semaphore!");
+        }
+    }
+
+    UploadQueue::~UploadQueue() {
+        // the device is idle, command buffers are freed with their pool and staging buffers defer themselves
+        pending.clear();
+        inFlight.clear();
+        if (commandPool) {
+            device.device().destroyCommandPool(commandPool, nullptr);
+        }
+        if (timeline_) {
+            device.device().destroySemaphore(timeline_, nullptr);
+        }
+    }
+
+    void UploadQueue::uploadBuffer(
+        std::unique_ptr<Buffer> staging,
+        vk::Buffer dst,
+        vk::DeviceSize size,
+        vk::PipelineStageFlags dstStage,
+        vk::AccessFlags dstAccess) {
+        Upload upload{};
+        upload.staging = std::move(staging);
+        upload.buffer = dst;
+        upload.size = size;
+        upload.dstStage = dstStage;
+        upload.dstAccess = dstAccess;
+        submit(std::move(upload));
+    }
+
+    void UploadQueue::uploadImage(
+        std::unique_ptr<Buffer> staging,
+        vk::Image dst,
+        uint32_t width,
+        uint32_t height,
+        uint32_t layerCount,
+        vk::ImageLayout finalLayout,
+        vk::PipelineStageFlags dstStage,
+        vk::AccessFlags dstAccess) {
+        vk::BufferImageCopy region{0, 0, 0, {vk::ImageAspectFlagBits::eColor, 0, 0, layerCount}, {0, 0, 0}, {width, height, 1}};
+        uploadImageMips(std::move(staging), dst, {region}, 1, layerCount, finalLayout, dstStage, dstAccess);
+    }
+
+    void UploadQueue::uploadImageMips(
+        std::unique_ptr<Buffer> staging,
+        vk::Image dst,
+        std::vector<vk::BufferImageCopy> regions,
+        uint32_t mipLevels,
+        uint32_t layerCount,
+        vk::ImageLayout finalLayout,
+        vk::PipelineStageFlags dstStage,
+        vk::AccessFlags dstAccess) {
+        Upload upload{};
+        upload.staging = std::move(staging);
+        upload.image = dst;
+        upload.width = regions.front().imageExtent.width;
+        upload.height = regions.front().imageExtent.height;
+        upload.layerCount = layerCount;
+        upload.mipLevels = mipLevels;
+        upload.regions = std::move(regions);
+        upload.finalLayout = finalLayout;
+        upload.dstStage = dstStage;
+        upload.dstAccess = dstAccess;
+        submit(std::move(upload));
+    }
+
+    void UploadQueue::uploadImageGenerateMips(
+        std::unique_ptr<Buffer> staging,
+        vk::Image dst,
+        uint32_t width,
+        uint32_t height,
+        uint32_t mipLevels,
+        uint32_t layerCount,
+        vk::ImageLayout finalLayout,
+        vk::PipelineStageFlags dstStage,
+        vk::AccessFlags dstAccess) {
+        Upload upload{};
+        upload.staging = std::move(staging);
+        upload.image = dst;
+        upload.width = width;
+        upload.height = height;
+        upload.layerCount = layerCount;
+        upload.mipLevels = mipLevels;
+        upload.regions = {{0, 0, 0, {vk::ImageAspectFlagBits::eColor, 0, 0, layerCount}, {0, 0, 0}, {width, height, 1}}};
+        upload.generateMips = mipLevels > 1;
+        upload.finalLayout = finalLayout;
+        upload.dstStage = dstStage;
+        upload.dstAccess = dstAccess;
+        submit(std::move(upload));
+    }
+
+    void UploadQueue::submit(Upload &&upload) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!dedicated) {
+            // recorded into the next frame's command buffer
+            pending.push_back(std::move(upload));
+            return;
+        }
+
+        collectCompleted();
+
+        vk::CommandBufferAllocateInfo allocInfo{commandPool, vk::CommandBufferLevel::ePrimary, 1};
+        if (device.device().allocateCommandBuffers(&allocInfo, &upload.commandBuffer) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        vk::CommandBufferBeginInfo beginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+        upload.commandBuffer.begin(&beginInfo);
+        recordCopy(upload.commandBuffer, upload);
+        recordOwnershipBarrier(upload.commandBuffer, upload, true);
+        upload.commandBuffer.end();
+
+        upload.value = ++lastSubmittedValue;
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{0, nullptr, 1, &upload.value};
+        vk::SubmitInfo submitInfo{0, nullptr, nullptr, 1, &upload.commandBuffer, 1, &timeline_};
+        submitInfo.setPNext(&timelineInfo);
+        if (device.transferQueue().submit(1, &submitInfo, nullptr) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        pending.push_back(std::move(upload));
+    }
+
+    void UploadQueue::recordPendingUploads(vk::CommandBuffer commandBuffer) {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (dedicated) {
+            collectCompleted();
+        }
+        if (pending.empty()) {
+            return;
+        }
+
+        for (auto &upload : pending) {
+            if (dedicated) {
+                recordOwnershipBarrier(commandBuffer, upload, false);
+                frameWaitValue = std::max(frameWaitValue, upload.value);
+                frameWaitStages |= upload.generateMips ? vk::PipelineStageFlagBits::eTransfer : upload.dstStage;
+                if (upload.generateMips) {
+                    recordMipGeneration(commandBuffer, upload);
+                }
+            } else {
+                recordCopy(commandBuffer, upload);
+            }
+        }
+
+        if (dedicated) {
+            // the transfer may still be reading from the staging buffers
+            std::move(pending.begin(), pending.end(), std::back_inserter(inFlight));
+        }
+        // without a transfer queue the staging buffers are released once this frame completes
+        pending.clear();
+    }
+
+    uint64_t UploadQueue::takeFrameWaitValue(vk::PipelineStageFlags &waitStages) {
+        std::lock_guard<std::mutex> lock{mutex};
+        uint64_t value = frameWaitValue;
+        waitStages = frameWaitStages;
+        frameWaitValue = 0;
+        frameWaitStages = {};
+        return value;
+    }
+
+    void UploadQueue::collectCompleted() {
+        if (inFlight.empty()) {
+            return;
+        }
+
+        uint64_t completed = device.device().getSemaphoreCounterValue(timeline_);
+        auto done = std::partition(inFlight.begin(), inFlight.end(), [&](const Upload &upload) { return upload.value > completed; });
+        for (auto it = done; it != inFlight.end(); it++) {
+            device.device().freeCommandBuffers(commandPool, 1, &it->commandBuffer);
+        }
+        inFlight.erase(done, inFlight.end());
+    }
+
+    void UploadQueue::recordCopy(vk::CommandBuffer commandBuffer, const Upload &upload) {
+        if (upload.buffer) {
+            vk::BufferCopy copyRegion{0, 0, upload.size};
+            commandBuffer.copyBuffer(upload.staging->getBuffer(), upload.buffer, 1, &copyRegion);
+
+            if (!dedicated) {
+                vk::BufferMemoryBarrier barrier{
+                    vk::AccessFlagBits::eTransferWrite, upload.dstAccess,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, upload.buffer, 0, upload.size};
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, upload.dstStage, {}, 0, nullptr, 1, &barrier, 0, nullptr);
+            }
+            return;
+        }
+
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, upload.mipLevels, 0, upload.layerCount};
+        vk::ImageMemoryBarrier toTransfer{
+            {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, upload.image, range};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+        commandBuffer.copyBufferToImage(
+            upload.staging->getBuffer(), upload.image, vk::ImageLayout::eTransferDstOptimal,
+            static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+
+        if (!dedicated && upload.generateMips) {
+            recordMipGeneration(commandBuffer, upload);
+        } else if (!dedicated) {
+            vk::ImageMemoryBarrier toFinal{
+                vk::AccessFlagBits::eTransferWrite, upload.dstAccess, vk::ImageLayout::eTransferDstOptimal, upload.finalLayout,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, upload.image, range};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, upload.dstStage, {}, 0, nullptr, 0, nullptr, 1, &toFinal);
+        }
+    }
+
+    void UploadQueue::recordOwnershipBarrier(vk::CommandBuffer commandBuffer, const Upload &upload, bool release) {
+        // the release half makes the copy available, the acquire half makes it visible to the first use. Access
+        // masks of the other half are ignored, the timeline wait orders the two.
+        vk::AccessFlags srcAccess = release ? vk::AccessFlags{vk::AccessFlagBits::eTransferWrite} : vk::AccessFlags{};
+        vk::AccessFlags dstAccess = release ? vk::AccessFlags{} : upload.dstAccess;
+        vk::PipelineStageFlags srcStage = release ? vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTransfer} : upload.dstStage;
+        vk::PipelineStageFlags dstStage = release ? vk::PipelineStageFlags{vk::PipelineStageFlagBits::eBottomOfPipe} : upload.dstStage;
+
+        if (upload.buffer) {
+            vk::BufferMemoryBarrier barrier{srcAccess, dstAccess, transferFamily, graphicsFamily, upload.buffer, 0, upload.size};
+            commandBuffer.pipelineBarrier(srcStage, dstStage, {}, 0, nullptr, 1, &barrier, 0, nullptr);
+            return;
+        }
+
+        // mips are generated after the acquire, the levels stay in transfer layout until then
+        if (upload.generateMips) {
+            dstAccess = release ? vk::AccessFlags{} : vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+            if (!release) {
+                srcStage = dstStage = vk::PipelineStageFlagBits::eTransfer;
+            }
+        }
+        vk::ImageLayout newLayout = upload.generateMips ? vk::ImageLayout::eTransferDstOptimal : upload.finalLayout;
+        vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, upload.mipLevels, 0, upload.layerCount};
+        vk::ImageMemoryBarrier barrier{
+            srcAccess, dstAccess, vk::ImageLayout::eTransferDstOptimal, newLayout,
+            transferFamily, graphicsFamily, upload.image, range};
+        commandBuffer.pipelineBarrier(srcStage, dstStage, {}, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void UploadQueue::recordMipGeneration(vk::CommandBuffer commandBuffer, const Upload &upload) {
+        int32_t mipWidth = static_cast<int32_t>(upload.width);
+        int32_t mipHeight = static_cast<int32_t>(upload.height);
+        for (uint32_t level = 1; level <= upload.mipLevels; level++) {
+            // the previous level is complete, read it for the blit unless it is the last one
+            vk::ImageSubresourceRange source{vk::ImageAspectFlagBits::eColor, level - 1, 1, 0, upload.layerCount};
+            if (level == upload.mipLevels) {
+                vk::ImageMemoryBarrier toFinal{
+                    vk::AccessFlagBits::eTransferWrite, upload.dstAccess, vk::ImageLayout::eTransferDstOptimal, upload.finalLayout,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, upload.image, source};
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, upload.dstStage, {}, 0, nullptr, 0, nullptr, 1, &toFinal);
+                break;
+            }
+
+            vk::ImageMemoryBarrier toSource{
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, upload.image, source};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &toSource);
+
+            int32_t nextWidth = std::max(mipWidth / 2, 1);
+            int32_t nextHeight = std::max(mipHeight / 2, 1);
+            vk::ImageBlit blit{
+                {vk::ImageAspectFlagBits::eColor, level - 1, 0, upload.layerCount}, {{{0, 0, 0}, {mipWidth, mipHeight, 1}}},
+                {vk::ImageAspectFlagBits::eColor, level, 0, upload.layerCount}, {{{0, 0, 0}, {nextWidth, nextHeight, 1}}}};
+            commandBuffer.blitImage(
+                upload.image, vk::ImageLayout::eTransferSrcOptimal, upload.image, vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eLinear);
+
+            vk::ImageMemoryBarrier toFinal{
+                vk::AccessFlagBits::eTransferRead, upload.dstAccess, vk::ImageLayout::eTransferSrcOptimal, upload.finalLayout,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, upload.image, source};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, upload.dstStage, {}, 0, nullptr, 0, nullptr, 1, &toFinal);
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+    }
+}
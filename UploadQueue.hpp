@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Buffer.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Engine {
+
+    class Device;
+
+    // Streams staging buffers into device local buffers and images. With a transfer-only queue family the copies run
+    // on that queue and overlap rendering, each submission signals the upload timeline and releases ownership to
+    // the graphics family. The next frame records the matching acquire barriers and waits on the timeline in its
+    // submit. Without such a family the copies are recorded at the start of the next frame on the graphics queue.
+    // Uploads may be issued from any thread, recording belongs to the render thread.
+    class UploadQueue {
+        public:
+        UploadQueue(Device &device);
+        ~UploadQueue();
+
+        UploadQueue(const UploadQueue &) = delete;
+        UploadQueue &operator=(const UploadQueue &) = delete;
+
+        // dstStage and dstAccess describe the first use of the destination on the graphics queue. The destination
+        // has to outlive the next frame, which is where the copy or acquire is recorded.
+        void uploadBuffer(
+            std::unique_ptr<Buffer> staging,
+            vk::Buffer dst,
+            vk::DeviceSize size,
+            vk::PipelineStageFlags dstStage,
+            vk::AccessFlags dstAccess);
+        // Copies into mip 0 of every layer and leaves the image in finalLayout
+        void uploadImage(
+            std::unique_ptr<Buffer> staging,
+            vk::Image dst,
+            uint32_t width,
+            uint32_t height,
+            uint32_t layerCount,
+            vk::ImageLayout finalLayout,
+            vk::PipelineStageFlags dstStage,
+            vk::AccessFlags dstAccess);
+        // Copies every region, e.g. pre-built mip levels, and leaves all mipLevels levels in finalLayout
+        void uploadImageMips(
+            std::unique_ptr<Buffer> staging,
+            vk::Image dst,
+            std::vector<vk::BufferImageCopy> regions,
+            uint32_t mipLevels,
+            uint32_t layerCount,
+            vk::ImageLayout finalLayout,
+            vk::PipelineStageFlags dstStage,
+            vk::AccessFlags dstAccess);
+        // Copies into mip 0 and fills the other levels by blitting each one from the level above. Blits need the
+        // graphics queue, with a transfer queue they are recorded into the next frame after the acquire. The format
+        // has to support linear filtered blits.
+        void uploadImageGenerateMips(
+            std::unique_ptr<Buffer> staging,
+            vk::Image dst,
+            uint32_t width,
+            uint32_t height,
+            uint32_t mipLevels,
+            uint32_t layerCount,
+            vk::ImageLayout finalLayout,
+            vk::PipelineStageFlags dstStage,
+            vk::AccessFlags dstAccess);
+
+        // Records acquire barriers, or the copies themselves without a transfer queue, for every upload issued since
+        // the last call. Has to run before the frame's first use of the uploaded resources.
+        void recordPendingUploads(vk::CommandBuffer commandBuffer);
+        // Timeline value and stages the frame recorded last has to wait for, zero when nothing has to be waited on
+        uint64_t takeFrameWaitValue(vk::PipelineStageFlags &waitStages);
+
+        bool hasDedicatedQueue() const { return dedicated; }
+        vk::Semaphore timeline() const { return timeline_; }
+
+        private:
+        struct Upload {
+            std::unique_ptr<Buffer> staging;
+            vk::Buffer buffer;
+            vk::DeviceSize size = 0;
+            vk::Image image;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t layerCount = 0;
+            uint32_t mipLevels = 1;
+            std::vector<vk::BufferImageCopy> regions;
+            // levels past mip 0 are blitted on the graphics queue instead of copied
+            bool generateMips = false;
+            vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+            vk::PipelineStageFlags dstStage;
+            vk::AccessFlags dstAccess;
+            // transfer submission, dedicated queue only
+            vk::CommandBuffer commandBuffer;
+            uint64_t value = 0;
+        };
+
+        void submit(Upload &&upload);
+        void recordCopy(vk::CommandBuffer commandBuffer, const Upload &upload);
+        void recordOwnershipBarrier(vk::CommandBuffer commandBuffer, const Upload &upload, bool release);
+        // expects every level in transfer dst layout, leaves them in finalLayout
+        void recordMipGeneration(vk::CommandBuffer commandBuffer, const Upload &upload);
+        // frees command buffers and staging memory of completed transfers, caller holds the mutex
+        void collectCompleted();
+
+        Device &device;
+        bool dedicated;
+        uint32_t transferFamily;
+        uint32_t graphicsFamily;
+
+        vk::CommandPool commandPool;
+        vk::Semaphore timeline_;
+        uint64_t lastSubmittedValue = 0;
+
+        std::mutex mutex;
+        // submitted or queued uploads the render thread has not recorded yet
+        std::vector<Upload> pending;
+        // acquired uploads whose transfer may still be running
+        std::vector<Upload> inFlight;
+
+        uint64_t frameWaitValue = 0;
+        vk::PipelineStageFlags frameWaitStages{};
+    };
+}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdio>
 #include <functional>
+#include <ostream>
+#include <string>
 
 namespace Engine {
     template <typename T, typename... Rest>
@@ -9,4 +12,19 @@ namespace Engine {
         (hashCombine(seed, rest), ...);
     };
 
+    // Writes text as the contents of a JSON string, without the surrounding quotes
+    inline void writeJsonEscaped(std::ostream& stream, const std::string& text) {
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                stream << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                stream << escaped;
+            } else {
+                stream << c;
+            }
+        }
+    }
+
 }
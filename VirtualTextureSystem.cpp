@@ -0,0 +1,510 @@
+#include "VirtualTextureSystem.hpp"
+
+#include "GpuProfiler.hpp"
+#include "Ktx2.hpp"
+#include "SamplerCache.hpp"
+#include "SwapChain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Engine {
+
+    // page keys, also what the shaders write into the feedback buffer
+    //   texture (10) | mip (4) | page x (9) | page y (9)
+    static constexpr uint32_t MAX_PAGES_PER_SIDE = 1 << 9;
+    static constexpr uint32_t MAX_MIPS = 1 << 4;
+    static constexpr uint32_t EMPTY_FEEDBACK = ~0u;
+    // page table entries, a zero entry has nothing resident
+    //   valid (1) | unused (11) | mip (4) | slot y (8) | slot x (8)
+    static constexpr uint32_t ENTRY_VALID = 1u << 31;
+
+    static constexpr uint32_t PAGE_BYTES = VirtualTextureSystem::PAGE_SIZE * VirtualTextureSystem::PAGE_SIZE * 4;
+    // per frame upload budget, the rest waits for the next frame
+    static constexpr uint32_t UPLOADS_PER_FRAME = 32;
+    static constexpr uint32_t TABLE_UPLOAD_ENTRIES = 64 * 1024;
+    // bounds the cpu memory held by requested and loaded pages, dropped requests come back through the feedback
+    static constexpr uint32_t MAX_PENDING_LOADS = 256;
+
+    // std430 layouts shared with VirtualTexture.glsl
+    struct VirtualTextureInfo {
+        uint32_t tableOffset;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+    };
+
+    struct FeedbackHeader {
+        uint32_t width;
+        uint32_t height;
+        // the one pixel of each FEEDBACK_SCALE^2 block that writes this frame
+        uint32_t jitter;
+        uint32_t padding;
+    };
+
+    static uint32_t packKey(uint32_t texture, uint32_t mip, uint32_t x, uint32_t y) {
+        return (texture << 22) | (mip << 18) | (x << 9) | y;
+    }
+
+    static void unpackKey(uint32_t key, uint32_t &texture, uint32_t &mip, uint32_t &x, uint32_t &y) {
+        texture = key >> 22;
+        mip = (key >> 18) & (MAX_MIPS - 1);
+        x = (key >> 9) & (MAX_PAGES_PER_SIDE - 1);
+        y = key & (MAX_PAGES_PER_SIDE - 1);
+    }
+
+    VirtualTextureSystem::VirtualTextureSystem(Device &device, uint32_t cacheSizeInPages, vk::Extent2D maxExtent, uint32_t maxTableEntries)
+        : device{device}, cacheSizeInPages{cacheSizeInPages}, maxTableEntries{maxTableEntries} {
+        assert(cacheSizeInPages > 0 && cacheSizeInPages <= 256 && "Cache slots are addressed with 8 bits per axis");
+        if (!device.supportsFragmentStores()) {
+            throw std::runtime_error("virtual texturing needs fragmentStoresAndAtomics for its feedback!");
+        }
+        createCache();
+        createBuffers(maxExtent);
+
+        uint32_t slotCount = cacheSizeInPages * cacheSizeInPages;
+        slots.resize(slotCount);
+        for (uint32_t i = slotCount; i > 0; i--) {
+            freeSlots.push_back(i - 1);
+        }
+        loader = std::thread{[this]() { loaderLoop(); }};
+    }
+
+    VirtualTextureSystem::~VirtualTextureSystem() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        loaderCondition.notify_all();
+        loader.join();
+
+        // the sampler belongs to the cache
+        device.deferDestroy(cacheImage, cacheView, cacheMemory);
+    }
+
+    void VirtualTextureSystem::createCache() {
+        vk::Format format = vk::Format::eR8G8B8A8Srgb;
+        uint32_t size = cacheSizeInPages * PAGE_SIZE;
+        vk::ImageCreateInfo imageInfo{{}, vk::ImageType::e2D, format, {size, size, 1}, 1, 1, vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined};
+        device.createImageWithInfo(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal, cacheImage, cacheMemory);
+
+        vk::ImageViewCreateInfo viewInfo{{}, cacheImage, vk::ImageViewType::e2D, format, {}, {{vk::ImageAspectFlagBits::eColor}, 0, 1, 0, 1}};
+        if (device.device().createImageView(&viewInfo, nullptr, &cacheView) != vk::Result::eSuccess) {
+            throw std::runtime_error("failed to create virtual texture cache view!");
+        }
+
+        // the borders keep bilinear taps inside the slot, mips are picked by the shader
+        vk::SamplerCreateInfo samplerInfo{};
+        samplerInfo.setMagFilter(vk::Filter::eLinear);
+        samplerInfo.setMinFilter(vk::Filter::eLinear);
+        samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eNearest);
+        samplerInfo.setAddressModeU(vk::SamplerAddressMode::eClampToEdge);
+        samplerInfo.setAddressModeV(vk::SamplerAddressMode::eClampToEdge);
+        samplerInfo.setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+        samplerInfo.setBorderColor(vk::BorderColor::eIntOpaqueBlack);
+        cacheSampler = device.samplerCache().get(samplerInfo);
+    }
+
+    void VirtualTextureSystem::createBuffers(vk::Extent2D maxExtent) {
+        pageTable = std::make_unique<Buffer>(device, sizeof(VirtualTextureInfo) * MAX_VIRTUAL_TEXTURES + sizeof(uint32_t) * maxTableEntries, 1,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        // read back by the cpu, one region per frame in flight
+        uint32_t feedbackWidth = (maxExtent.width + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        uint32_t feedbackHeight = (maxExtent.height + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        feedbackCapacity = feedbackWidth * feedbackHeight;
+        feedbackBuffer = std::make_unique<Buffer>(device, sizeof(FeedbackHeader) + sizeof(uint32_t) * feedbackCapacity,
+            SwapChain::MAX_FRAMES_IN_FLIGHT, vk::BufferUsageFlagBits::eStorageBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            device.properties.limits.minStorageBufferOffsetAlignment);
+        feedbackBuffer->map();
+        for (uint32_t i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+            // an empty grid, nothing is written until beginFrame sizes it
+            char *region = static_cast<char *>(feedbackBuffer->getMappedMemory()) + i * feedbackBuffer->getAlignmentSize();
+            std::memset(region, 0, sizeof(FeedbackHeader));
+        }
+
+        stagingBuffer = std::make_unique<Buffer>(device,
+            PAGE_BYTES * UPLOADS_PER_FRAME + sizeof(VirtualTextureInfo) * MAX_VIRTUAL_TEXTURES + sizeof(uint32_t) * TABLE_UPLOAD_ENTRIES,
+            SwapChain::MAX_FRAMES_IN_FLIGHT, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, 16);
+        stagingBuffer->map();
+    }
+
+    uint32_t VirtualTextureSystem::registerTexture(const std::string &filepath) {
+        std::ifstream file{filepath, std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        Ktx2Index index = readKtx2Index(file, filepath);
+        if (index.format != vk::Format::eR8G8B8A8Srgb || index.levelCount == 0) {
+            throw std::runtime_error("virtual textures have to be uncompressed RGBA8 sRGB KTX2 files with mips: " + filepath);
+        }
+        if (textures.size() >= MAX_VIRTUAL_TEXTURES) {
+            throw std::runtime_error("too many virtual textures!");
+        }
+
+        VirtualTexture texture{};
+        texture.filepath = filepath;
+        texture.width = index.width;
+        texture.height = index.height;
+        texture.mipCount = 0;
+        uint32_t pageCount = 0;
+        for (uint32_t mip = 0; mip < std::min(index.levelCount, MAX_MIPS); mip++) {
+            uint32_t levelWidth = std::max(texture.width >> mip, 1u);
+            uint32_t levelHeight = std::max(texture.height >> mip, 1u);
+            if (index.levels[mip].byteLength < static_cast<uint64_t>(levelWidth) * levelHeight * 4) {
+                throw std::runtime_error("truncated KTX2 level data: " + filepath);
+            }
+            texture.levelOffsets.push_back(index.levels[mip].byteOffset);
+            texture.pagesX.push_back((levelWidth + PAGE_PAYLOAD - 1) / PAGE_PAYLOAD);
+            texture.pagesY.push_back((levelHeight + PAGE_PAYLOAD - 1) / PAGE_PAYLOAD);
+            texture.mipOffsets.push_back(pageCount);
+            pageCount += texture.pagesX.back() * texture.pagesY.back();
+            texture.mipCount++;
+            if (texture.pagesX.back() == 1 && texture.pagesY.back() == 1) {
+                break;
+            }
+        }
+        uint32_t coarsest = texture.mipCount - 1;
+        if (texture.pagesX[coarsest] != 1 || texture.pagesY[coarsest] != 1) {
+            throw std::runtime_error("virtual texture mips have to reach a single page: " + filepath);
+        }
+        if (texture.pagesX[0] > MAX_PAGES_PER_SIDE || texture.pagesY[0] > MAX_PAGES_PER_SIDE) {
+            throw std::runtime_error("virtual texture is too large: " + filepath);
+        }
+        if (usedTableEntries + pageCount > maxTableEntries) {
+            throw std::runtime_error("virtual texture page table is full!");
+        }
+
+        texture.tableOffset = usedTableEntries;
+        texture.slots.assign(pageCount, -1);
+        usedTableEntries += pageCount;
+        tableEntries.resize(usedTableEntries, 0);
+
+        uint32_t id = static_cast<uint32_t>(textures.size());
+        textures.push_back(std::move(texture));
+        dirtyInfos.push_back(id);
+        // the fallback for every other page of the texture
+        requestPage(packKey(id, coarsest, 0, 0));
+        return id;
+    }
+
+    void VirtualTextureSystem::requestPage(uint32_t key) {
+        if (pendingKeys.count(key) || pendingKeys.size() >= MAX_PENDING_LOADS) {
+            return;
+        }
+        uint32_t textureId, mip, x, y;
+        unpackKey(key, textureId, mip, x, y);
+        const VirtualTexture &texture = textures[textureId];
+
+        PageRequest request{};
+        request.key = key;
+        request.filepath = texture.filepath;
+        request.levelOffset = texture.levelOffsets[mip];
+        request.levelWidth = std::max(texture.width >> mip, 1u);
+        request.levelHeight = std::max(texture.height >> mip, 1u);
+        pendingKeys.insert(key);
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            requests.push_back(std::move(request));
+        }
+        loaderCondition.notify_one();
+    }
+
+    void VirtualTextureSystem::loaderLoop() {
+        while (true) {
+            PageRequest request;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                loaderCondition.wait(lock, [this]() { return stopping || !requests.empty(); });
+                if (stopping) {
+                    return;
+                }
+                request = std::move(requests.front());
+                requests.pop_front();
+            }
+
+            LoadedPage page{request.key, {}};
+            try {
+                page.texels = readPage(request);
+            } catch (const std::exception &) {
+                // an empty page only clears the pending request, the feedback asks for it again
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            loadedPages.push_back(std::move(page));
+        }
+    }
+
+    std::vector<uint8_t> VirtualTextureSystem::readPage(const PageRequest &request) {
+        std::ifstream file{request.filepath, std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + request.filepath);
+        }
+
+        uint32_t textureId, mip, pageX, pageY;
+        unpackKey(request.key, textureId, mip, pageX, pageY);
+        // the payload plus its border, texels past the level's edges repeat the edge
+        int32_t x0 = static_cast<int32_t>(pageX * PAGE_PAYLOAD) - static_cast<int32_t>(PAGE_BORDER);
+        int32_t y0 = static_cast<int32_t>(pageY * PAGE_PAYLOAD) - static_cast<int32_t>(PAGE_BORDER);
+        int32_t maxX = static_cast<int32_t>(request.levelWidth) - 1;
+        int32_t maxY = static_cast<int32_t>(request.levelHeight) - 1;
+        int32_t spanBegin = std::clamp(x0, 0, maxX);
+        int32_t spanEnd = std::clamp(x0 + static_cast<int32_t>(PAGE_SIZE) - 1, 0, maxX);
+
+        std::vector<uint8_t> texels(PAGE_BYTES);
+        std::vector<uint8_t> span((spanEnd - spanBegin + 1) * 4);
+        for (uint32_t row = 0; row < PAGE_SIZE; row++) {
+            int32_t y = std::clamp(y0 + static_cast<int32_t>(row), 0, maxY);
+            file.seekg(static_cast<std::streamoff>(request.levelOffset + (static_cast<uint64_t>(y) * request.levelWidth + spanBegin) * 4));
+            if (!file.read(reinterpret_cast<char *>(span.data()), span.size())) {
+                throw std::runtime_error("truncated virtual texture: " + request.filepath);
+            }
+            uint8_t *out = texels.data() + row * PAGE_SIZE * 4;
+            for (uint32_t column = 0; column < PAGE_SIZE; column++) {
+                int32_t x = std::clamp(x0 + static_cast<int32_t>(column), 0, maxX);
+                std::memcpy(out + column * 4, span.data() + (x - spanBegin) * 4, 4);
+            }
+        }
+        return texels;
+    }
+
+    void VirtualTextureSystem::beginFrame(int frameIndex, uint64_t frameNumber, vk::Extent2D extent) {
+        char *region = static_cast<char *>(feedbackBuffer->getMappedMemory()) + frameIndex * feedbackBuffer->getAlignmentSize();
+        FeedbackHeader *header = reinterpret_cast<FeedbackHeader *>(region);
+        uint32_t *feedback = reinterpret_cast<uint32_t *>(region + sizeof(FeedbackHeader));
+
+        std::vector<uint32_t> keys;
+        uint32_t count = header->width * header->height;
+        for (uint32_t i = 0; i < count; i++) {
+            if (feedback[i] != EMPTY_FEEDBACK) {
+                keys.push_back(feedback[i]);
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        // coarse pages first, they are the fallback of everything below them
+        std::stable_sort(keys.begin(), keys.end(), [](uint32_t a, uint32_t b) { return ((a >> 18) & (MAX_MIPS - 1)) > ((b >> 18) & (MAX_MIPS - 1)); });
+
+        for (uint32_t key : keys) {
+            uint32_t textureId, mip, x, y;
+            unpackKey(key, textureId, mip, x, y);
+            if (textureId >= textures.size() || mip >= textures[textureId].mipCount ||
+                x >= textures[textureId].pagesX[mip] || y >= textures[textureId].pagesY[mip]) {
+                continue;
+            }
+            int32_t slot = textures[textureId].slots[pageIndex(textures[textureId], mip, x, y)];
+            if (slot < 0) {
+                stats.feedbackRequests++;
+                requestPage(key);
+            } else if (!slots[slot].pinned) {
+                lru.splice(lru.begin(), lru, slots[slot].lruPosition);
+            }
+        }
+
+        // size the grid for this frame, targets past maxExtent lose their bottom rows
+        uint32_t width = (extent.width + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+        uint32_t height = std::min((extent.height + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE, feedbackCapacity / std::max(width, 1u));
+        header->width = width;
+        header->height = height;
+        header->jitter = static_cast<uint32_t>(frameNumber % (FEEDBACK_SCALE * FEEDBACK_SCALE));
+        std::memset(feedback, 0xff, sizeof(uint32_t) * width * height);
+    }
+
+    uint32_t VirtualTextureSystem::pageIndex(const VirtualTexture &texture, uint32_t mip, uint32_t x, uint32_t y) const {
+        return texture.mipOffsets[mip] + y * texture.pagesX[mip] + x;
+    }
+
+    void VirtualTextureSystem::updateSubtree(VirtualTexture &texture, uint32_t mip, uint32_t x, uint32_t y) {
+        // coarse to fine, so every parent entry is final before its children copy it
+        for (int32_t level = static_cast<int32_t>(mip); level >= 0; level--) {
+            uint32_t m = static_cast<uint32_t>(level);
+            uint32_t shift = mip - m;
+            uint32_t xBegin = x << shift;
+            uint32_t xEnd = std::min((x + 1) << shift, texture.pagesX[m]);
+            uint32_t yBegin = y << shift;
+            uint32_t yEnd = std::min((y + 1) << shift, texture.pagesY[m]);
+            for (uint32_t pageY = yBegin; pageY < yEnd; pageY++) {
+                for (uint32_t pageX = xBegin; pageX < xEnd; pageX++) {
+                    uint32_t index = pageIndex(texture, m, pageX, pageY);
+                    int32_t slot = texture.slots[index];
+                    uint32_t entry = 0;
+                    if (slot >= 0) {
+                        uint32_t slotX = static_cast<uint32_t>(slot) % cacheSizeInPages;
+                        uint32_t slotY = static_cast<uint32_t>(slot) / cacheSizeInPages;
+                        entry = ENTRY_VALID | (m << 16) | (slotY << 8) | slotX;
+                    } else if (m + 1 < texture.mipCount) {
+                        entry = tableEntries[texture.tableOffset + pageIndex(texture, m + 1, pageX >> 1, pageY >> 1)];
+                    }
+                    tableEntries[texture.tableOffset + index] = entry;
+                }
+                uint32_t rowBegin = texture.tableOffset + pageIndex(texture, m, xBegin, pageY);
+                dirtyEntries.push_back({rowBegin, rowBegin + (xEnd - xBegin)});
+            }
+        }
+    }
+
+    void VirtualTextureSystem::evict(uint32_t slotIndex) {
+        Slot &slot = slots[slotIndex];
+        uint32_t textureId, mip, x, y;
+        unpackKey(slot.key, textureId, mip, x, y);
+        VirtualTexture &texture = textures[textureId];
+        texture.slots[pageIndex(texture, mip, x, y)] = -1;
+        updateSubtree(texture, mip, x, y);
+
+        lru.erase(slot.lruPosition);
+        slot.key = ~0u;
+        freeSlots.push_back(slotIndex);
+        stats.evictions++;
+        stats.residentPages--;
+    }
+
+    void VirtualTextureSystem::recordFeedbackBarrier(vk::CommandBuffer commandBuffer, int frameIndex) {
+        vk::BufferMemoryBarrier barrier{vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+            feedbackBuffer->getBuffer(), frameIndex * feedbackBuffer->getAlignmentSize(), feedbackBuffer->getInstanceSize()};
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eHost, {}, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    void VirtualTextureSystem::recordUpdates(vk::CommandBuffer commandBuffer, int frameIndex) {
+        GpuProfiler::Scope profileScope{device.gpuProfiler(), commandBuffer, "VirtualTextureUpdate"};
+
+        if (!cacheInitialized) {
+            // every entry starts out empty and the cache is sampled before its first page lands
+            commandBuffer.fillBuffer(pageTable->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+            vk::BufferMemoryBarrier tableBarrier{
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderRead,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, pageTable->getBuffer(), 0, VK_WHOLE_SIZE};
+            vk::ImageMemoryBarrier cacheBarrier{
+                {}, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, cacheImage, {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eFragmentShader,
+                {}, 0, nullptr, 1, &tableBarrier, 1, &cacheBarrier);
+            cacheInitialized = true;
+        }
+
+        std::vector<LoadedPage> pages;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            while (!loadedPages.empty() && pages.size() < UPLOADS_PER_FRAME) {
+                pages.push_back(std::move(loadedPages.front()));
+                loadedPages.pop_front();
+            }
+        }
+
+        vk::DeviceSize stagingBase = frameIndex * stagingBuffer->getAlignmentSize();
+        char *staging = static_cast<char *>(stagingBuffer->getMappedMemory()) + stagingBase;
+        std::vector<vk::BufferImageCopy> pageCopies;
+        for (auto &page : pages) {
+            pendingKeys.erase(page.key);
+            uint32_t textureId, mip, x, y;
+            unpackKey(page.key, textureId, mip, x, y);
+            VirtualTexture &texture = textures[textureId];
+            uint32_t index = pageIndex(texture, mip, x, y);
+            if (page.texels.empty() || texture.slots[index] >= 0) {
+                continue;
+            }
+            if (freeSlots.empty()) {
+                if (lru.empty()) {
+                    // every slot is pinned, the cache is too small for the texture set's coarsest pages
+                    continue;
+                }
+                evict(lru.back());
+            }
+
+            uint32_t slotIndex = freeSlots.back();
+            freeSlots.pop_back();
+            Slot &slot = slots[slotIndex];
+            slot.key = page.key;
+            slot.pinned = mip == texture.mipCount - 1;
+            if (!slot.pinned) {
+                lru.push_front(slotIndex);
+                slot.lruPosition = lru.begin();
+            }
+            texture.slots[index] = static_cast<int32_t>(slotIndex);
+            updateSubtree(texture, mip, x, y);
+
+            vk::DeviceSize offset = pageCopies.size() * PAGE_BYTES;
+            std::memcpy(staging + offset, page.texels.data(), PAGE_BYTES);
+            int32_t slotX = static_cast<int32_t>((slotIndex % cacheSizeInPages) * PAGE_SIZE);
+            int32_t slotY = static_cast<int32_t>((slotIndex / cacheSizeInPages) * PAGE_SIZE);
+            pageCopies.push_back({stagingBase + offset, 0, 0, {vk::ImageAspectFlagBits::eColor, 0, 0, 1}, {slotX, slotY, 0}, {PAGE_SIZE, PAGE_SIZE, 1}});
+            stats.pagesUploaded++;
+            stats.residentPages++;
+        }
+
+        if (!pageCopies.empty()) {
+            vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+            vk::ImageMemoryBarrier toTransfer{
+                {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, cacheImage, range};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 0, nullptr, 1, &toTransfer);
+            commandBuffer.copyBufferToImage(stagingBuffer->getBuffer(), cacheImage, vk::ImageLayout::eTransferDstOptimal,
+                static_cast<uint32_t>(pageCopies.size()), pageCopies.data());
+            vk::ImageMemoryBarrier toShader{
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, cacheImage, range};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 0, nullptr, 1, &toShader);
+        }
+
+        // texture infos and as many dirty entries as fit this frame's staging
+        std::vector<vk::BufferCopy> tableCopies;
+        vk::DeviceSize offset = PAGE_BYTES * UPLOADS_PER_FRAME;
+        for (uint32_t id : dirtyInfos) {
+            const VirtualTexture &texture = textures[id];
+            VirtualTextureInfo info{texture.tableOffset, texture.width, texture.height, texture.mipCount};
+            std::memcpy(staging + offset, &info, sizeof(info));
+            tableCopies.push_back({stagingBase + offset, sizeof(VirtualTextureInfo) * id, sizeof(info)});
+            offset += sizeof(info);
+        }
+        dirtyInfos.clear();
+
+        std::sort(dirtyEntries.begin(), dirtyEntries.end());
+        std::vector<std::pair<uint32_t, uint32_t>> merged;
+        for (const auto &range : dirtyEntries) {
+            if (!merged.empty() && range.first <= merged.back().second) {
+                merged.back().second = std::max(merged.back().second, range.second);
+            } else {
+                merged.push_back(range);
+            }
+        }
+        dirtyEntries.clear();
+        uint32_t budget = TABLE_UPLOAD_ENTRIES;
+        for (const auto &range : merged) {
+            uint32_t count = std::min(range.second - range.first, budget);
+            if (count > 0) {
+                std::memcpy(staging + offset, tableEntries.data() + range.first, sizeof(uint32_t) * count);
+                tableCopies.push_back({stagingBase + offset,
+                    sizeof(VirtualTextureInfo) * MAX_VIRTUAL_TEXTURES + sizeof(uint32_t) * range.first, sizeof(uint32_t) * count});
+                offset += sizeof(uint32_t) * count;
+                budget -= count;
+            }
+            if (range.first + count < range.second) {
+                dirtyEntries.push_back({range.first + count, range.second});
+            }
+        }
+
+        if (!tableCopies.empty()) {
+            vk::BufferMemoryBarrier toTransfer{
+                vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, pageTable->getBuffer(), 0, VK_WHOLE_SIZE};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, 0, nullptr, 1, &toTransfer, 0, nullptr);
+            commandBuffer.copyBuffer(stagingBuffer->getBuffer(), pageTable->getBuffer(), static_cast<uint32_t>(tableCopies.size()), tableCopies.data());
+            vk::BufferMemoryBarrier toShader{
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead,
+                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, pageTable->getBuffer(), 0, VK_WHOLE_SIZE};
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, 0, nullptr, 1, &toShader, 0, nullptr);
+        }
+    }
+
+    VirtualTextureSystem::Stats VirtualTextureSystem::getStats() const {
+        Stats current = stats;
+        current.pendingLoads = static_cast<uint32_t>(pendingKeys.size());
+        return current;
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace Engine {
+
+    // Streams textures in fixed size pages instead of loading whole mip chains. All resident pages share one
+    // physical cache image, and a page table maps every virtual page to its cache slot or, while it is missing, to
+    // the closest resident coarser page.
+    //
+    // Shaders sampling a virtual texture (VirtualTexture.glsl) write the pages they wanted into a per-frame feedback
+    // buffer. The cpu reads it back once that frame has completed and queues the missing pages on a loader thread,
+    // which reads just the page's texels from the file. A few loaded pages per frame are copied into free slots, or
+    // the least recently requested ones. Gpu memory is the cache, page table and staging, whatever the texture set.
+    class VirtualTextureSystem {
+        public:
+        // keep in sync with VirtualTexture.glsl
+        static constexpr uint32_t PAGE_SIZE = 128;
+        // texels repeated from the neighbouring pages so bilinear filtering never reads another slot
+        static constexpr uint32_t PAGE_BORDER = 4;
+        static constexpr uint32_t PAGE_PAYLOAD = PAGE_SIZE - 2 * PAGE_BORDER;
+        static constexpr uint32_t MAX_VIRTUAL_TEXTURES = 256;
+        static constexpr uint32_t FEEDBACK_SCALE = 8;
+        static constexpr uint32_t INVALID_TEXTURE = ~0u;
+
+        struct Stats {
+            uint32_t residentPages = 0;
+            uint32_t pendingLoads = 0;
+            // totals since creation
+            // missing pages the feedback read back asked for, zero on a textured scene means the reads see nothing
+            uint64_t feedbackRequests = 0;
+            uint64_t pagesUploaded = 0;
+            uint64_t evictions = 0;
+        };
+
+        // cacheSizeInPages^2 slots of PAGE_SIZE^2 texels. maxExtent bounds the feedback buffer, larger targets are
+        // only partially sampled.
+        VirtualTextureSystem(
+            Device &device,
+            uint32_t cacheSizeInPages = 32,
+            vk::Extent2D maxExtent = {3840, 2160},
+            uint32_t maxTableEntries = 1 << 20);
+        ~VirtualTextureSystem();
+
+        VirtualTextureSystem(const VirtualTextureSystem &) = delete;
+        VirtualTextureSystem &operator=(const VirtualTextureSystem &) = delete;
+
+        // Uncompressed RGBA8 sRGB KTX2 files whose mip chain reaches a single page. Only the header is read here,
+        // the coarsest single page level is queued right away and never evicted.
+        uint32_t registerTexture(const std::string &filepath);
+
+        // Reads back the feedback this frame slot collected MAX_FRAMES_IN_FLIGHT frames ago and queues missing pages,
+        // call after Renderer::beginFrame
+        void beginFrame(int frameIndex, uint64_t frameNumber, vk::Extent2D extent);
+        // Copies loaded pages and page table changes, outside of any render pass and before sampling
+        void recordUpdates(vk::CommandBuffer commandBuffer, int frameIndex);
+        // After the last pass sampling virtual textures, makes the frame's feedback writes visible to the readback in
+        // beginFrame. Waiting for the frame to complete doesn't do that by itself.
+        void recordFeedbackBarrier(vk::CommandBuffer commandBuffer, int frameIndex);
+
+        // For the shading pass, the feedback buffer is bound with getFeedbackOffset
+        vk::DescriptorImageInfo cacheDescriptorInfo() const { return {cacheSampler, cacheView, vk::ImageLayout::eShaderReadOnlyOptimal}; }
+        vk::DescriptorBufferInfo pageTableInfo() { return pageTable->descriptorInfo(); }
+        vk::DescriptorBufferInfo feedbackInfo() { return feedbackBuffer->descriptorInfo(feedbackBuffer->getInstanceSize()); }
+        uint32_t getFeedbackOffset(int frameIndex) const { return static_cast<uint32_t>(frameIndex * feedbackBuffer->getAlignmentSize()); }
+
+        Stats getStats() const;
+
+        private:
+        struct VirtualTexture {
+            std::string filepath;
+            uint32_t width;
+            uint32_t height;
+            // levels past the coarsest single page one are never sampled
+            uint32_t mipCount;
+            std::vector<uint64_t> levelOffsets;
+            std::vector<uint32_t> pagesX;
+            std::vector<uint32_t> pagesY;
+            // first page of each level, relative to tableOffset
+            std::vector<uint32_t> mipOffsets;
+            uint32_t tableOffset;
+            // cache slot of each resident page
+            std::vector<int32_t> slots;
+        };
+
+        struct PageRequest {
+            uint32_t key;
+            std::string filepath;
+            uint64_t levelOffset;
+            uint32_t levelWidth;
+            uint32_t levelHeight;
+        };
+
+        struct LoadedPage {
+            uint32_t key;
+            std::vector<uint8_t> texels;
+        };
+
+        struct Slot {
+            uint32_t key = ~0u;
+            bool pinned = false;
+            std::list<uint32_t>::iterator lruPosition;
+        };
+
+        void createCache();
+        void createBuffers(vk::Extent2D maxExtent);
+
+        void requestPage(uint32_t key);
+        void loaderLoop();
+        static std::vector<uint8_t> readPage(const PageRequest &request);
+
+        // page index within the texture's table
+        uint32_t pageIndex(const VirtualTexture &texture, uint32_t mip, uint32_t x, uint32_t y) const;
+        // rewrites the entries of the page and every finer page under it, after its residency changed
+        void updateSubtree(VirtualTexture &texture, uint32_t mip, uint32_t x, uint32_t y);
+        void evict(uint32_t slot);
+
+        Device &device;
+        uint32_t cacheSizeInPages;
+        uint32_t maxTableEntries;
+        uint32_t usedTableEntries = 0;
+
+        vk::Image cacheImage;
+        vk::DeviceMemory cacheMemory;
+        vk::ImageView cacheView;
+        vk::Sampler cacheSampler;
+        bool cacheInitialized = false;
+
+        // texture infos followed by every page table entry
+        std::unique_ptr<Buffer> pageTable;
+        // one region per frame in flight, a small header followed by a FEEDBACK_SCALE downscaled grid of requests
+        std::unique_ptr<Buffer> feedbackBuffer;
+        uint32_t feedbackCapacity;
+        // loaded pages, then page table entries, one region per frame in flight
+        std::unique_ptr<Buffer> stagingBuffer;
+
+        std::vector<VirtualTexture> textures;
+        // cpu copy of the page table entries
+        std::vector<uint32_t> tableEntries;
+        std::vector<uint32_t> dirtyInfos;
+        // half open ranges of page table entries to upload
+        std::vector<std::pair<uint32_t, uint32_t>> dirtyEntries;
+
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+        // slot indices, most recently requested first, pinned slots are not in it
+        std::list<uint32_t> lru;
+        std::unordered_set<uint32_t> pendingKeys;
+        Stats stats{};
+
+        std::thread loader;
+        std::mutex mutex;
+        std::condition_variable loaderCondition;
+        std::deque<PageRequest> requests;
+        std::deque<LoadedPage> loadedPages;
+        bool stopping = false;
+    };
+}
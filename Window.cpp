@@ -5,7 +5,7 @@
 
 namespace Engine {
 
-    Window::Window(std::string name) : windowName{name} {
+    Window::Window(std::string name, int width, int height) : width{width}, height{height}, windowName{name} {
         initWindow();
     }
 
@@ -17,12 +17,21 @@ namespace Engine {
     void Window::initWindow() {
         SDL_Init(SDL_INIT_EVERYTHING);
 
-        SDL_DisplayMode displayMode;
-        SDL_GetCurrentDisplayMode(0, &displayMode);
-        width = displayMode.w;
-        height = displayMode.h;
+        Uint32 flags = SDL_WINDOW_VULKAN | SDL_WINDOW_ALLOW_HIGHDPI;
+        if (width <= 0 || height <= 0) {
+            SDL_DisplayMode displayMode;
+            SDL_GetCurrentDisplayMode(0, &displayMode);
+            width = displayMode.w;
+            height = displayMode.h;
+            flags |= SDL_WINDOW_FULLSCREEN;
+        } else {
+            flags |= SDL_WINDOW_RESIZABLE;
+        }
 
-        window = SDL_CreateWindow(windowName.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_VULKAN | SDL_WINDOW_FULLSCREEN | SDL_WINDOW_ALLOW_HIGHDPI);
+        window = SDL_CreateWindow(windowName.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, flags);
+        if (window == nullptr) {
+            throw std::runtime_error("failed to create window!");
+        }
         SDL_ShowCursor(SDL_DISABLE);
         SDL_SetRelativeMouseMode(SDL_TRUE);
     }
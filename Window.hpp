@@ -9,7 +9,8 @@ namespace Engine {
 
     class Window {
         public:
-        Window(std::string name);
+        // a zero size opens a fullscreen window at the desktop resolution
+        Window(std::string name, int width = 0, int height = 0);
         ~Window();
 
         Window(const Window &) = delete;